@@ -86,7 +86,8 @@ ResourceManager::ChangeID::ChangeID(ChangeSetList::iterator c) : _empty(false),
 }
 
 
-ResourceManager::ResourceManager() : _rimsAreERFs(false), _hashAlgo(Common::kHashFNV64) {
+ResourceManager::ResourceManager() : _rimsAreERFs(false), _hashAlgo(Common::kHashFNV64),
+	_generation(0) {
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeDDS);
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeTPC);
 	_resourceTypeTypes[kResourceImage].push_back(kFileTypeTXB);
@@ -151,6 +152,8 @@ void ResourceManager::clearResources() {
 	_typeAliases.clear();
 
 	_changes.clear();
+
+	_generation++;
 }
 
 void ResourceManager::setRIMsAreERFs(bool rimsAreERFs) {
@@ -454,6 +457,8 @@ void ResourceManager::undo(ChangeID &change) {
 	// Now we can remove the change set from our list of change sets
 	_changes.erase(change._change);
 
+	_generation++;
+
 	// And finally set the change ID to a defined empty state
 	change._empty  = true;
 	change._change = _changes.end();
@@ -470,6 +475,8 @@ void ResourceManager::blacklist(const Common::UString &name, FileType type) {
 
 	for (ResourceList::iterator res = resList->second.begin(); res != resList->second.end(); ++res)
 		res->priority = 0;
+
+	_generation++;
 }
 
 void ResourceManager::declareResource(const Common::UString &name, FileType type) {
@@ -487,6 +494,10 @@ void ResourceManager::declareResource(const Common::UString &name) {
 	declareResource(TypeMan.setFileType(name, kFileTypeNone), TypeMan.getFileType(name));
 }
 
+uint32 ResourceManager::getGeneration() const {
+	return _generation;
+}
+
 bool ResourceManager::hasResource(const Common::UString &name, FileType type) const {
 	std::vector<FileType> types;
 
@@ -694,6 +705,8 @@ void ResourceManager::addResource(Resource &resource, uint64 hash, ChangeID &cha
 	change._change->resources.push_back(ResourceChange());
 	change._change->resources.back().hashIt = resList;
 	change._change->resources.back().resIt  = --resList->second.end();
+
+	_generation++;
 }
 
 void ResourceManager::addResource(Resource &resource, const Common::UString &name, ChangeID &change) {
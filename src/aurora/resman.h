@@ -235,6 +235,13 @@ public:
 	 */
 	void declareResource(const Common::UString &name);
 
+	/** Return a number that changes whenever resources are added or removed.
+	 *
+	 *  Caches of data derived from resources can compare this to find out
+	 *  when the resources they were built from might have been replaced.
+	 */
+	uint32 getGeneration() const;
+
 	/** Does a specific resource exist?
 	 *
 	 *  @param  name The name (ResRef) of the resource.
@@ -326,6 +333,8 @@ private:
 
 	ChangeSetList _changes;
 
+	uint32 _generation; ///< Bumped on every change to the available resources.
+
 	FileTypeList _resourceTypeTypes[kResourceMAX]; ///< All valid resource type file types.
 
 
@@ -0,0 +1,314 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/bitreader.h
+ *  A memory-backed bit reader.
+ */
+
+#ifndef COMMON_BITREADER_H
+#define COMMON_BITREADER_H
+
+#include "common/types.h"
+#include "common/endianness.h"
+#include "common/noncopyable.h"
+#include "common/error.h"
+#include "common/stream.h"
+
+namespace Common {
+
+/**
+ * A template implementing a bit reader over a memory buffer.
+ *
+ * It reads its data in the same layout as the corresponding BitStreamImpl,
+ * and hands out the bits in the same order. Unlike BitStream, however, it
+ * doesn't read through a virtual stream interface one value at a time.
+ * Instead, it keeps up to 64 bits of data in a cache that is refilled
+ * straight from memory, and none of its methods are virtual. Decoders
+ * that read bits in their innermost loops should use this instead.
+ *
+ * Only 8, 16 and 32 bit wide data values are supported.
+ */
+template<int valueBits, bool isLE, bool isMSB2LSB>
+class BitReaderImpl : NonCopyable {
+private:
+	static const uint32 kValueBytes = valueBits / 8;
+
+	/** Can several consecutive data values be read as one 32-bit value? */
+	static const bool kChunkable = (valueBits == 8) || (valueBits == 32) || (isLE != isMSB2LSB);
+
+	const byte *_data;     ///< The input data.
+	uint32 _dataSize;      ///< The size of the input data in bytes, in whole data values.
+	uint32 _dataPos;       ///< The position of the next data value to be cached, in bytes.
+	bool _disposeAfterUse; ///< Should we delete the data on destruction?
+
+	/** The cached bits.
+	 *
+	 *  If we hand out the bits MSB first, the next bit is the cache's MSB.
+	 *  Otherwise, the next bit is the cache's LSB. Either way, all bits
+	 *  past the cached ones are 0.
+	 */
+	uint64 _cache;
+	uint8  _cacheBits; ///< The number of bits in the cache.
+
+	/** Add an n-bit value to the end of the cache. */
+	inline void addToCache(uint32 value, uint8 n) {
+		if (isMSB2LSB)
+			_cache |= ((uint64) value) << (64 - n - _cacheBits);
+		else
+			_cache |= ((uint64) value) << _cacheBits;
+
+		_cacheBits += n;
+	}
+
+	/** Read one data value. */
+	inline uint32 readValue(const byte *data) const {
+		if (valueBits == 8)
+			return *data;
+
+		if (valueBits == 16)
+			return isLE ? READ_LE_UINT16(data) : READ_BE_UINT16(data);
+
+		return isLE ? READ_LE_UINT32(data) : READ_BE_UINT32(data);
+	}
+
+	/** Read 32 bits worth of consecutive data values at once. */
+	inline uint32 readChunk(const byte *data) const {
+		// A byte stream is read in the order the bits are handed out
+		const bool chunkLE = (valueBits == 8) ? !isMSB2LSB : isLE;
+
+		return chunkLE ? READ_LE_UINT32(data) : READ_BE_UINT32(data);
+	}
+
+	/** Refill the cache, so that it holds at least 32 bits, if there's enough data left. */
+	inline void refill() {
+		if (kChunkable && ((_dataPos + 4) <= _dataSize) && (_cacheBits <= 32)) {
+			addToCache(readChunk(_data + _dataPos), 32);
+
+			_dataPos += 4;
+			return;
+		}
+
+		while ((_cacheBits <= (64 - valueBits)) && (_dataPos < _dataSize)) {
+			addToCache(readValue(_data + _dataPos), valueBits);
+
+			_dataPos += kValueBytes;
+		}
+	}
+
+	/** Remove n bits, with n <= _cacheBits and n < 64, from the cache. */
+	inline void consume(uint8 n) {
+		if (isMSB2LSB)
+			_cache <<= n;
+		else
+			_cache >>= n;
+
+		_cacheBits -= n;
+	}
+
+	/** Return the next n bits in the cache, n <= 32. */
+	inline uint32 peekCache(uint8 n) const {
+		if (n == 0)
+			return 0;
+
+		if (isMSB2LSB)
+			return (uint32) (_cache >> (64 - n));
+
+		return (uint32) (_cache & ((((uint64) 1) << n) - 1));
+	}
+
+	/** Make sure the cache holds at least n bits. */
+	inline void need(uint8 n) {
+		if (_cacheBits >= n)
+			return;
+
+		refill();
+		if (_cacheBits < n)
+			throw Exception("BitReader: End of bit stream reached");
+	}
+
+	void init() {
+		if ((valueBits != 8) && (valueBits != 16) && (valueBits != 32))
+			throw Exception("BitReader: Invalid memory layout %d, %d, %d", valueBits, isLE, isMSB2LSB);
+
+		// Like BitStream, ignore a trailing partial data value
+		_dataSize &= ~(kValueBytes - 1);
+
+		_dataPos   = 0;
+		_cache     = 0;
+		_cacheBits = 0;
+	}
+
+public:
+	/** Create a bit reader over this data and optionally delete[] it on destruction. */
+	BitReaderImpl(const byte *data, uint32 size, bool disposeAfterUse = false) :
+		_data(data), _dataSize(size), _disposeAfterUse(disposeAfterUse) {
+
+		init();
+	}
+
+	/** Create a bit reader over the next size bytes of this data stream. */
+	BitReaderImpl(SeekableReadStream &stream, uint32 size) :
+		_data(0), _dataSize(size), _disposeAfterUse(true) {
+
+		byte *data = new byte[size];
+		_data = data;
+
+		if (stream.read(data, size) != size) {
+			delete[] data;
+			throw Exception(kReadError);
+		}
+
+		init();
+	}
+
+	~BitReaderImpl() {
+		if (_disposeAfterUse)
+			delete[] _data;
+	}
+
+	/** Read a bit from the bit stream. */
+	inline uint32 getBit() {
+		need(1);
+
+		const uint32 b = isMSB2LSB ? (_cache >> 63) : (_cache & 1);
+
+		consume(1);
+		return b;
+	}
+
+	/** Read a multi-bit value from the bit stream. */
+	inline uint32 getBits(uint8 n) {
+		if (n > 32)
+			throw Exception("Too many bits requested to be read");
+
+		need(n);
+
+		const uint32 v = peekCache(n);
+
+		consume(n);
+		return v;
+	}
+
+	/** Read a multi-bit value from the bit stream, without consuming it.
+	 *
+	 *  Bits past the end of the stream read as 0.
+	 */
+	inline uint32 peekBits(uint8 n) {
+		if (n > 32)
+			throw Exception("Too many bits requested to be peeked");
+
+		if (_cacheBits < n)
+			refill();
+
+		return peekCache(n);
+	}
+
+	/** Skip the specified amount of bits. */
+	inline void skip(uint32 n) {
+		if (n <= _cacheBits) {
+			if (n < 64)
+				consume(n);
+			else
+				_cache = _cacheBits = 0;
+
+			return;
+		}
+
+		const uint32 newPos = pos() + n;
+		if (newPos > size())
+			throw Exception("BitReader: End of bit stream reached");
+
+		// Throw away the cache and start over at the data value the new position is in
+		_dataPos   = (newPos / valueBits) * kValueBytes;
+		_cache     = 0;
+		_cacheBits = 0;
+
+		refill();
+		consume(newPos % valueBits);
+	}
+
+	/** Add a bit to the value x, making it an n-bit value. */
+	inline void addBit(uint32 &x, uint32 n) {
+		if (isMSB2LSB)
+			x = (x << 1) | getBit();
+		else
+			x = (x & ~(1 << n)) | (getBit() << n);
+	}
+
+	/** Are the bits handed out from MSB to LSB of the data values? */
+	bool isMSBFirst() const {
+		return isMSB2LSB;
+	}
+
+	/** Rewind the bit stream back to the start. */
+	void rewind() {
+		_dataPos   = 0;
+		_cache     = 0;
+		_cacheBits = 0;
+	}
+
+	/** Return the stream position in bits. */
+	uint32 pos() const {
+		return _dataPos * 8 - _cacheBits;
+	}
+
+	/** Return the stream size in bits. */
+	uint32 size() const {
+		return _dataSize * 8;
+	}
+
+	bool eos() const {
+		return pos() >= size();
+	}
+};
+
+// typedefs for various memory layouts.
+
+/** 8-bit data, MSB to LSB. */
+typedef BitReaderImpl<8, false, true > BitReader8MSB;
+/** 8-bit data, LSB to MSB. */
+typedef BitReaderImpl<8, false, false> BitReader8LSB;
+
+/** 16-bit little-endian data, MSB to LSB. */
+typedef BitReaderImpl<16, true , true > BitReader16LEMSB;
+/** 16-bit little-endian data, LSB to MSB. */
+typedef BitReaderImpl<16, true , false> BitReader16LELSB;
+/** 16-bit big-endian data, MSB to LSB. */
+typedef BitReaderImpl<16, false, true > BitReader16BEMSB;
+/** 16-bit big-endian data, LSB to MSB. */
+typedef BitReaderImpl<16, false, false> BitReader16BELSB;
+
+/** 32-bit little-endian data, MSB to LSB. */
+typedef BitReaderImpl<32, true , true > BitReader32LEMSB;
+/** 32-bit little-endian data, LSB to MSB. */
+typedef BitReaderImpl<32, true , false> BitReader32LELSB;
+/** 32-bit big-endian data, MSB to LSB. */
+typedef BitReaderImpl<32, false, true > BitReader32BEMSB;
+/** 32-bit big-endian data, LSB to MSB. */
+typedef BitReaderImpl<32, false, false> BitReader32BELSB;
+
+} // End of namespace Common
+
+#endif // COMMON_BITREADER_H
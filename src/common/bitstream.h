@@ -31,6 +31,7 @@
 #define COMMON_BITSTREAM_H
 
 #include "common/types.h"
+#include "common/util.h"
 #include "common/error.h"
 #include "common/stream.h"
 
@@ -63,6 +64,15 @@ public:
 	/** Read a multi-bit value from the bit stream. */
 	virtual uint32 getBits(uint8 n) = 0;
 
+	/** Read a multi-bit value from the bit stream, without consuming it.
+	 *
+	 *  Bits past the end of the stream read as 0.
+	 */
+	virtual uint32 peekBits(uint8 n) = 0;
+
+	/** Are the bits handed out from MSB to LSB of the data values? */
+	virtual bool isMSBFirst() const = 0;
+
 	/** Add a bit to the value x, making it an n-bit value. */
 	virtual void addBit(uint32 &x, uint32 n) = 0;
 
@@ -198,6 +208,39 @@ public:
 		return v;
 	}
 
+	/** Read a multi-bit value from the bit stream, without consuming it. */
+	uint32 peekBits(uint8 n) {
+		if (n > 32)
+			throw Exception("Too many bits requested to be peeked");
+
+		const uint64 value   = _value;
+		const uint8  inValue = _inValue;
+		const int32  dataPos = _stream->pos();
+
+		// Read as many bits as are there
+		const uint8 m = MIN<uint32>(n, size() - MIN(pos(), size()));
+
+		uint32 v = 0;
+		if (m > 0) {
+			v = getBits(m);
+
+			// And pad the rest with 0
+			if (isMSB2LSB)
+				v <<= n - m;
+		}
+
+		_stream->seek(dataPos);
+
+		_value   = value;
+		_inValue = inValue;
+
+		return v;
+	}
+
+	bool isMSBFirst() const {
+		return isMSB2LSB;
+	}
+
 	/** Add a bit to the value x, making it an n-bit value. */
 	void addBit(uint32 &x, uint32 n) {
 		if (isMSB2LSB)
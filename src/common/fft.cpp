@@ -35,6 +35,12 @@
 #include <cassert>
 #include <cstring>
 
+#include "common/system.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
 #include "common/maths.h"
 #include "common/cosinetables.h"
 #include "common/util.h"
@@ -172,11 +178,70 @@ static void name(Complex *z, const float *wre, unsigned int n)\
 	} while (--n);\
 }
 
+#ifdef XOREOS_SSE2
+
+// Swap the real and imaginary parts of both complex numbers in a vector
+#define SWAP_RE_IM(v) _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1))
+
+/* Two TRANSFORMs at once, on z[0...1], z[o1...o1+1], z[o2...o2+1], z[o3...o3+1].
+ * wre and wim hold the twiddle factors for both, each one duplicated. */
+static inline void transform2(Complex *z, int o1, int o2, int o3, __m128 wre, __m128 wim) {
+	const __m128 signIm = _mm_set_ps(-1.0f,  1.0f, -1.0f,  1.0f);
+	const __m128 signRe = _mm_set_ps( 1.0f, -1.0f,  1.0f, -1.0f);
+
+	const __m128 a0 = _mm_loadu_ps(&z[0 ].re);
+	const __m128 a1 = _mm_loadu_ps(&z[o1].re);
+	const __m128 a2 = _mm_loadu_ps(&z[o2].re);
+	const __m128 a3 = _mm_loadu_ps(&z[o3].re);
+
+	// (t1, t2) and (t5, t6)
+	const __m128 t12 = _mm_add_ps(_mm_mul_ps(a2, wre), _mm_mul_ps(_mm_mul_ps(SWAP_RE_IM(a2), wim), signIm));
+	const __m128 t56 = _mm_add_ps(_mm_mul_ps(a3, wre), _mm_mul_ps(_mm_mul_ps(SWAP_RE_IM(a3), wim), signRe));
+
+	// (t5 + t1, t2 + t6) and (t2 - t6, t5 - t1)
+	const __m128 sum  = _mm_add_ps(t12, t56);
+	const __m128 diff = _mm_mul_ps(SWAP_RE_IM(_mm_sub_ps(t12, t56)), signIm);
+
+	_mm_storeu_ps(&z[0 ].re, _mm_add_ps(a0, sum));
+	_mm_storeu_ps(&z[o2].re, _mm_sub_ps(a0, sum));
+	_mm_storeu_ps(&z[o1].re, _mm_add_ps(a1, diff));
+	_mm_storeu_ps(&z[o3].re, _mm_sub_ps(a1, diff));
+}
+
+/* The same as PASS, doing the TRANSFORMs of neighbouring elements together.
+ * All inputs are loaded before storing, so this serves as the big pass as well. */
+#define PASS_SSE2(name)\
+static void name(Complex *z, const float *wre, unsigned int n)\
+{\
+	int o1 = 2*n;\
+	int o2 = 4*n;\
+	int o3 = 6*n;\
+	const float *wim = wre+o1;\
+	n--;\
+\
+	transform2(z, o1, o2, o3, _mm_set_ps(wre[1], wre[1], 1.0f, 1.0f), _mm_set_ps(wim[-1], wim[-1], 0.0f, 0.0f));\
+	do {\
+		z += 2;\
+		wre += 2;\
+		wim -= 2;\
+		transform2(z, o1, o2, o3, _mm_set_ps(wre[1], wre[1], wre[0], wre[0]), _mm_set_ps(wim[-1], wim[-1], wim[0], wim[0]));\
+	} while (--n);\
+}
+
+PASS_SSE2(pass)
+#undef BUTTERFLIES
+#define BUTTERFLIES BUTTERFLIES_BIG
+PASS_SSE2(pass_big)
+
+#else
+
 PASS(pass)
 #undef BUTTERFLIES
 #define BUTTERFLIES BUTTERFLIES_BIG
 PASS(pass_big)
 
+#endif
+
 #define DECL_FFT(t,n,n2,n4)\
 static void fft##n(Complex *z)\
 {\
@@ -183,4 +183,11 @@ uint32 DumpFile::write(const void *dataPtr, uint32 dataSize) {
 	return std::fwrite(dataPtr, 1, dataSize, _handle);
 }
 
+bool DumpFile::seek(uint32 offset) {
+	if (!_handle)
+		return false;
+
+	return std::fseek(_handle, offset, SEEK_SET) == 0;
+}
+
 } // End of namespace Common
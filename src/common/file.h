@@ -127,6 +127,12 @@ public:
 
 	uint32 write(const void *dataPtr, uint32 dataSize); // implement abstract WriteStream method
 
+	/** Move the write position to this many bytes from the start of the file.
+	 *
+	 *  @return true if the position was changed successfully, false otherwise.
+	 */
+	bool seek(uint32 offset);
+
 protected:
 	std::FILE *_handle; ///< The actual file handle.
 	int32 _size;        ///< The file's size.
@@ -76,6 +76,17 @@ uint32 FilePath::getFileSize(const UString &p) {
 	return size;
 }
 
+bool FilePath::createDirectories(const UString &p) {
+	try {
+		if (!exists(p.c_str()))
+			boost::filesystem::create_directories(p.c_str());
+	} catch (...) {
+		return false;
+	}
+
+	return isDirectory(p);
+}
+
 UString FilePath::getFile(const UString &p) {
 	path file(p.c_str());
 
@@ -63,6 +63,13 @@ public:
 	 */
 	static uint32 getFileSize(const UString &p);
 
+	/** Create a directory, including all missing parent directories.
+	 *
+	 *  @param  p The path of the directory to create.
+	 *  @return true if the directory exists afterwards, false otherwise.
+	 */
+	static bool createDirectories(const UString &p);
+
 	/** Return a file name without its path.
 	 *
 	 *  Example: "/path/to/file.ext" > "file.ext"
@@ -74,6 +74,17 @@ static inline uint64 hashStringFNV64(const Common::UString &string) {
 	return hash;
 }
 
+/** 64bit Fowler–Noll–Vo hash over a block of raw data.
+ *
+ *  Passing the result of a previous call as hash continues hashing.
+ */
+static inline uint64 hashDataFNV64(const byte *data, uint32 size, uint64 hash = 0xCBF29CE484222325LL) {
+	while (size-- > 0)
+		hash = (hash * 1099511628211LL) ^ *data++;
+
+	return hash;
+}
+
 static inline uint64 hashString(const Common::UString &string, HashAlgo algo) {
 	switch (algo) {
 		case kHashDJB2:
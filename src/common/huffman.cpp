@@ -29,6 +29,8 @@
 
 #include <cassert>
 
+#include <algorithm>
+
 #include "common/huffman.h"
 #include "common/util.h"
 #include "common/error.h"
@@ -36,7 +38,20 @@
 
 namespace Common {
 
-Huffman::Symbol::Symbol(uint32 c, uint32 s) : code(c), symbol(s) {
+Huffman::Symbol::Symbol(uint32 c, uint8 l, uint32 s) : code(c), length(l), symbol(s) {
+}
+
+
+Huffman::TableEntry::TableEntry() : value(0), length(0) {
+}
+
+
+Huffman::TableCode::TableCode(uint32 c, uint8 l, uint32 i) : code(c), length(l), index(i) {
+}
+
+
+bool Huffman::TableCode::operator<(const TableCode &c) const {
+	return length < c.length;
 }
 
 
@@ -64,18 +79,17 @@ void Huffman::init(uint8 maxLength, uint32 codeCount, const uint32 *codes,
 
 	assert(maxLength <= 32);
 
-	_codes.resize(maxLength);
-	_symbols.resize(codeCount);
+	_maxLength = maxLength;
+
+	_symbols.reserve(codeCount);
 
 	for (uint32 i = 0; i < codeCount; i++) {
+		assert((lengths[i] > 0) && (lengths[i] <= maxLength));
+
 		// The symbol. If none were specified, just assume it's identical to the code index
 		uint32 symbol = symbols ? symbols[i] : i;
 
-		// Put the code and symbol into the correct list
-		_codes[lengths[i] - 1].push_back(Symbol(codes[i], symbol));
-
-		// And put the pointer to the symbol/code struct into the symbol list.
-		_symbols[i] = &_codes[lengths[i] - 1].back();
+		_symbols.push_back(Symbol(codes[i], lengths[i], symbol));
 	}
 }
 
@@ -84,21 +98,87 @@ Huffman::~Huffman() {
 
 void Huffman::setSymbols(const uint32 *symbols) {
 	for (uint32 i = 0; i < _symbols.size(); i++)
-		_symbols[i]->symbol = symbols ? *symbols++ : i;
+		_symbols[i].symbol = symbols ? *symbols++ : i;
 }
 
-uint32 Huffman::getSymbol(BitStream &bits) const {
-	uint32 code = 0;
+const Huffman::Table &Huffman::getTable(bool msbFirst) const {
+	Table &table = _tables[msbFirst ? 1 : 0];
+	if (!table.empty())
+		return table;
 
-	for (uint32 i = 0; i < _codes.size(); i++) {
-		bits.addBit(code, i);
+	TableCodes codes;
+	codes.reserve(_symbols.size());
 
-		for (CodeList::const_iterator cCode = _codes[i].begin(); cCode != _codes[i].end(); ++cCode)
-			if (code == cCode->code)
-				return cCode->symbol;
+	for (uint32 i = 0; i < _symbols.size(); i++)
+		codes.push_back(TableCode(_symbols[i].code, _symbols[i].length, i));
+
+	// Shorter codes take precedence, like when searching the codes by length
+	std::stable_sort(codes.begin(), codes.end());
+
+	buildTable(table, MIN(_maxLength, kTableBits), codes, msbFirst);
+
+	return table;
+}
+
+void Huffman::buildTable(Table &table, uint8 tableBits, const TableCodes &codes, bool msbFirst) {
+	const uint32 offset = table.size();
+	const uint32 size   = 1 << tableBits;
+
+	table.resize(offset + size);
+
+	// The longer codes, by the value of their first tableBits bits
+	std::vector<TableCodes> longCodes(size);
+
+	for (TableCodes::const_iterator c = codes.begin(); c != codes.end(); ++c) {
+		if (c->length <= tableBits) {
+			// Fill every entry that starts with this code
+
+			const uint32 fill = 1 << (tableBits - c->length);
+			for (uint32 i = 0; i < fill; i++) {
+				const uint32 index = msbFirst ? ((c->code << (tableBits - c->length)) | i) : (c->code | (i << c->length));
+
+				TableEntry &entry = table[offset + index];
+				if (entry.length == 0) {
+					entry.value  = c->index;
+					entry.length = c->length;
+				}
+			}
+
+			continue;
+		}
+
+		// Split off the first tableBits bits
+		const uint8  restLength = c->length - tableBits;
+		const uint32 restMask   = (restLength >= 32) ? 0xFFFFFFFF : ((1 << restLength) - 1);
+
+		const uint32 prefix = msbFirst ? (c->code >> restLength) : (c->code & (size - 1));
+		const uint32 rest   = msbFirst ? (c->code & restMask)    : (c->code >> tableBits);
+
+		longCodes[prefix].push_back(TableCode(rest, restLength, c->index));
 	}
 
-	throw Exception("Unknown Huffman code");
+	for (uint32 i = 0; i < size; i++) {
+		// Skip empty entries and those already taken by shorter codes
+		if (longCodes[i].empty() || (table[offset + i].length != 0))
+			continue;
+
+		uint8 subBits = 0;
+		for (TableCodes::const_iterator c = longCodes[i].begin(); c != longCodes[i].end(); ++c)
+			subBits = MAX(subBits, c->length);
+
+		subBits = MIN(subBits, kTableBits);
+
+		const uint32 subOffset = table.size();
+		buildTable(table, subBits, longCodes[i], msbFirst);
+
+		// The table might have been reallocated
+		table[offset + i].value  = subOffset;
+		table[offset + i].length = -((int8) subBits);
+	}
+}
+
+uint32 Huffman::getSymbol(BitStream &bits) const {
+	return getSymbol<BitStream>(bits);
 }
 
 } // End of namespace Common
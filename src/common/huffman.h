@@ -31,9 +31,10 @@
 #define COMMON_HUFFMAN_H
 
 #include <vector>
-#include <list>
 
 #include "common/types.h"
+#include "common/util.h"
+#include "common/error.h"
 
 namespace Common {
 
@@ -70,26 +71,92 @@ public:
 	/** Return the next symbol in the bitstream. */
 	uint32 getSymbol(BitStream &bits) const;
 
+	/** Return the next symbol in this bit reader, without going through the virtual BitStream. */
+	template<class BitReader>
+	uint32 getSymbol(BitReader &bits) const {
+		const Table &table = getTable(bits.isMSBFirst());
+
+		uint8 tableBits = MIN(_maxLength, kTableBits);
+
+		const TableEntry *entry = &table[bits.peekBits(tableBits)];
+		while (entry->length < 0) {
+			// The code continues in the next level table
+
+			bits.skip(tableBits);
+			tableBits = -entry->length;
+
+			entry = &table[entry->value + bits.peekBits(tableBits)];
+		}
+
+		if (entry->length == 0)
+			throw Exception("Unknown Huffman code");
+
+		bits.skip(entry->length);
+
+		return _symbols[entry->value].symbol;
+	}
+
 private:
+	/** Number of bits the first level lookup table is indexed with. */
+	static const uint8 kTableBits = 9;
+
 	struct Symbol {
 		uint32 code;
+		uint8  length;
 		uint32 symbol;
 
-		Symbol(uint32 c, uint32 s);
+		Symbol(uint32 c, uint8 l, uint32 s);
 	};
 
-	typedef std::list<Symbol>     CodeList;
-	typedef std::vector<CodeList> CodeLists;
-	typedef std::vector<Symbol *> SymbolList;
+	typedef std::vector<Symbol> SymbolList;
+
+	/** An entry in the lookup tables. */
+	struct TableEntry {
+		/** Index of the symbol, or offset of the next level table. */
+		int32 value;
+		/** Length of the rest of the code, or the negated bits of the next level table. */
+		int8 length;
+
+		TableEntry();
+	};
 
-	/** Lists of codes and their symbols, sorted by code length. */
-	CodeLists _codes;
+	typedef std::vector<TableEntry> Table;
 
-	/** Sorted list of pointers to the symbols. */
+	/** A code still to be put into a lookup table. */
+	struct TableCode {
+		uint32 code;   ///< The rest of the code.
+		uint8  length; ///< The length of the rest of the code.
+		uint32 index;  ///< The index of the symbol.
+
+		TableCode(uint32 c, uint8 l, uint32 i);
+
+		/** Order by length only, so that a stable sort keeps codes of the same length in order. */
+		bool operator<(const TableCode &c) const;
+	};
+
+	typedef std::vector<TableCode> TableCodes;
+
+	/** The codes and their symbols. */
 	SymbolList _symbols;
 
+	/** The maximal code length. */
+	uint8 _maxLength;
+
+	/** Lookup tables, for bit streams handing out bits LSB first and MSB first.
+	 *
+	 *  The value of a code depends on the order the bit stream hands out
+	 *  its bits, so each order gets its own tables, built on first use.
+	 */
+	mutable Table _tables[2];
+
 	void init(uint8 maxLength, uint32 codeCount, const uint32 *codes,
 	          const uint8 *lengths, const uint32 *symbols);
+
+	/** Return the lookup tables for this bit order, building them if necessary. */
+	const Table &getTable(bool msbFirst) const;
+
+	/** Build a lookup table for these codes, at the end of the table list. */
+	static void buildTable(Table &table, uint8 tableBits, const TableCodes &codes, bool msbFirst);
 };
 
 } // End of namespace Common
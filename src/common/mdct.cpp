@@ -30,6 +30,12 @@
  *  (Inverse) Modified Discrete Cosine Transforms.
  */
 
+#include "common/system.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
 #include "common/maths.h"
 #include "common/util.h"
 #include "common/fft.h"
@@ -116,7 +122,22 @@ void MDCT::calcIMDCT(float *output, const float *input) {
 
 	calcHalfIMDCT(output + size4, input);
 
-	for (int k = 0; k < size4; k++) {
+	int k = 0;
+
+#ifdef XOREOS_SSE2
+	const __m128 sign = _mm_set1_ps(-0.0f);
+
+	for (; (k + 4) <= size4; k += 4) {
+		const __m128 a = _mm_loadu_ps(output + size2 - k - 4);
+		const __m128 b = _mm_loadu_ps(output + size2 + k);
+
+		// Mirror both halves outwards, negating the first
+		_mm_storeu_ps(output + k,             _mm_xor_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3)), sign));
+		_mm_storeu_ps(output + _size - k - 4, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)));
+	}
+#endif
+
+	for (; k < size4; k++) {
 		output[        k    ] = -output[size2 - k - 1];
 		output[_size - k - 1] =  output[size2 + k    ];
 	}
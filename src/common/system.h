@@ -116,6 +116,13 @@
 	#define GCC_PRINTF(x,y)
 #endif
 
+//
+// SIMD instruction sets we can use unconditionally
+//
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define XOREOS_SSE2
+#endif
+
 //
 // Fallbacks / default values for various special macros
 //
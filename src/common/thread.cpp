@@ -49,15 +49,28 @@ bool Thread::createThread() {
 		// Already running, nothing to do
 		return true;
 
+	// Reap a thread that has already finished on its own
+	if (_thread) {
+		SDL_WaitThread(_thread, 0);
+		_thread = 0;
+	}
+
+	// Mark the thread as running right away, so that an immediate
+	// destroyThread() still waits for it
+	_threadRunning = true;
+
 	// Try to create the thread
-	if (!(_thread = SDL_CreateThread(threadHelper, 0, (void *) this)))
+	if (!(_thread = SDL_CreateThread(threadHelper, 0, (void *) this))) {
+		_threadRunning = false;
 		return false;
+	}
 
 	return true;
 }
 
 bool Thread::destroyThread() {
-	if (!_threadRunning)
+	// A thread that has already finished on its own still needs to be joined
+	if (!_thread)
 		return true;
 
 	// Signal the thread that it should die
@@ -67,22 +80,16 @@ bool Thread::destroyThread() {
 	for (int i = 0; _threadRunning && (i < 100); i++)
 		SDL_Delay(10);
 
-	if (!_threadRunning) {
-		// Wait for everything to settle
-		SDL_WaitThread(_thread, 0);
+	const bool finishedInTime = !_threadRunning;
 
-		_killThread    = false;
-		_threadRunning = false;
-
-		return true;
-	}
-
-	/// FIXME: not sure if the thread is really killed
+	// Whatever happens, the thread's owner mustn't go away while it's still running
+	SDL_WaitThread(_thread, 0);
+	_thread = 0;
 
 	_killThread    = false;
 	_threadRunning = false;
 
-	return false;
+	return finishedInTime;
 }
 
 int Thread::threadHelper(void *obj) {
@@ -43,6 +43,11 @@ public:
 	virtual ~Thread();
 
 	bool createThread();
+
+	/** Stop the thread and wait for it to end.
+	 *
+	 *  @return false if the thread took longer than a second to end.
+	 */
 	bool destroyThread();
 
 protected:
@@ -0,0 +1,185 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/threadpool.cpp
+ *  A pool of worker threads, running batches of jobs in parallel.
+ */
+
+#include "common/threadpool.h"
+
+namespace Common {
+
+/** Time, in milliseconds, an idle worker sleeps before checking if it should quit. */
+static const uint32 kIdleWait = 100;
+
+ThreadPool::Worker::Worker(ThreadPool &pool) : _pool(&pool) {
+}
+
+ThreadPool::Worker::~Worker() {
+	destroyThread();
+}
+
+void ThreadPool::Worker::threadMethod() {
+	while (!_killThread)
+		_pool->runJob(true);
+}
+
+
+ThreadPool::ThreadPool() : _jobsAvailable(_mutex), _jobsDone(_mutex),
+	_jobs(0), _jobCount(0), _nextJob(0), _jobsLeft(0), _error(0) {
+
+}
+
+ThreadPool::~ThreadPool() {
+	deinit();
+}
+
+void ThreadPool::init(uint threadCount) {
+	deinit();
+
+	for (uint i = 0; i < threadCount; i++) {
+		Worker *worker = new Worker(*this);
+
+		if (!worker->createThread()) {
+			delete worker;
+			break;
+		}
+
+		_workers.push_back(worker);
+	}
+}
+
+void ThreadPool::deinit() {
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+
+	_workers.clear();
+}
+
+uint ThreadPool::getThreadCount() const {
+	return _workers.size();
+}
+
+void ThreadPool::run(Jobs &jobs, uint count) {
+	if (count == 0)
+		return;
+
+	if (_workers.empty() || (count == 1)) {
+		// Not worth waking anybody up for
+		for (uint i = 0; i < count; i++)
+			jobs.runJob(i);
+
+		return;
+	}
+
+	_mutex.lock();
+
+	_jobs     = &jobs;
+	_jobCount = count;
+	_nextJob  = 0;
+	_jobsLeft = count;
+
+	for (uint i = 0; (i < _workers.size()) && (i < count); i++)
+		_jobsAvailable.signal();
+
+	_mutex.unlock();
+
+	// Help out
+	while (runJob(false));
+
+	// Wait for the jobs the workers are still running
+	_mutex.lock();
+
+	while (_jobsLeft > 0)
+		_jobsDone.wait();
+
+	_jobs     = 0;
+	_jobCount = 0;
+	_nextJob  = 0;
+
+	Exception *error = _error;
+	_error = 0;
+
+	_mutex.unlock();
+
+	// Only now that no job is running anymore, pass on what went wrong
+	if (error) {
+		Exception e(*error);
+		delete error;
+
+		throw e;
+	}
+}
+
+bool ThreadPool::runJob(bool wait) {
+	_mutex.lock();
+
+	if (!_jobs || (_nextJob >= _jobCount)) {
+		if (wait)
+			_jobsAvailable.wait(kIdleWait);
+
+		_mutex.unlock();
+		return false;
+	}
+
+	Jobs *jobs = _jobs;
+	uint  job  = _nextJob++;
+
+	_mutex.unlock();
+
+	Exception *error = 0;
+
+	try {
+		jobs->runJob(job);
+	} catch (Exception &e) {
+		error = new Exception(e);
+	} catch (std::exception &e) {
+		error = new Exception(e);
+	} catch (...) {
+		error = new Exception("Unknown exception in thread pool job");
+	}
+
+	_mutex.lock();
+
+	if (error) {
+		// Remember the first error, and skip the jobs nobody has started yet
+		if (!_error)
+			_error = error;
+		else
+			delete error;
+
+		_jobsLeft -= _jobCount - _nextJob;
+		_nextJob   = _jobCount;
+	}
+
+	if (--_jobsLeft == 0)
+		_jobsDone.signal();
+
+	_mutex.unlock();
+
+	return true;
+}
+
+} // End of namespace Common
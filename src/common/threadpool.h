@@ -0,0 +1,113 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file common/threadpool.h
+ *  A pool of worker threads, running batches of jobs in parallel.
+ */
+
+#ifndef COMMON_THREADPOOL_H
+#define COMMON_THREADPOOL_H
+
+#include <vector>
+
+#include "common/types.h"
+#include "common/noncopyable.h"
+#include "common/error.h"
+#include "common/mutex.h"
+#include "common/thread.h"
+
+namespace Common {
+
+/** A pool of worker threads, running batches of jobs in parallel. */
+class ThreadPool : NonCopyable {
+public:
+	/** A batch of independent jobs. */
+	class Jobs {
+	public:
+		virtual ~Jobs() {}
+
+		/** Run the nth job of the batch. */
+		virtual void runJob(uint n) = 0;
+	};
+
+	ThreadPool();
+	~ThreadPool();
+
+	/** Start this many worker threads. */
+	void init(uint threadCount);
+	/** Stop all worker threads. */
+	void deinit();
+
+	/** Return the number of worker threads. */
+	uint getThreadCount() const;
+
+	/** Run a batch of jobs, and return once all of them are finished.
+	 *
+	 *  The calling thread works on the batch as well. The jobs must
+	 *  not touch any data another job of the same batch touches.
+	 *
+	 *  If a job throws, the jobs nobody has started yet are skipped. Once
+	 *  the jobs already running have finished, the first exception thrown
+	 *  is thrown again, as a Common::Exception, from the calling thread.
+	 */
+	void run(Jobs &jobs, uint count);
+
+private:
+	/** A thread taking jobs from the pool. */
+	class Worker : public Thread {
+	public:
+		Worker(ThreadPool &pool);
+		~Worker();
+
+	private:
+		ThreadPool *_pool;
+
+		void threadMethod();
+	};
+
+	std::vector<Worker *> _workers;
+
+	Mutex _mutex;              ///< Protects the current batch.
+	Condition _jobsAvailable;  ///< Signals that a new batch is available.
+	Condition _jobsDone;       ///< Signals that the last job of a batch finished.
+
+	Jobs *_jobs;     ///< The current batch.
+	uint _jobCount;  ///< Number of jobs in the current batch.
+	uint _nextJob;   ///< The next job nobody has taken yet.
+	uint _jobsLeft;  ///< Number of jobs that haven't finished yet.
+
+	Exception *_error; ///< The first exception a job of the current batch threw.
+
+	/** Take a job from the current batch and run it.
+	 *
+	 *  @param  wait Wait a bit for a new batch if there's no job available?
+	 *  @return true if a job was run.
+	 */
+	bool runJob(bool wait);
+};
+
+} // End of namespace Common
+
+#endif // COMMON_THREADPOOL_H
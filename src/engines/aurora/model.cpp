@@ -95,6 +95,12 @@ void freeModel(Graphics::Aurora::Model *&model) {
 	kModelLoader->free(model);
 }
 
+void freeUnusedModels() {
+	assert(kModelLoader);
+
+	kModelLoader->freeUnused();
+}
+
 } // End of namespace Engines
 
 #endif // ENGINES_AURORA_MODEL_H
@@ -49,6 +49,9 @@ Graphics::Aurora::Model *loadModelGUI   (const Common::UString &resref);
 
 void freeModel(Graphics::Aurora::Model *&model);
 
+/** Free shared model data that no model uses anymore, e.g. after unloading an area. */
+void freeUnusedModels();
+
 } // End of namespace Engines
 
 #endif // ENGINES_AURORA_MODEL_H
@@ -45,6 +45,9 @@ public:
 	virtual Graphics::Aurora::Model *load(const Common::UString &resref,
 			Graphics::Aurora::ModelType type, const Common::UString &texture) = 0;
 	virtual void free(Graphics::Aurora::Model *&model);
+
+	/** Free shared model data that no model uses anymore. */
+	virtual void freeUnused();
 };
 
 } // End of namespace Engines
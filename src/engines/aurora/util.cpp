@@ -80,12 +80,34 @@ Sound::ChannelHandle playSound(const Common::UString &sound, Sound::SoundType so
 
 	Sound::ChannelHandle channel;
 
+	// Sound effects are short and often repeated, so we keep them around decoded
+	const bool cache = soundType == Sound::kSoundTypeSFX;
+
+	// A module, HAK or override change might replace a sound with a different
+	// one of the same name. Throw out the old decoded sounds when the resources
+	// change, and cache under a name tied to the current set of resources, so
+	// that sounds still playing or recording can't come back either.
+	static uint32 cacheGeneration = 0;
+	if (cache && (cacheGeneration != ResMan.getGeneration())) {
+		cacheGeneration = ResMan.getGeneration();
+
+		SoundMan.clearSoundCache();
+	}
+
+	const Common::UString cacheName =
+		cache ? Common::UString::sprintf("%u/%s", cacheGeneration, sound.c_str()) : "";
+
 	try {
-		Common::SeekableReadStream *soundStream = ResMan.getResource(resType, sound);
-		if (!soundStream)
-			return channel;
+		if (cache)
+			channel = SoundMan.playCachedSound(cacheName, soundType, loop);
 
-		channel = SoundMan.playSoundFile(soundStream, soundType, loop);
+		if (!SoundMan.isValidChannel(channel)) {
+			Common::SeekableReadStream *soundStream = ResMan.getResource(resType, sound);
+			if (!soundStream)
+				return channel;
+
+			channel = SoundMan.playSoundFile(soundStream, soundType, loop, cacheName);
+		}
 
 		SoundMan.setChannelGain(channel, volume);
 
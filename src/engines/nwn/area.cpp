@@ -39,6 +39,7 @@
 
 #include "graphics/aurora/cursorman.h"
 #include "graphics/aurora/model.h"
+#include "graphics/aurora/staticgeometry.h"
 
 #include "sound/sound.h"
 
@@ -58,7 +59,7 @@ namespace Engines {
 namespace NWN {
 
 Area::Area(Module &module, const Common::UString &resRef) : _module(&module), _loaded(false),
-	_resRef(resRef), _visible(false), _tileset(0),
+	_resRef(resRef), _visible(false), _tileset(0), _tileGeometry(0),
 	_activeObject(0), _highlightAll(false) {
 
 	// Load ARE and GIT
@@ -87,6 +88,7 @@ Area::~Area() {
 		delete *o;
 
 	// Delete tiles and tileset
+	delete _tileGeometry;
 	for (std::vector<Tile>::iterator t = _tiles.begin(); t != _tiles.end(); ++t)
 		delete t->model;
 	delete _tileset;
@@ -214,8 +216,12 @@ void Area::show() {
 	GfxMan.lockFrame();
 
 	// Show tiles
+	if (_tileGeometry)
+		_tileGeometry->show();
+
 	for (std::vector<Tile>::iterator t = _tiles.begin(); t != _tiles.end(); ++t)
-		t->model->show();
+		if (t->drawModel)
+			t->model->show();
 
 	// Show objects
 	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o)
@@ -248,6 +254,9 @@ void Area::hide() {
 	for (std::vector<Tile>::iterator t = _tiles.begin(); t != _tiles.end(); ++t)
 		t->model->hide();
 
+	if (_tileGeometry)
+		_tileGeometry->hide();
+
 	GfxMan.unlockFrame();
 
 	unloadModels();
@@ -375,6 +384,8 @@ void Area::loadTile(const Aurora::GFFStruct &t, Tile &tile) {
 
 	tile.tile  = 0;
 	tile.model = 0;
+
+	tile.drawModel = true;
 }
 
 void Area::loadModels() {
@@ -457,9 +468,27 @@ void Area::loadTiles() {
 			t.model->setRotation(0.0, 0.0, -(((int) t.orientation) * 90.0));
 		}
 	}
+
+	mergeTiles();
+}
+
+void Area::mergeTiles() {
+	/* Draw the static parts of all tiles together, sorted by texture, instead
+	 * of each tile model drawing its nodes one by one. Tiles that don't have
+	 * anything left to draw on their own aren't shown at all. */
+
+	_tileGeometry = new Graphics::Aurora::StaticGeometry;
+
+	for (std::vector<Tile>::iterator t = _tiles.begin(); t != _tiles.end(); ++t)
+		t->drawModel = _tileGeometry->addModel(*t->model);
+
+	_tileGeometry->finalize();
 }
 
 void Area::unloadTiles() {
+	delete _tileGeometry;
+	_tileGeometry = 0;
+
 	for (uint32 y = 0; y < _height; y++) {
 		for (uint32 x = 0; x < _width; x++) {
 			uint32 n = y * _width + x;
@@ -470,6 +499,8 @@ void Area::unloadTiles() {
 
 			delete t.model;
 			t.model = 0;
+
+			t.drawModel = true;
 		}
 	}
 }
@@ -144,6 +144,8 @@ private:
 		const Tileset::Tile *tile; ///< The actual tile within the tileset.
 
 		Graphics::Aurora::Model *model; ///< The tile's model.
+
+		bool drawModel; ///< Does the model have anything to draw besides its merged geometry?
 	};
 
 	typedef std::list<Engines::NWN::Object *> ObjectList;
@@ -189,6 +191,9 @@ private:
 
 	std::vector<Tile> _tiles; ///< The area's tiles.
 
+	/** The static geometry of all tiles, merged. */
+	Graphics::Aurora::StaticGeometry *_tileGeometry;
+
 	ObjectList _objects;   ///< List of all objects in the area.
 	ObjectMap  _objectMap; ///< Map of all non-static objects in the area.
 
@@ -224,6 +229,7 @@ private:
 	void unloadModels();
 
 	void loadTileModels();
+	void mergeTiles();
 	void unloadTileModels();
 
 	void loadTileset();
@@ -41,9 +41,29 @@ namespace Engines {
 
 namespace NWN {
 
+NWNModelLoader::~NWNModelLoader() {
+	// All instances have been destroyed together with the engine by now
+	for (ModelMap::iterator m = _instanceSources.begin(); m != _instanceSources.end(); ++m)
+		delete m->second;
+}
+
 Graphics::Aurora::Model *NWNModelLoader::load(const Common::UString &resref,
 		Graphics::Aurora::ModelType type, const Common::UString &texture) {
 
+	// Objects using the same model only need to load it once
+	if (type == Graphics::Aurora::kModelTypeObject) {
+		const Common::UString key = resref + "/" + texture;
+
+		ModelMap::iterator source = _instanceSources.find(key);
+		if (source == _instanceSources.end()) {
+			Graphics::Aurora::Model *model = new Graphics::Aurora::Model_NWN(resref, type, texture, &modelCache, true);
+
+			source = _instanceSources.insert(std::make_pair(key, model)).first;
+		}
+
+		return source->second->createInstance();
+	}
+
 	Graphics::Aurora::Model *model = 0;
 	try {
 		model = new Graphics::Aurora::Model_NWN(resref, type, texture, &modelCache);
@@ -59,6 +79,18 @@ Graphics::Aurora::Model *NWNModelLoader::load(const Common::UString &resref,
 	return model;
 }
 
+void NWNModelLoader::freeUnused() {
+	for (ModelMap::iterator m = _instanceSources.begin(); m != _instanceSources.end(); ) {
+		if (m->second->getInstanceCount() > 0) {
+			++m;
+			continue;
+		}
+
+		delete m->second;
+		_instanceSources.erase(m++);
+	}
+}
+
 } // End of namespace NWN
 
 } // End of namespace Engines
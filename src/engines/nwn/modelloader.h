@@ -30,6 +30,10 @@
 #ifndef ENGINES_NWN_MODELLOADER_H
 #define ENGINES_NWN_MODELLOADER_H
 
+#include <map>
+
+#include "common/ustring.h"
+
 #include "engines/aurora/modelloader.h"
 
 namespace Engines {
@@ -38,10 +42,25 @@ namespace NWN {
 
 class NWNModelLoader : public ModelLoader {
 public:
+	~NWNModelLoader();
+
 	Graphics::Aurora::Model *load(const Common::UString &resref,
 			Graphics::Aurora::ModelType type, const Common::UString &texture);
 
+	/** Free the object models no instance uses anymore. */
+	void freeUnused();
+
 	std::map<Common::UString, Graphics::Aurora::Model*, Common::UString::iless> modelCache;
+
+private:
+	typedef std::map<Common::UString, Graphics::Aurora::Model *, Common::UString::iless> ModelMap;
+
+	/** Loaded object models, which all further objects with the same model are instances of.
+	 *
+	 *  They're kept while no instance exists, so that an object can be
+	 *  destroyed and recreated cheaply, and freed by freeUnused().
+	 */
+	ModelMap _instanceSources;
 };
 
 } // End of namespace NWN
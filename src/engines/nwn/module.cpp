@@ -38,12 +38,15 @@
 #include "aurora/talkman.h"
 #include "aurora/erffile.h"
 
+#include "graphics/graphics.h"
 #include "graphics/camera.h"
+#include "graphics/benchmark.h"
 
 #include "graphics/aurora/textureman.h"
 #include "graphics/aurora/model.h"
 
 #include "engines/aurora/util.h"
+#include "engines/aurora/model.h"
 #include "engines/aurora/tokenman.h"
 #include "engines/aurora/resources.h"
 
@@ -417,6 +420,30 @@ void Module::run() {
 	EventMan.enableKeyRepeat(0);
 }
 
+bool Module::runBenchmark(const Common::UString &area, Graphics::Benchmark &benchmark) {
+	if (!enter())
+		return false;
+
+	if (!area.empty())
+		_newArea = area;
+
+	enterArea();
+	if (_exit)
+		return false;
+
+	// The render thread drives the benchmark, we just wait for it to finish
+	GfxMan.setBenchmark(&benchmark);
+
+	while (!EventMan.quitRequested() && !benchmark.isFinished()) {
+		EventMan.flushEvents();
+		EventMan.delay(10);
+	}
+
+	GfxMan.setBenchmark(0);
+
+	return benchmark.isFinished();
+}
+
 void Module::handleEvents() {
 	Events::Event event;
 	while (EventMan.pollEvent(event)) {
@@ -556,6 +583,8 @@ void Module::unloadPC() {
 
 	delete _pc;
 	_pc = 0;
+
+	freeUnusedModels();
 }
 
 void Module::loadHAKs() {
@@ -642,6 +671,9 @@ void Module::unloadAreas() {
 	_newArea.clear();
 
 	_currentArea = 0;
+
+	// The area objects were the only users of most object models
+	freeUnusedModels();
 }
 
 void Module::showMenu() {
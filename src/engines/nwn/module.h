@@ -45,6 +45,10 @@
 
 #include "events/types.h"
 
+namespace Graphics {
+	class Benchmark;
+}
+
 #include "engines/nwn/ifofile.h"
 #include "engines/nwn/creature.h"
 
@@ -78,6 +82,9 @@ public:
 
 	void run();
 
+	/** Enter the module and measure rendering the area (or the entry area, if empty). */
+	bool runBenchmark(const Common::UString &area, Graphics::Benchmark &benchmark);
+
 
 	void showMenu();
 
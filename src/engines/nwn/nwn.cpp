@@ -34,6 +34,7 @@
 #include "common/filepath.h"
 #include "common/stream.h"
 #include "common/configman.h"
+#include "common/file.h"
 
 #include "aurora/resman.h"
 #include "aurora/talkman.h"
@@ -42,6 +43,8 @@
 
 #include "events/events.h"
 
+#include "graphics/benchmark.h"
+
 #include "graphics/aurora/cursorman.h"
 #include "graphics/aurora/fontman.h"
 #include "graphics/aurora/fps.h"
@@ -130,6 +133,15 @@ void NWNEngine::run(const Common::UString &target) {
 
 	status("Successfully initialized the engine");
 
+	// Measure the render performance instead of starting the game
+	const Common::UString benchmark = ConfigMan.getString("benchmark");
+	if (!benchmark.empty()) {
+		runBenchmark(benchmark);
+
+		deinit();
+		return;
+	}
+
 	CursorMan.hideCursor();
 	CursorMan.set();
 
@@ -464,6 +476,82 @@ void NWNEngine::mainMenuLoop() {
 	delete legal;
 }
 
+void NWNEngine::runBenchmark(Common::UString moduleFile) {
+	if (!hasModule(moduleFile)) {
+		warning("Benchmark: No such module \"%s\"", moduleFile.c_str());
+		EventMan.requestQuit();
+		return;
+	}
+
+	Common::UString pc = ConfigMan.getString("benchmarkpc");
+	if (pc.empty()) {
+		std::vector<Common::UString> characters;
+		getCharacters(characters, true);
+
+		if (characters.empty()) {
+			warning("Benchmark: No local characters");
+			EventMan.requestQuit();
+			return;
+		}
+
+		pc = characters.front();
+	}
+
+	Graphics::Benchmark benchmark(MAX(ConfigMan.getInt("benchmarkframes", 600), 1));
+
+	const Common::UString path = ConfigMan.getString("benchmarkpath");
+	if (!path.empty()) {
+		Common::File pathFile;
+		if (!pathFile.open(path)) {
+			warning("Benchmark: Can't open camera path \"%s\"", path.c_str());
+			EventMan.requestQuit();
+			return;
+		}
+
+		try {
+			benchmark.loadCameraPath(pathFile);
+		} catch (Common::Exception &e) {
+			e.add("Failed loading camera path \"%s\"", path.c_str());
+			printException(e, "WARNING: ");
+			EventMan.requestQuit();
+			return;
+		}
+	}
+
+	Console console;
+	Module module(console);
+
+	_scriptFuncs->setModule(&module);
+	console.setModule(&module);
+
+	CursorMan.hideCursor();
+
+	if (module.loadModule(moduleFile) && module.usePC(pc, true)) {
+		status("Benchmark: Rendering module \"%s\" with character \"%s\"", moduleFile.c_str(), pc.c_str());
+
+		if (module.runBenchmark(ConfigMan.getString("benchmarkarea"), benchmark)) {
+			benchmark.printSummary();
+
+			const Common::UString report = ConfigMan.getString("benchmarkreport");
+			if (!report.empty()) {
+				Common::DumpFile reportFile;
+				if (reportFile.open(report)) {
+					benchmark.writeReport(reportFile);
+					reportFile.flush();
+				} else
+					warning("Benchmark: Can't write report \"%s\"", report.c_str());
+			}
+		}
+	}
+
+	module.clear();
+
+	_scriptFuncs->setModule(0);
+	console.setModule();
+
+	EventMan.requestQuit();
+}
+
 void NWNEngine::getModules(std::vector<Common::UString> &modules) {
 	modules.clear();
 
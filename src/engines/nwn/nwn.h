@@ -124,6 +124,8 @@ private:
 	void stopMenuMusic();
 
 	void mainMenuLoop();
+
+	void runBenchmark(Common::UString moduleFile);
 };
 
 } // End of namespace NWN
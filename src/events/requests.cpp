@@ -53,7 +53,7 @@ void RequestManager::init() {
 
 void RequestManager::deinit() {
 	if (!destroyThread())
-		warning("RequestManager::deinit(): Requests thread had to be killed");
+		warning("RequestManager::deinit(): Requests thread took too long to stop");
 
 	clearList();
 }
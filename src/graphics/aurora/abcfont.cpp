@@ -76,6 +76,21 @@ void ABCFont::draw(uint32 c) const {
 	glTranslatef(cC.width + cC.spaceR, 0.0, 0.0);
 }
 
+void ABCFont::getCharQuad(uint32 c, CharQuad &quad) const {
+	const Char &cC = findChar(c);
+
+	quad.texture = &_texture.getTexture();
+
+	for (int i = 0; i < 4; i++) {
+		quad.vX[i] = cC.vX[i] + cC.spaceL;
+		quad.vY[i] = cC.vY[i];
+		quad.tX[i] = cC.tX[i];
+		quad.tY[i] = cC.tY[i];
+	}
+
+	quad.advance = cC.spaceL + cC.width + cC.spaceR;
+}
+
 void ABCFont::load(const Common::UString &name) {
 	Common::SeekableReadStream *abc = ResMan.getResource(name, ::Aurora::kFileTypeABC);
 	if (!abc)
@@ -55,6 +55,7 @@ public:
 	float getHeight()         const;
 
 	void draw(uint32 c) const;
+	void getCharQuad(uint32 c, CharQuad &quad) const;
 
 private:
 	/** A font character. */
@@ -71,16 +71,36 @@ void Animation::setTransTime(float transtime) {
 	_transtime = transtime;
 }
 
-void Animation::update(Model *model, float lastFrame, float nextFrame) {
+void Animation::bind(Model &model, std::vector<ModelNode *> &targets) const {
+	targets.clear();
+	targets.reserve(nodeList.size());
+
+	/* Only bind to the model's own nodes. Nodes of the supermodel are never
+	 * drawn, and the supermodel is shared between all models using it, so
+	 * models animating in parallel must not write into it. */
+	for (NodeList::const_iterator n = nodeList.begin(); n != nodeList.end(); ++n)
+		targets.push_back((*n)->_nodedata ? model.getOwnNode((*n)->getName()) : 0);
+}
+
+void Animation::update(const std::vector<ModelNode *> &targets, float lastFrame,
+                       float nextFrame, float scale) {
 	// TODO: Also need to fire off associated events
 	//       for event in _events event->fire()
 
+	assert(targets.size() == nodeList.size());
+
+	std::vector<ModelNode *>::const_iterator t = targets.begin();
+	for (NodeList::const_iterator n = nodeList.begin(); n != nodeList.end(); ++n, ++t)
+		if (*t)
+			(*n)->update(**t, nextFrame, scale);
+}
+
+bool Animation::animatesNode(const Common::UString &node) const {
+	NodeMap::const_iterator n = nodeMap.find(node);
+	if (n == nodeMap.end())
+		return false;
 
-	float scale = model->getAnimationScale(_name);
-	for (NodeList::iterator n = nodeList.begin();
-	     n != nodeList.end(); ++n) {
-		(*n)->update(model, lastFrame, nextFrame, scale);
-	}
+	return n->second->hasKeyFrames();
 }
 
 void Animation::addAnimNode(AnimNode *node) {
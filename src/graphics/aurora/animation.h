@@ -53,6 +53,7 @@ namespace Graphics {
 namespace Aurora {
 
 class AnimNode;
+class ModelNode;
 
 class Animation {
 public:
@@ -81,8 +82,16 @@ public:
 	float getLength() const;
 	void setTransTime(float transtime);
 
-	void update(Model *model, float lastFrame, float nextFrame);
+	/** Find the model's nodes this animation's nodes apply to. */
+	void bind(Model &model, std::vector<ModelNode *> &targets) const;
+	/** Update the bound nodes, as returned by bind(). */
+	void update(const std::vector<ModelNode *> &targets, float lastFrame, float nextFrame, float scale);
 	void addAnimNode(AnimNode *node);
+
+	/** Does this animation move the node with this name? */
+	bool animatesNode(const Common::UString &node) const;
+
+	friend class CachedModel;
 };
 
 } // End of namespace Aurora
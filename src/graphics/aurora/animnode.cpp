@@ -27,6 +27,8 @@
  *  A node within a 3D model.
  */
 
+#include <algorithm>
+
 #include "common/util.h"
 #include "common/maths.h"
 
@@ -40,12 +42,62 @@ namespace Graphics {
 namespace Aurora {
 
 
+/** Find the keyframe to interpolate from: the last one before that time. */
+static uint32 findKeyFrame(const std::vector<float> &times, float time) {
+	const uint32 next = std::lower_bound(times.begin(), times.end(), time) - times.begin();
+
+	return (next > 0) ? (next - 1) : 0;
+}
+
 AnimNode::AnimNode(ModelNode *modelnode) :
 	_parent(0) {
 	// Actual data is loaded as a generic modelnode
 	_nodedata = modelnode;
-	if (modelnode)
-		_name = modelnode->getName();
+
+	_position[0] = _position[1] = _position[2] = 0.0f;
+	_orientation[0] = _orientation[1] = _orientation[2] = _orientation[3] = 0.0f;
+
+	if (!modelnode)
+		return;
+
+	_name = modelnode->getName();
+
+	modelnode->getPosition(_position[0], _position[1], _position[2]);
+	modelnode->getOrientation(_orientation[0], _orientation[1], _orientation[2], _orientation[3]);
+
+	// Copy the keyframes, so that they can be evaluated with less cache misses
+
+	const std::vector<PositionKeyFrame> &pos = modelnode->_positionFrames;
+	if (pos.size() >= 2) {
+		_posTime.resize(pos.size());
+		_posX.resize(pos.size());
+		_posY.resize(pos.size());
+		_posZ.resize(pos.size());
+
+		for (uint32 i = 0; i < pos.size(); i++) {
+			_posTime[i] = pos[i].time;
+			_posX[i]    = pos[i].x;
+			_posY[i]    = pos[i].y;
+			_posZ[i]    = pos[i].z;
+		}
+	}
+
+	const std::vector<QuaternionKeyFrame> &ori = modelnode->_orientationFrames;
+	if (ori.size() >= 2) {
+		_oriTime.resize(ori.size());
+		_oriX.resize(ori.size());
+		_oriY.resize(ori.size());
+		_oriZ.resize(ori.size());
+		_oriQ.resize(ori.size());
+
+		for (uint32 i = 0; i < ori.size(); i++) {
+			_oriTime[i] = ori[i].time;
+			_oriX[i]    = ori[i].x;
+			_oriY[i]    = ori[i].y;
+			_oriZ[i]    = ori[i].z;
+			_oriQ[i]    = ori[i].q;
+		}
+	}
 }
 
 AnimNode::~AnimNode() {
@@ -67,24 +119,76 @@ const Common::UString &AnimNode::getName() const {
 	return _name;
 }
 
-void AnimNode::update(Model *model, float lastFrame, float nextFrame, float scale) {
-	if (!_nodedata)
+bool AnimNode::hasKeyFrames() const {
+	return !_posTime.empty() || !_oriTime.empty();
+}
+
+void AnimNode::interpolatePosition(float time, float &x, float &y, float &z) const {
+	// If less than 2 keyframes, don't interpolate, just return the only position
+	if (_posTime.empty()) {
+		x = _position[0];
+		y = _position[1];
+		z = _position[2];
 		return;
+	}
+
+	const uint32 last = findKeyFrame(_posTime, time);
+	const uint32 next = last + 1;
 
-	ModelNode *target = model->getNode(_name);
-	if (!target)
+	if ((next >= _posTime.size()) || (_posTime[last] >= time)) {
+		x = _posX[last];
+		y = _posY[last];
+		z = _posZ[last];
 		return;
+	}
+
+	const float f = (time - _posTime[last]) / (_posTime[next] - _posTime[last]);
+	x = f * _posX[next] + (1.0f - f) * _posX[last];
+	y = f * _posY[next] + (1.0f - f) * _posY[last];
+	z = f * _posZ[next] + (1.0f - f) * _posZ[last];
+}
+
+void AnimNode::interpolateOrientation(float time, float &x, float &y, float &z, float &a) const {
+	// If less than 2 keyframes, don't interpolate just return the only orientation
+	if (_oriTime.empty()) {
+		x = _orientation[0];
+		y = _orientation[1];
+		z = _orientation[2];
+		a = _orientation[3];
+		return;
+	}
+
+	const uint32 last = findKeyFrame(_oriTime, time);
+	const uint32 next = last + 1;
+
+	if ((next >= _oriTime.size()) || (_oriTime[last] >= time)) {
+		x = _oriX[last];
+		y = _oriY[last];
+		z = _oriZ[last];
+		a = Common::rad2deg(acos(_oriQ[last]) * 2.0);
+		return;
+	}
+
+	const float f = (time - _oriTime[last]) / (_oriTime[next] - _oriTime[last]);
+	x = f * _oriX[next] + (1.0f - f) * _oriX[last];
+	y = f * _oriY[next] + (1.0f - f) * _oriY[last];
+	z = f * _oriZ[next] + (1.0f - f) * _oriZ[last];
+
+	const float q = f * _oriQ[next] + (1.0f - f) * _oriQ[last];
+	a = Common::rad2deg(acos(q) * 2.0);
+}
 
+void AnimNode::update(ModelNode &target, float time, float scale) const {
 	// Determine the corresponding keyframes
 	float posX, posY, posZ;
-	_nodedata->interpolatePosition(nextFrame, posX, posY, posZ);
+	interpolatePosition(time, posX, posY, posZ);
 
 	float oX, oY, oZ, oA;
-	_nodedata->interpolateOrientation(nextFrame, oX, oY, oZ, oA);
+	interpolateOrientation(time, oX, oY, oZ, oA);
 
 	// Update the position/orientation of corresponding modelnode
-	target->setPosition(posX * scale, posY * scale, posZ * scale);
-	target->setOrientation(oX, oY, oZ, oA);
+	target.setAnimationPosition(posX * scale, posY * scale, posZ * scale);
+	target.setAnimationOrientation(oX, oY, oZ, oA);
 }
 
 } // End of namespace Aurora
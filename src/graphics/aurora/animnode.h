@@ -56,8 +56,11 @@ public:
 	/** Get the node's name. */
 	const Common::UString &getName() const;
 
-	/** Update the model properties interpolating between frames */
-	void update(Model *model, float lastFrame, float nextFrame, float scale);
+	/** Does this node have any keyframes to interpolate between? */
+	bool hasKeyFrames() const;
+
+	/** Update the target node's properties, interpolating between keyframes. */
+	void update(ModelNode &target, float time, float scale) const;
 protected:
 	// Animation *_animation; ///< The animation this node belongs to.
 
@@ -67,6 +70,17 @@ protected:
 	Common::UString _name; ///< The node's name.
 	ModelNode *_nodedata;
 
+	/** Keyframes for position animation, in structure-of-arrays form. */
+	std::vector<float> _posTime, _posX, _posY, _posZ;
+	/** Keyframes for orientation animation, in structure-of-arrays form. */
+	std::vector<float> _oriTime, _oriX, _oriY, _oriZ, _oriQ;
+
+	float _position[3];    ///< Static position, if there's no position animation.
+	float _orientation[4]; ///< Static orientation, if there's no orientation animation.
+
+	void interpolatePosition(float time, float &x, float &y, float &z) const;
+	void interpolateOrientation(float time, float &x, float &y, float &z, float &a) const;
+
 public:
 	// General helpers
 
@@ -79,6 +93,7 @@ public:
 
 
 	friend class Animation;
+	friend class CachedModel;
 };
 
 } // End of namespace Aurora
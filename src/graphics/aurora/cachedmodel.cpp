@@ -0,0 +1,567 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/cachedmodel.cpp
+ *  Fully loaded model data, as stored in the on-disk model cache.
+ */
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+
+#include "graphics/aurora/cachedmodel.h"
+#include "graphics/aurora/model.h"
+#include "graphics/aurora/modelnode.h"
+#include "graphics/aurora/animation.h"
+#include "graphics/aurora/animnode.h"
+
+static const uint32 kCacheID = MKTAG('X', 'M', 'D', 'L');
+
+static const uint32 kNoNode = 0xFFFFFFFF;
+
+namespace Graphics {
+
+namespace Aurora {
+
+static void writeString(Common::WriteStream &cache, const Common::UString &str) {
+	cache.writeString(str);
+	cache.writeByte(0);
+}
+
+static void writeFloats(Common::WriteStream &cache, const float *values, uint32 count) {
+	while (count-- > 0)
+		cache.writeIEEEFloatLE(*values++);
+}
+
+static void readFloats(Common::SeekableReadStream &cache, float *values, uint32 count) {
+	while (count-- > 0)
+		*values++ = cache.readIEEEFloatLE();
+}
+
+static uint32 readCount(Common::SeekableReadStream &cache, uint32 elementSize) {
+	const uint32 count = cache.readUint32LE();
+
+	// Make sure broken files can't make us allocate huge amounts of memory
+	if ((elementSize > 0) && (count > ((uint32) (cache.size() - cache.pos()) / elementSize)))
+		throw Common::Exception(Common::kReadError);
+
+	return count;
+}
+
+static uint32 getIndexSize(GLenum type) {
+	switch (type) {
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+			return 4;
+		default:
+			break;
+	}
+
+	throw Common::Exception("Unsupported index type 0x%X", (uint) type);
+}
+
+void CachedModel::load(Model &model, Common::SeekableReadStream &cache, uint64 hash) {
+	std::vector<Model::State *> states;
+	std::vector<ModelNode *>    nodes;
+	std::vector<Animation *>    animations;
+
+	try {
+
+		// Read the whole file in one go, and then take it apart in memory
+		const uint32 size = cache.size();
+		if (size < 20)
+			throw Common::Exception("File too small");
+
+		byte *data = new byte[size];
+		Common::MemoryReadStream stream(data, size, true);
+
+		if (!cache.seek(0) || (cache.read(data, size) != size))
+			throw Common::Exception(Common::kReadError);
+
+		if (stream.readUint32BE() != kCacheID)
+			throw Common::Exception("Not a model cache file");
+
+		const uint32 version = stream.readUint32LE();
+		if (version != kVersion)
+			throw Common::Exception("Unsupported model cache version %d", version);
+
+		if (stream.readUint64LE() != hash)
+			throw Common::Exception("Model cache hash mismatch");
+
+		Common::UString name, superModelName;
+		name.readASCII(stream);
+		superModelName.readASCII(stream);
+
+		const float animationScale = stream.readIEEEFloatLE();
+
+		// Create all nodes up-front, so that they can reference each other
+
+		const uint32 nodeCount = readCount(stream, 4);
+
+		nodes.reserve(nodeCount);
+		for (uint32 i = 0; i < nodeCount; i++)
+			nodes.push_back(new ModelNode(model));
+
+		const uint32 stateCount = readCount(stream, 4);
+
+		uint32 nodeIndex = 0;
+		for (uint32 i = 0; i < stateCount; i++) {
+			Model::State *state = new Model::State;
+			states.push_back(state);
+
+			state->name.readASCII(stream);
+
+			const uint32 stateNodeCount = stream.readUint32LE();
+			if (stateNodeCount > (nodeCount - nodeIndex))
+				throw Common::Exception(Common::kReadError);
+
+			for (uint32 j = 0; j < stateNodeCount; j++, nodeIndex++) {
+				ModelNode *node = nodes[nodeIndex];
+
+				loadNode(stream, *node, nodes);
+
+				state->nodeList.push_back(node);
+				state->nodeMap.insert(std::make_pair(node->getName(), node));
+
+				if (!node->getParent())
+					state->rootNodes.push_back(node);
+			}
+		}
+
+		if (nodeIndex != nodeCount)
+			throw Common::Exception("Nodes outside of states");
+
+		const uint32 animationCount = readCount(stream, 4);
+
+		for (uint32 i = 0; i < animationCount; i++) {
+			Animation *anim = new Animation;
+			animations.push_back(anim);
+
+			Common::UString animName;
+			animName.readASCII(stream);
+
+			anim->setName(animName);
+			anim->setLength(stream.readIEEEFloatLE());
+			anim->setTransTime(stream.readIEEEFloatLE());
+
+			const uint32 animNodeCount = readCount(stream, 4);
+			for (uint32 j = 0; j < animNodeCount; j++) {
+				const uint32 index = stream.readUint32LE();
+				if ((index != kNoNode) && (index >= nodes.size()))
+					throw Common::Exception(Common::kReadError);
+
+				anim->addAnimNode(new AnimNode((index != kNoNode) ? nodes[index] : 0));
+			}
+		}
+
+		if (stream.err())
+			throw Common::Exception(Common::kReadError);
+
+		// Everything's there, hand it over to the model
+
+		model._name           = name;
+		model._superModelName = superModelName;
+		model._animationScale = animationScale;
+
+		for (std::vector<Model::State *>::iterator s = states.begin(); s != states.end(); ++s) {
+			model._stateList.push_back(*s);
+			model._stateMap.insert(std::make_pair((*s)->name, *s));
+		}
+
+		if (!model._currentState && !states.empty())
+			model._currentState = states.front();
+
+		for (std::vector<Animation *>::iterator a = animations.begin(); a != animations.end(); ++a)
+			model._animationMap.insert(std::make_pair((*a)->getName(), *a));
+
+	} catch (Common::Exception &e) {
+		for (std::vector<Animation *>::iterator a = animations.begin(); a != animations.end(); ++a)
+			delete *a;
+		for (std::vector<ModelNode *>::iterator n = nodes.begin(); n != nodes.end(); ++n)
+			delete *n;
+		for (std::vector<Model::State *>::iterator s = states.begin(); s != states.end(); ++s)
+			delete *s;
+
+		e.add("Failed reading cached model");
+		throw;
+	}
+}
+
+void CachedModel::loadNode(Common::SeekableReadStream &cache, ModelNode &node,
+                           const std::vector<ModelNode *> &nodes) {
+
+	node._name.readASCII(cache);
+
+	node._level = cache.readUint32LE();
+
+	const uint32 parent = cache.readUint32LE();
+	if (parent != kNoNode) {
+		if (parent >= nodes.size())
+			throw Common::Exception(Common::kReadError);
+
+		node._parent = nodes[parent];
+	}
+
+	const uint32 childCount = readCount(cache, 4);
+	for (uint32 i = 0; i < childCount; i++) {
+		const uint32 child = cache.readUint32LE();
+		if (child >= nodes.size())
+			throw Common::Exception(Common::kReadError);
+
+		node._children.push_back(nodes[child]);
+	}
+
+	readFloats(cache, node._center     , 3);
+	readFloats(cache, node._position   , 3);
+	readFloats(cache, node._rotation   , 3);
+	readFloats(cache, node._orientation, 4);
+
+	node._positionFrames.resize(readCount(cache, 16));
+	for (std::vector<PositionKeyFrame>::iterator p = node._positionFrames.begin();
+	     p != node._positionFrames.end(); ++p) {
+
+		p->time = cache.readIEEEFloatLE();
+		p->x    = cache.readIEEEFloatLE();
+		p->y    = cache.readIEEEFloatLE();
+		p->z    = cache.readIEEEFloatLE();
+	}
+
+	node._orientationFrames.resize(readCount(cache, 20));
+	for (std::vector<QuaternionKeyFrame>::iterator o = node._orientationFrames.begin();
+	     o != node._orientationFrames.end(); ++o) {
+
+		o->time = cache.readIEEEFloatLE();
+		o->x    = cache.readIEEEFloatLE();
+		o->y    = cache.readIEEEFloatLE();
+		o->z    = cache.readIEEEFloatLE();
+		o->q    = cache.readIEEEFloatLE();
+	}
+
+	readFloats(cache, node._wirecolor, 3);
+	readFloats(cache, node._ambient  , 3);
+	readFloats(cache, node._diffuse  , 3);
+	readFloats(cache, node._specular , 3);
+	readFloats(cache, node._selfIllum, 3);
+
+	node._shininess = cache.readIEEEFloatLE();
+
+	node._isTransparent       = cache.readByte() != 0;
+	node._dangly              = cache.readByte() != 0;
+	node._showdispl           = cache.readByte() != 0;
+	node._render              = cache.readByte() != 0;
+	node._shadow              = cache.readByte() != 0;
+	node._beaming             = cache.readByte() != 0;
+	node._inheritcolor        = cache.readByte() != 0;
+	node._rotatetexture       = cache.readByte() != 0;
+	node._hasTransparencyHint = cache.readByte() != 0;
+	node._transparencyHint    = cache.readByte() != 0;
+
+	node._period       = cache.readIEEEFloatLE();
+	node._tightness    = cache.readIEEEFloatLE();
+	node._displacement = cache.readIEEEFloatLE();
+	node._displtype    = cache.readSint32LE();
+
+	node._constraints.resize(readCount(cache, 4));
+	for (std::vector<float>::iterator c = node._constraints.begin(); c != node._constraints.end(); ++c)
+		*c = cache.readIEEEFloatLE();
+
+	node._skinBones.resize(readCount(cache, 1));
+	for (std::vector<Common::UString>::iterator b = node._skinBones.begin(); b != node._skinBones.end(); ++b)
+		b->readASCII(cache);
+
+	node._skinBoneIndices.resize(readCount(cache, 1));
+	if (!node._skinBoneIndices.empty())
+		cache.read(&node._skinBoneIndices[0], node._skinBoneIndices.size());
+
+	node._skinWeights.resize(readCount(cache, 4));
+	for (std::vector<float>::iterator w = node._skinWeights.begin(); w != node._skinWeights.end(); ++w)
+		*w = cache.readIEEEFloatLE();
+
+	node._tilefade = cache.readSint32LE();
+	node._scale    = cache.readIEEEFloatLE();
+	node._alpha    = cache.readIEEEFloatLE();
+
+	if (cache.readByte() != 0) {
+		float bound[6];
+		readFloats(cache, bound, 6);
+
+		node._boundBox.add(bound[0], bound[1], bound[2]);
+		node._boundBox.add(bound[3], bound[4], bound[5]);
+	}
+
+
+	// Vertex buffer
+
+	const uint32 vertexCount = cache.readUint32LE();
+	const uint32 vertexSize  = cache.readUint32LE();
+
+	if ((vertexSize > 0) && (vertexCount > ((uint32) (cache.size() - cache.pos()) / vertexSize)))
+		throw Common::Exception(Common::kReadError);
+
+	node._vertexBuffer.setSize(vertexCount, vertexSize);
+
+	byte *vertexData = (byte *) node._vertexBuffer.getData();
+
+	VertexDecl vertexDecl;
+	vertexDecl.resize(readCount(cache, 20));
+	for (VertexDecl::iterator v = vertexDecl.begin(); v != vertexDecl.end(); ++v) {
+		v->index  = cache.readUint32LE();
+		v->size   = cache.readSint32LE();
+		v->type   = cache.readUint32LE();
+		v->stride = cache.readSint32LE();
+
+		const uint32 offset = cache.readUint32LE();
+		if (offset > (vertexCount * vertexSize))
+			throw Common::Exception(Common::kReadError);
+
+		v->pointer = vertexData + offset;
+	}
+
+	node._vertexBuffer.setVertexDecl(vertexDecl);
+
+	if (vertexData)
+		cache.read(vertexData, vertexCount * vertexSize);
+
+
+	// Index buffer
+
+	const uint32 indexCount = cache.readUint32LE();
+	const GLenum indexType  = cache.readUint32LE();
+
+	if (indexCount > 0) {
+		const uint32 indexSize = getIndexSize(indexType);
+		if (indexCount > ((uint32) (cache.size() - cache.pos()) / indexSize))
+			throw Common::Exception(Common::kReadError);
+
+		node._indexBuffer.setSize(indexCount, indexSize, indexType);
+		cache.read(node._indexBuffer.getData(), indexCount * indexSize);
+	}
+
+
+	// Textures. Loading them also works out the node's transparency again
+
+	std::vector<Common::UString> textures;
+	textures.resize(readCount(cache, 1));
+	for (std::vector<Common::UString>::iterator t = textures.begin(); t != textures.end(); ++t)
+		t->readASCII(cache);
+
+	if (!textures.empty())
+		node.loadTextures(textures);
+}
+
+void CachedModel::write(Common::WriteStream &cache, const Model &model, uint64 hash) {
+	// Number all nodes, over all states
+	NodeIndexMap nodeIndices;
+	for (Model::StateList::const_iterator s = model._stateList.begin(); s != model._stateList.end(); ++s)
+		for (Model::NodeList::const_iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
+			nodeIndices.insert(std::make_pair(*n, (uint32) nodeIndices.size()));
+
+	cache.writeUint32BE(kCacheID);
+	cache.writeUint32LE(kVersion);
+	cache.writeUint64LE(hash);
+
+	writeString(cache, model._name);
+	writeString(cache, model._superModelName);
+
+	cache.writeIEEEFloatLE(model._animationScale);
+
+	cache.writeUint32LE(nodeIndices.size());
+	cache.writeUint32LE(model._stateList.size());
+
+	for (Model::StateList::const_iterator s = model._stateList.begin(); s != model._stateList.end(); ++s) {
+		writeString(cache, (*s)->name);
+
+		cache.writeUint32LE((*s)->nodeList.size());
+		for (Model::NodeList::const_iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
+			writeNode(cache, **n, nodeIndices);
+	}
+
+	cache.writeUint32LE(model._animationMap.size());
+	for (Model::AnimationMap::const_iterator a = model._animationMap.begin(); a != model._animationMap.end(); ++a) {
+		const Animation &anim = *a->second;
+
+		writeString(cache, anim._name);
+
+		cache.writeIEEEFloatLE(anim._length);
+		cache.writeIEEEFloatLE(anim._transtime);
+
+		cache.writeUint32LE(anim.nodeList.size());
+		for (Animation::NodeList::const_iterator n = anim.nodeList.begin(); n != anim.nodeList.end(); ++n) {
+			NodeIndexMap::const_iterator index = nodeIndices.find((*n)->_nodedata);
+
+			cache.writeUint32LE((index != nodeIndices.end()) ? index->second : kNoNode);
+		}
+	}
+}
+
+void CachedModel::writeNode(Common::WriteStream &cache, const ModelNode &node,
+                            const NodeIndexMap &nodeIndices) {
+
+	writeString(cache, node._name);
+
+	cache.writeUint32LE(node._level);
+
+	NodeIndexMap::const_iterator parent = nodeIndices.find(node._parent);
+	cache.writeUint32LE((parent != nodeIndices.end()) ? parent->second : kNoNode);
+
+	cache.writeUint32LE(node._children.size());
+	for (std::list<ModelNode *>::const_iterator c = node._children.begin(); c != node._children.end(); ++c) {
+		NodeIndexMap::const_iterator child = nodeIndices.find(*c);
+		if (child == nodeIndices.end())
+			throw Common::Exception("Child node \"%s\" outside of the model's states", (*c)->_name.c_str());
+
+		cache.writeUint32LE(child->second);
+	}
+
+	writeFloats(cache, node._center     , 3);
+	writeFloats(cache, node._position   , 3);
+	writeFloats(cache, node._rotation   , 3);
+	writeFloats(cache, node._orientation, 4);
+
+	cache.writeUint32LE(node._positionFrames.size());
+	for (std::vector<PositionKeyFrame>::const_iterator p = node._positionFrames.begin();
+	     p != node._positionFrames.end(); ++p) {
+
+		cache.writeIEEEFloatLE(p->time);
+		cache.writeIEEEFloatLE(p->x);
+		cache.writeIEEEFloatLE(p->y);
+		cache.writeIEEEFloatLE(p->z);
+	}
+
+	cache.writeUint32LE(node._orientationFrames.size());
+	for (std::vector<QuaternionKeyFrame>::const_iterator o = node._orientationFrames.begin();
+	     o != node._orientationFrames.end(); ++o) {
+
+		cache.writeIEEEFloatLE(o->time);
+		cache.writeIEEEFloatLE(o->x);
+		cache.writeIEEEFloatLE(o->y);
+		cache.writeIEEEFloatLE(o->z);
+		cache.writeIEEEFloatLE(o->q);
+	}
+
+	writeFloats(cache, node._wirecolor, 3);
+	writeFloats(cache, node._ambient  , 3);
+	writeFloats(cache, node._diffuse  , 3);
+	writeFloats(cache, node._specular , 3);
+	writeFloats(cache, node._selfIllum, 3);
+
+	cache.writeIEEEFloatLE(node._shininess);
+
+	cache.writeByte(node._isTransparent       ? 1 : 0);
+	cache.writeByte(node._dangly              ? 1 : 0);
+	cache.writeByte(node._showdispl           ? 1 : 0);
+	cache.writeByte(node._render              ? 1 : 0);
+	cache.writeByte(node._shadow              ? 1 : 0);
+	cache.writeByte(node._beaming             ? 1 : 0);
+	cache.writeByte(node._inheritcolor        ? 1 : 0);
+	cache.writeByte(node._rotatetexture       ? 1 : 0);
+	cache.writeByte(node._hasTransparencyHint ? 1 : 0);
+	cache.writeByte(node._transparencyHint    ? 1 : 0);
+
+	cache.writeIEEEFloatLE(node._period);
+	cache.writeIEEEFloatLE(node._tightness);
+	cache.writeIEEEFloatLE(node._displacement);
+	cache.writeSint32LE(node._displtype);
+
+	cache.writeUint32LE(node._constraints.size());
+	for (std::vector<float>::const_iterator c = node._constraints.begin(); c != node._constraints.end(); ++c)
+		cache.writeIEEEFloatLE(*c);
+
+	cache.writeUint32LE(node._skinBones.size());
+	for (std::vector<Common::UString>::const_iterator b = node._skinBones.begin(); b != node._skinBones.end(); ++b)
+		writeString(cache, *b);
+
+	cache.writeUint32LE(node._skinBoneIndices.size());
+	if (!node._skinBoneIndices.empty())
+		cache.write(&node._skinBoneIndices[0], node._skinBoneIndices.size());
+
+	cache.writeUint32LE(node._skinWeights.size());
+	for (std::vector<float>::const_iterator w = node._skinWeights.begin(); w != node._skinWeights.end(); ++w)
+		cache.writeIEEEFloatLE(*w);
+
+	cache.writeSint32LE(node._tilefade);
+	cache.writeIEEEFloatLE(node._scale);
+	cache.writeIEEEFloatLE(node._alpha);
+
+	cache.writeByte(node._boundBox.isEmpty() ? 0 : 1);
+	if (!node._boundBox.isEmpty()) {
+		float bound[6];
+		node._boundBox.getMin(bound[0], bound[1], bound[2]);
+		node._boundBox.getMax(bound[3], bound[4], bound[5]);
+
+		writeFloats(cache, bound, 6);
+	}
+
+
+	// Vertex buffer
+
+	const VertexBuffer &vertexBuffer = node._vertexBuffer;
+	const byte *vertexData = (const byte *) vertexBuffer.getData();
+
+	cache.writeUint32LE(vertexBuffer.getCount());
+	cache.writeUint32LE(vertexBuffer.getSize());
+
+	const VertexDecl &vertexDecl = vertexBuffer.getVertexDecl();
+
+	cache.writeUint32LE(vertexDecl.size());
+	for (VertexDecl::const_iterator v = vertexDecl.begin(); v != vertexDecl.end(); ++v) {
+		cache.writeUint32LE(v->index);
+		cache.writeSint32LE(v->size);
+		cache.writeUint32LE(v->type);
+		cache.writeSint32LE(v->stride);
+
+		// Pointers are stored as offsets into the vertex data
+		cache.writeUint32LE(vertexData ? ((const byte *) v->pointer - vertexData) : 0);
+	}
+
+	if (vertexData)
+		cache.write(vertexData, vertexBuffer.getCount() * vertexBuffer.getSize());
+
+
+	// Index buffer
+
+	const IndexBuffer &indexBuffer = node._indexBuffer;
+
+	cache.writeUint32LE(indexBuffer.getCount());
+	cache.writeUint32LE(indexBuffer.getType());
+
+	if (indexBuffer.getData() && (indexBuffer.getCount() > 0))
+		cache.write(indexBuffer.getData(), indexBuffer.getCount() * getIndexSize(indexBuffer.getType()));
+
+
+	// Textures
+
+	cache.writeUint32LE(node._textureNames.size());
+	for (std::vector<Common::UString>::const_iterator t = node._textureNames.begin();
+	     t != node._textureNames.end(); ++t)
+		writeString(cache, *t);
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
@@ -0,0 +1,88 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/cachedmodel.h
+ *  Fully loaded model data, as stored in the on-disk model cache.
+ */
+
+#ifndef GRAPHICS_AURORA_CACHEDMODEL_H
+#define GRAPHICS_AURORA_CACHEDMODEL_H
+
+#include <vector>
+#include <map>
+
+#include "common/types.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Graphics {
+
+namespace Aurora {
+
+class Model;
+class ModelNode;
+
+/** Reading and writing models in the model cache format.
+ *
+ *  The cache holds the node hierarchies of all states, the nodes'
+ *  vertex and index buffers as they are going to be uploaded, and the
+ *  animations, so restoring a model needs no parsing at all. Textures
+ *  are only referenced by name, they have a cache of their own.
+ *
+ *  Vertex and index data is stored in the native byte order, so cache
+ *  files can't be shared between machines of different endianness.
+ */
+class CachedModel {
+public:
+	/** Restore the model from the cache, checking that it was created for this source hash. */
+	static void load(Model &model, Common::SeekableReadStream &cache, uint64 hash);
+
+	/** Write a loaded, not yet finalized model into the model cache format. */
+	static void write(Common::WriteStream &cache, const Model &model, uint64 hash);
+
+	/** The version of the cache format and the model loaders filling it.
+	 *
+	 *  Needs to be bumped whenever a model loader changes its output,
+	 *  so that stale cache entries get discarded.
+	 */
+	static const uint32 kVersion = 2;
+
+private:
+	typedef std::map<const ModelNode *, uint32> NodeIndexMap;
+
+	static void loadNode(Common::SeekableReadStream &cache, ModelNode &node,
+	                     const std::vector<ModelNode *> &nodes);
+	static void writeNode(Common::WriteStream &cache, const ModelNode &node,
+	                      const NodeIndexMap &nodeIndices);
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_CACHEDMODEL_H
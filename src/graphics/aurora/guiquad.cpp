@@ -31,6 +31,7 @@
 #include "common/ustring.h"
 
 #include "graphics/graphics.h"
+#include "graphics/guidrawlist.h"
 
 #include "graphics/aurora/guiquad.h"
 #include "graphics/aurora/texture.h"
@@ -45,12 +46,11 @@ GUIQuad::GUIQuad(const Common::UString &texture,
 	_r(1.0), _g(1.0), _b(1.0), _a(1.0),
 	_x1 (x1) , _y1 (y1) , _x2 (x2) , _y2 (y2) ,
 	_tX1(tX1), _tY1(tY1), _tX2(tX2), _tY2(tY2),
-	_xor(false) {
+	_xor(false), _inAtlas(false), _atlasGeneration(0) {
 
 	try {
 
-		if (!texture.empty())
-			_texture = TextureMan.get(texture);
+		loadTexture(texture);
 
 	} catch (...) {
 		_texture.clear();
@@ -111,10 +111,7 @@ void GUIQuad::setTexture(const Common::UString &texture) {
 
 	try {
 
-		if (texture.empty())
-			_texture.clear();
-		else
-			_texture = TextureMan.get(texture);
+		loadTexture(texture);
 
 	} catch (...) {
 		_texture.clear();
@@ -125,6 +122,52 @@ void GUIQuad::setTexture(const Common::UString &texture) {
 	GfxMan.unlockFrame();
 }
 
+void GUIQuad::loadTexture(const Common::UString &texture) {
+	_texture.clear();
+
+	_atlasArea = TextureAtlasArea();
+	_inAtlas   = false;
+
+	if (texture.empty())
+		return;
+
+	// Texture coordinates outside [0, 1] repeat the texture, which an atlas page can't do
+	const bool canUseAtlas = (MIN(_tX1, _tX2) >= 0.0) && (MAX(_tX1, _tX2) <= 1.0) &&
+	                         (MIN(_tY1, _tY2) >= 0.0) && (MAX(_tY1, _tY2) <= 1.0);
+
+	const uint32 atlasGeneration = TextureMan.getAtlasGeneration();
+
+	if (canUseAtlas && TextureMan.getAtlas(texture, _texture, _atlasArea)) {
+		_inAtlas         = true;
+		_atlasTexture    = texture;
+		_atlasGeneration = atlasGeneration;
+		return;
+	}
+
+	_texture = TextureMan.get(texture);
+}
+
+void GUIQuad::checkAtlas() {
+	if (!_inAtlas)
+		return;
+
+	const uint32 atlasGeneration = TextureMan.getAtlasGeneration();
+	if (atlasGeneration == _atlasGeneration)
+		return;
+
+	_atlasGeneration = atlasGeneration;
+
+	// The texture manager already packed everything that was in the atlas again. If
+	// our texture didn't make it, keep showing the old page, which we still hold.
+	TextureHandle page;
+	TextureAtlasArea area;
+	if (!TextureMan.findAtlas(_atlasTexture, page, area))
+		return;
+
+	_texture   = page;
+	_atlasArea = area;
+}
+
 float GUIQuad::getWidth() const {
 	return ABS(_x2 - _x1);
 }
@@ -169,8 +212,35 @@ bool GUIQuad::isIn(float x, float y) const {
 void GUIQuad::calculateDistance() {
 }
 
+bool GUIQuad::addToDrawList(GUIDrawList &list) {
+	// XOR mode needs its own OpenGL state
+	if (_xor)
+		return false;
+
+	checkAtlas();
+
+	// Map the texture coordinates into the texture's area of its atlas page
+	const float tX1 = _atlasArea.x + _tX1 * _atlasArea.width;
+	const float tY1 = _atlasArea.y + _tY1 * _atlasArea.height;
+	const float tX2 = _atlasArea.x + _tX2 * _atlasArea.width;
+	const float tY2 = _atlasArea.y + _tY2 * _atlasArea.height;
+
+	const float vX[4] = { _x1, _x2, _x2, _x1 };
+	const float vY[4] = { _y1, _y1, _y2, _y2 };
+	const float tX[4] = {  tX1,  tX2,  tX2,  tX1 };
+	const float tY[4] = {  tY1,  tY1,  tY2,  tY2 };
+
+	list.addQuad(_texture.empty() ? 0 : &_texture.getTexture(), vX, vY, tX, tY, _r, _g, _b, _a);
+	return true;
+}
+
 void GUIQuad::render(RenderPass pass) {
-	bool isTransparent = (_a < 1.0) || (!_texture.empty() && _texture.getTexture().hasAlpha());
+	checkAtlas();
+
+	const bool textureAlpha = _inAtlas ? _atlasArea.hasAlpha :
+	                          (!_texture.empty() && _texture.getTexture().hasAlpha());
+
+	bool isTransparent = (_a < 1.0) || textureAlpha;
 	if (((pass == kRenderPassOpaque)      &&  isTransparent) ||
 			((pass == kRenderPassTransparent) && !isTransparent))
 		return;
@@ -184,14 +254,20 @@ void GUIQuad::render(RenderPass pass) {
 		glLogicOp(GL_XOR);
 	}
 
+	// Map the texture coordinates into the texture's area of its atlas page
+	const float tX1 = _atlasArea.x + _tX1 * _atlasArea.width;
+	const float tY1 = _atlasArea.y + _tY1 * _atlasArea.height;
+	const float tX2 = _atlasArea.x + _tX2 * _atlasArea.width;
+	const float tY2 = _atlasArea.y + _tY2 * _atlasArea.height;
+
 	glBegin(GL_QUADS);
-		glTexCoord2f(_tX1, _tY1);
+		glTexCoord2f(tX1, tY1);
 		glVertex2f(_x1, _y1);
-		glTexCoord2f(_tX2, _tY1);
+		glTexCoord2f(tX2, tY1);
 		glVertex2f(_x2, _y1);
-		glTexCoord2f(_tX2, _tY2);
+		glTexCoord2f(tX2, tY2);
 		glVertex2f(_x2, _y2);
-		glTexCoord2f(_tX1, _tY2);
+		glTexCoord2f(tX1, tY2);
 		glVertex2f(_x1, _y2);
 	glEnd();
 
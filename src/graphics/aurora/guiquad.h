@@ -31,15 +31,12 @@
 #define GRAPHICS_AURORA_GUIQUAD_H
 
 #include "common/maths.h"
+#include "common/ustring.h"
 
 #include "graphics/guifrontelement.h"
 
 #include "graphics/aurora/textureman.h"
 
-namespace Common {
-	class UString;
-}
-
 namespace Graphics {
 
 namespace Aurora {
@@ -78,6 +75,9 @@ public:
 	void calculateDistance();
 	void render(RenderPass pass);
 
+	// GUIFrontElement
+	bool addToDrawList(GUIDrawList &list);
+
 private:
 	TextureHandle _texture;
 
@@ -97,6 +97,17 @@ private:
 	float _tY2;
 
 	bool _xor;
+
+	/** The area of the texture in its atlas page, if the texture is in a texture atlas. */
+	TextureAtlasArea _atlasArea;
+	bool _inAtlas;
+
+	Common::UString _atlasTexture; ///< The name of the texture in the atlas.
+	uint32 _atlasGeneration;       ///< The atlas generation our page and area are from.
+
+	void loadTexture(const Common::UString &texture);
+	/** Look up our atlas page and area again if the atlas has been packed anew. */
+	void checkAtlas();
 };
 
 } // End of namespace Aurora
@@ -39,13 +39,22 @@ HighlightableGUIQuad::~HighlightableGUIQuad() {
 }
 
 void HighlightableGUIQuad::render(RenderPass pass) {
+	updateHighlight();
+	Graphics::Aurora::GUIQuad::render(pass);
+}
+
+bool HighlightableGUIQuad::addToDrawList(GUIDrawList &list) {
+	updateHighlight();
+	return Graphics::Aurora::GUIQuad::addToDrawList(list);
+}
+
+void HighlightableGUIQuad::updateHighlight() {
 	if (isHighlightable() && isHightlighted()) {
 		float initialR, initialG, initialB, initialA, r, g, b, a;
 		getColor(initialR, initialG, initialB, initialA);
 		incrementColor(initialR, initialG, initialB, initialA, r, g, b, a);
 		setColor(r, g, b, a);
 	}
-	Graphics::Aurora::GUIQuad::render(pass);
 }
 
 } // End of namespace Aurora
@@ -42,6 +42,10 @@ public:
 	~HighlightableGUIQuad();
 
 	void render (RenderPass pass);
+	bool addToDrawList(GUIDrawList &list);
+
+private:
+	void updateHighlight();
 };
 
 } // End of namespace Aurora
@@ -41,13 +41,22 @@ void HighlightableText::render(RenderPass pass) {
 	if (pass == kRenderPassOpaque)
 		return;
 
+	updateHighlight();
+	Graphics::Aurora::Text::render(pass);
+}
+
+bool HighlightableText::addToDrawList(GUIDrawList &list) {
+	updateHighlight();
+	return Graphics::Aurora::Text::addToDrawList(list);
+}
+
+void HighlightableText::updateHighlight() {
 	if (isHighlightable() && isHightlighted()) {
 		float initialR, initialG, initialB, initialA, r, g, b, a;
 		getColor(initialR, initialG, initialB, initialA);
 		incrementColor(initialR, initialG, initialB, initialA, r, g, b, a);
 		setColor(r, g, b, a);
 	}
-	Graphics::Aurora::Text::render(pass);
 }
 
 } // End of namespace Aurora
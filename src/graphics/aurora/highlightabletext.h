@@ -41,7 +41,10 @@ class HighlightableText: public Text, public Highlightable {
 	~HighlightableText();
 
 	void render(RenderPass pass);
+	bool addToDrawList(GUIDrawList &list);
 
+private:
+	void updateHighlight();
 };
 
 } // End of namespace Aurora
@@ -0,0 +1,584 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/meshdeformer.cpp
+ *  Deforming dangly and skin meshes on the CPU.
+ */
+
+#include <cstring>
+
+#include <algorithm>
+
+#include "common/system.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
+#include "common/util.h"
+#include "common/maths.h"
+#include "common/transmatrix.h"
+
+#include "graphics/aurora/meshdeformer.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+/* The matrices used here are affine 4x4 matrices in the same column-major
+ * order OpenGL and Common::Matrix use. The node transformations are only
+ * made of translations and rotations, so they can be inverted cheaply. */
+
+static const float kIdentity[16] = {
+	1.0f, 0.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, 0.0f,
+	0.0f, 0.0f, 1.0f, 0.0f,
+	0.0f, 0.0f, 0.0f, 1.0f
+};
+
+/** out = a * b. */
+static void multiplyAffine(float *out, const float *a, const float *b) {
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 3; r++)
+			out[c * 4 + r] = a[r] * b[c * 4 + 0] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2];
+
+		out[c * 4 + 3] = 0.0f;
+	}
+
+	out[12] += a[12];
+	out[13] += a[13];
+	out[14] += a[14];
+	out[15]  = 1.0f;
+}
+
+/** Invert a transformation made of rotations and translations only. */
+static void invertRigid(float *out, const float *m) {
+	out[ 0] = m[0]; out[ 1] = m[4]; out[ 2] = m[ 8]; out[ 3] = 0.0f;
+	out[ 4] = m[1]; out[ 5] = m[5]; out[ 6] = m[ 9]; out[ 7] = 0.0f;
+	out[ 8] = m[2]; out[ 9] = m[6]; out[10] = m[10]; out[11] = 0.0f;
+
+	for (int r = 0; r < 3; r++)
+		out[12 + r] = -(out[r] * m[12] + out[4 + r] * m[13] + out[8 + r] * m[14]);
+
+	out[15] = 1.0f;
+}
+
+
+// The deformation kernels, working on a structure of arrays
+
+#ifdef XOREOS_SSE2
+/** Load one column of the bone matrices of four vertices, as one vector per row.
+ *
+ *  Each vertex can use a different matrix, so this gathers the column of each
+ *  one and transposes them, giving the first three rows for all four vertices.
+ */
+static FORCEINLINE void loadColumnSSE2(const float *m0, const float *m1, const float *m2, const float *m3,
+                                       __m128 &row0, __m128 &row1, __m128 &row2) {
+
+	__m128 row3 = _mm_loadu_ps(m3);
+
+	row0 = _mm_loadu_ps(m0);
+	row1 = _mm_loadu_ps(m1);
+	row2 = _mm_loadu_ps(m2);
+
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+}
+#endif
+
+/** Add a weighted bone transformation of the positions to the output. */
+static void skinPositions(uint32 n, const float *matrices, const uint32 *indices, const float *weights,
+                          const float *x, const float *y, const float *z,
+                          float *outX, float *outY, float *outZ) {
+
+	uint32 i = 0;
+
+#ifdef XOREOS_SSE2
+	for (; (i + 4) <= n; i += 4) {
+		const float *m0 = matrices + 16 * indices[i + 0];
+		const float *m1 = matrices + 16 * indices[i + 1];
+		const float *m2 = matrices + 16 * indices[i + 2];
+		const float *m3 = matrices + 16 * indices[i + 3];
+
+		__m128 a0, a1, a2, b0, b1, b2, c0, c1, c2, t0, t1, t2;
+		loadColumnSSE2(m0 +  0, m1 +  0, m2 +  0, m3 +  0, a0, a1, a2);
+		loadColumnSSE2(m0 +  4, m1 +  4, m2 +  4, m3 +  4, b0, b1, b2);
+		loadColumnSSE2(m0 +  8, m1 +  8, m2 +  8, m3 +  8, c0, c1, c2);
+		loadColumnSSE2(m0 + 12, m1 + 12, m2 + 12, m3 + 12, t0, t1, t2);
+
+		const __m128 vX = _mm_loadu_ps(x + i);
+		const __m128 vY = _mm_loadu_ps(y + i);
+		const __m128 vZ = _mm_loadu_ps(z + i);
+		const __m128 w  = _mm_loadu_ps(weights + i);
+
+		const __m128 pX = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, vX), _mm_mul_ps(b0, vY)), _mm_mul_ps(c0, vZ)), t0);
+		const __m128 pY = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a1, vX), _mm_mul_ps(b1, vY)), _mm_mul_ps(c1, vZ)), t1);
+		const __m128 pZ = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a2, vX), _mm_mul_ps(b2, vY)), _mm_mul_ps(c2, vZ)), t2);
+
+		_mm_storeu_ps(outX + i, _mm_add_ps(_mm_loadu_ps(outX + i), _mm_mul_ps(w, pX)));
+		_mm_storeu_ps(outY + i, _mm_add_ps(_mm_loadu_ps(outY + i), _mm_mul_ps(w, pY)));
+		_mm_storeu_ps(outZ + i, _mm_add_ps(_mm_loadu_ps(outZ + i), _mm_mul_ps(w, pZ)));
+	}
+#endif
+
+	for (; i < n; i++) {
+		const float *m = matrices + 16 * indices[i];
+		const float  w = weights[i];
+
+		outX[i] += w * (m[0] * x[i] + m[4] * y[i] + m[ 8] * z[i] + m[12]);
+		outY[i] += w * (m[1] * x[i] + m[5] * y[i] + m[ 9] * z[i] + m[13]);
+		outZ[i] += w * (m[2] * x[i] + m[6] * y[i] + m[10] * z[i] + m[14]);
+	}
+}
+
+/** Add a weighted bone rotation of the normals to the output. */
+static void skinNormals(uint32 n, const float *matrices, const uint32 *indices, const float *weights,
+                        const float *x, const float *y, const float *z,
+                        float *outX, float *outY, float *outZ) {
+
+	uint32 i = 0;
+
+#ifdef XOREOS_SSE2
+	for (; (i + 4) <= n; i += 4) {
+		const float *m0 = matrices + 16 * indices[i + 0];
+		const float *m1 = matrices + 16 * indices[i + 1];
+		const float *m2 = matrices + 16 * indices[i + 2];
+		const float *m3 = matrices + 16 * indices[i + 3];
+
+		__m128 a0, a1, a2, b0, b1, b2, c0, c1, c2;
+		loadColumnSSE2(m0 + 0, m1 + 0, m2 + 0, m3 + 0, a0, a1, a2);
+		loadColumnSSE2(m0 + 4, m1 + 4, m2 + 4, m3 + 4, b0, b1, b2);
+		loadColumnSSE2(m0 + 8, m1 + 8, m2 + 8, m3 + 8, c0, c1, c2);
+
+		const __m128 vX = _mm_loadu_ps(x + i);
+		const __m128 vY = _mm_loadu_ps(y + i);
+		const __m128 vZ = _mm_loadu_ps(z + i);
+		const __m128 w  = _mm_loadu_ps(weights + i);
+
+		const __m128 nX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, vX), _mm_mul_ps(b0, vY)), _mm_mul_ps(c0, vZ));
+		const __m128 nY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a1, vX), _mm_mul_ps(b1, vY)), _mm_mul_ps(c1, vZ));
+		const __m128 nZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a2, vX), _mm_mul_ps(b2, vY)), _mm_mul_ps(c2, vZ));
+
+		_mm_storeu_ps(outX + i, _mm_add_ps(_mm_loadu_ps(outX + i), _mm_mul_ps(w, nX)));
+		_mm_storeu_ps(outY + i, _mm_add_ps(_mm_loadu_ps(outY + i), _mm_mul_ps(w, nY)));
+		_mm_storeu_ps(outZ + i, _mm_add_ps(_mm_loadu_ps(outZ + i), _mm_mul_ps(w, nZ)));
+	}
+#endif
+
+	for (; i < n; i++) {
+		const float *m = matrices + 16 * indices[i];
+		const float  w = weights[i];
+
+		outX[i] += w * (m[0] * x[i] + m[4] * y[i] + m[ 8] * z[i]);
+		outY[i] += w * (m[1] * x[i] + m[5] * y[i] + m[ 9] * z[i]);
+		outZ[i] += w * (m[2] * x[i] + m[6] * y[i] + m[10] * z[i]);
+	}
+}
+
+/** Blending the bones shortens the normals, so they need to be normalized again. */
+static void normalize(uint32 n, float *x, float *y, float *z) {
+	for (uint32 i = 0; i < n; i++) {
+		const float length = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+		const float scale  = (length > 0.0f) ? (1.0f / sqrtf(length)) : 0.0f;
+
+		x[i] *= scale;
+		y[i] *= scale;
+		z[i] *= scale;
+	}
+}
+
+/** Move the positions by the offset, scaled by the constraints. */
+static void displace(uint32 n, const float *constraints, const float *offset,
+                     const float *x, const float *y, const float *z,
+                     float *outX, float *outY, float *outZ) {
+
+	for (uint32 i = 0; i < n; i++) {
+		outX[i] = x[i] + constraints[i] * offset[0];
+		outY[i] = y[i] + constraints[i] * offset[1];
+		outZ[i] = z[i] + constraints[i] * offset[2];
+	}
+}
+
+
+/** Gather a vec3 float attribute into separate arrays. */
+static void gather(uint32 n, const VertexAttrib &attrib,
+                   std::vector<float> &x, std::vector<float> &y, std::vector<float> &z) {
+
+	x.resize(n);
+	y.resize(n);
+	z.resize(n);
+
+	const uint32 stride = attrib.stride ? (attrib.stride / sizeof(float)) : 3;
+
+	const float *v = (const float *) attrib.pointer;
+	for (uint32 i = 0; i < n; i++, v += stride) {
+		x[i] = v[0];
+		y[i] = v[1];
+		z[i] = v[2];
+	}
+}
+
+/** Scatter separate arrays into a vec3 float attribute. */
+static void scatter(uint32 n, const VertexAttrib &attrib, const float *x, const float *y, const float *z) {
+	const uint32 stride = attrib.stride ? (attrib.stride / sizeof(float)) : 3;
+
+	float *v = (float *) attrib.pointer;
+	for (uint32 i = 0; i < n; i++, v += stride) {
+		v[0] = x[i];
+		v[1] = y[i];
+		v[2] = z[i];
+	}
+}
+
+static bool isVec3Float(const VertexAttrib &attrib) {
+	return (attrib.type == GL_FLOAT) && (attrib.size == 3) &&
+	       ((attrib.stride == 0) || ((attrib.stride % sizeof(float)) == 0));
+}
+
+MeshDeformer::MeshDeformer(ModelNode &node) : _node(&node), _needUpload(true), _vertexCount(0),
+	_hasNormals(false), _influences(0), _hasLastPosition(false) {
+
+	std::memset(&_positionAttrib, 0, sizeof(_positionAttrib));
+	std::memset(&_normalAttrib  , 0, sizeof(_normalAttrib));
+
+	for (int i = 0; i < 3; i++) {
+		_lastPosition [i] = 0.0f;
+		_danglyOffset [i] = 0.0f;
+		_danglySpeed  [i] = 0.0f;
+		_appliedOffset[i] = 0.0f;
+	}
+
+	loadRestPose();
+
+	if (!_node->_geometry->_skinBones.empty())
+		loadSkin();
+	else
+		loadDangly();
+}
+
+MeshDeformer::~MeshDeformer() {
+}
+
+void MeshDeformer::loadRestPose() {
+	// Our own copy of the vertices, to write the deformed mesh into
+	_vertexBuffer = _node->_geometry->_vertexBuffer;
+	_vertexCount  = _vertexBuffer.getCount();
+
+	const VertexDecl &decl = _vertexBuffer.getVertexDecl();
+	for (VertexDecl::const_iterator a = decl.begin(); a != decl.end(); ++a) {
+		if (!isVec3Float(*a))
+			continue;
+
+		if (a->index == VPOSITION)
+			_positionAttrib = *a;
+		else if (a->index == VNORMAL) {
+			_normalAttrib = *a;
+			_hasNormals   = true;
+		}
+	}
+
+	gather(_vertexCount, _positionAttrib, _restX, _restY, _restZ);
+
+	_x.resize(_vertexCount);
+	_y.resize(_vertexCount);
+	_z.resize(_vertexCount);
+
+	if (!_hasNormals)
+		return;
+
+	gather(_vertexCount, _normalAttrib, _restNX, _restNY, _restNZ);
+
+	_nx.resize(_vertexCount);
+	_ny.resize(_vertexCount);
+	_nz.resize(_vertexCount);
+}
+
+void MeshDeformer::loadSkin() {
+	const ModelNode &geometry = *_node->_geometry;
+
+	// The hierarchy of the node's state, where we can find our bones
+	const ModelNode *root = _node;
+	while (root->getParent())
+		root = root->getParent();
+
+	/* Each bone gets a matrix to bring the skin from its rest pose into
+	 * the bone's rest pose. Moving it along with the bone's current
+	 * pose then gives the skin's current pose. */
+
+	const float *skinRest = _node->_modelTransform.get();
+
+	std::vector<int32> boneMap(geometry._skinBones.size(), -1);
+
+	for (uint32 i = 0; i < geometry._skinBones.size(); i++) {
+		const ModelNode *bone = findNode(*root, geometry._skinBones[i]);
+		if (!bone)
+			continue;
+
+		float boneRestInverse[16];
+		invertRigid(boneRestInverse, bone->_modelTransform.get());
+
+		boneMap[i] = _bones.size();
+
+		_bones.push_back(bone);
+		_bindPoses.resize(_bindPoses.size() + 16);
+
+		multiplyAffine(&_bindPoses[_bindPoses.size() - 16], boneRestInverse, skinRest);
+	}
+
+	if (_bones.empty())
+		return;
+
+	// Convert the weights into per-influence arrays, with normalized weights
+	for (uint32 k = 0; k < ModelNode::kSkinInfluences; k++) {
+		_boneIndices[k].resize(_vertexCount, 0);
+		_boneWeights[k].resize(_vertexCount, 0.0f);
+	}
+
+	for (uint32 i = 0; i < _vertexCount; i++) {
+		const uint8 *indices = &geometry._skinBoneIndices[i * ModelNode::kSkinInfluences];
+		const float *weights = &geometry._skinWeights    [i * ModelNode::kSkinInfluences];
+
+		uint32 count = 0;
+		float  sum   = 0.0f;
+
+		for (uint32 k = 0; k < ModelNode::kSkinInfluences; k++) {
+			if ((indices[k] >= boneMap.size()) || (boneMap[indices[k]] < 0) || (weights[k] <= 0.0f))
+				continue;
+
+			// Matrix 0 is the identity, for vertices without any bones
+			_boneIndices[count][i] = boneMap[indices[k]] + 1;
+			_boneWeights[count][i] = weights[k];
+
+			sum += weights[k];
+			count++;
+		}
+
+		if (count == 0) {
+			_boneWeights[0][i] = 1.0f;
+			count = 1;
+		}
+
+		if (sum > 0.0f)
+			for (uint32 k = 0; k < count; k++)
+				_boneWeights[k][i] /= sum;
+
+		_influences = MAX(_influences, count);
+	}
+}
+
+void MeshDeformer::loadDangly() {
+	const ModelNode &geometry = *_node->_geometry;
+
+	_constraints.resize(_vertexCount);
+	for (uint32 i = 0; i < _vertexCount; i++)
+		_constraints[i] = CLIP(geometry._constraints[i] / 255.0f, 0.0f, 1.0f);
+}
+
+const ModelNode *MeshDeformer::findNode(const ModelNode &node, const Common::UString &name) {
+	if (node.getName() == name)
+		return &node;
+
+	for (std::list<ModelNode *>::const_iterator c = node._children.begin(); c != node._children.end(); ++c) {
+		const ModelNode *found = findNode(**c, name);
+		if (found)
+			return found;
+	}
+
+	return 0;
+}
+
+void MeshDeformer::deform(float dt, const Common::TransformationMatrix &modelPosition) {
+	if (!_bones.empty()) {
+		if (updateBones())
+			skin();
+
+		return;
+	}
+
+	if (!_constraints.empty() && updateDangly(dt, modelPosition))
+		dangle();
+}
+
+bool MeshDeformer::updateBones() {
+	float skinInverse[16];
+	invertRigid(skinInverse, _node->_modelTransform.get());
+
+	std::vector<float> &matrices = _newBoneMatrices;
+	matrices.resize((_bones.size() + 1) * 16);
+
+	std::memcpy(&matrices[0], kIdentity, sizeof(kIdentity));
+
+	for (uint32 i = 0; i < _bones.size(); i++) {
+		float bone[16];
+		multiplyAffine(bone, skinInverse, _bones[i]->_modelTransform.get());
+
+		multiplyAffine(&matrices[(i + 1) * 16], bone, &_bindPoses[i * 16]);
+	}
+
+	// Nothing moved, the mesh is still correct
+	if (matrices == _boneMatrices)
+		return false;
+
+	_boneMatrices.swap(matrices);
+	return true;
+}
+
+void MeshDeformer::skin() {
+	std::fill(_x.begin(), _x.end(), 0.0f);
+	std::fill(_y.begin(), _y.end(), 0.0f);
+	std::fill(_z.begin(), _z.end(), 0.0f);
+
+	for (uint32 k = 0; k < _influences; k++)
+		skinPositions(_vertexCount, &_boneMatrices[0], &_boneIndices[k][0], &_boneWeights[k][0],
+		              &_restX[0], &_restY[0], &_restZ[0], &_x[0], &_y[0], &_z[0]);
+
+	scatter(_vertexCount, _positionAttrib, &_x[0], &_y[0], &_z[0]);
+
+	if (_hasNormals) {
+		std::fill(_nx.begin(), _nx.end(), 0.0f);
+		std::fill(_ny.begin(), _ny.end(), 0.0f);
+		std::fill(_nz.begin(), _nz.end(), 0.0f);
+
+		for (uint32 k = 0; k < _influences; k++)
+			skinNormals(_vertexCount, &_boneMatrices[0], &_boneIndices[k][0], &_boneWeights[k][0],
+			            &_restNX[0], &_restNY[0], &_restNZ[0], &_nx[0], &_ny[0], &_nz[0]);
+
+		normalize(_vertexCount, &_nx[0], &_ny[0], &_nz[0]);
+
+		scatter(_vertexCount, _normalAttrib, &_nx[0], &_ny[0], &_nz[0]);
+	}
+
+	_needUpload = true;
+}
+
+bool MeshDeformer::updateDangly(float dt, const Common::TransformationMatrix &modelPosition) {
+	Common::TransformationMatrix world = modelPosition;
+	world.transform(_node->_modelTransform);
+
+	float position[3];
+	world.getPosition(position[0], position[1], position[2]);
+
+	if (!_hasLastPosition) {
+		std::memcpy(_lastPosition, position, sizeof(position));
+
+		_hasLastPosition = true;
+		return false;
+	}
+
+	// The dangly parts stay behind when the node moves...
+	for (int i = 0; i < 3; i++) {
+		_danglyOffset[i] -= position[i] - _lastPosition[i];
+		_lastPosition[i]  = position[i];
+	}
+
+	/* ...and swing back like a damped spring. The period is the time of one
+	 * free swing and the tightness damps it. The spring is stepped often
+	 * enough to stay stable, the damping is applied implicitly. */
+
+	dt = MIN(dt, 0.1f);
+
+	const float omega     = 2.0f * M_PI / MAX(_node->_period, 0.1f);
+	const float stiffness = omega * omega;
+	const float damping   = MAX(_node->_tightness, 0.0f);
+
+	const uint32 steps = CLIP<uint32>(ceilf(omega * dt * 2.0f), 1, 16);
+	const float  h     = dt / steps;
+
+	for (uint32 s = 0; s < steps; s++) {
+		for (int i = 0; i < 3; i++) {
+			_danglySpeed [i]  = (_danglySpeed[i] - stiffness * _danglyOffset[i] * h) / (1.0f + damping * h);
+			_danglyOffset[i] += _danglySpeed[i] * h;
+		}
+	}
+
+	// Never swing further than the maximum displacement
+	const float length = sqrtf(_danglyOffset[0] * _danglyOffset[0] +
+	                           _danglyOffset[1] * _danglyOffset[1] +
+	                           _danglyOffset[2] * _danglyOffset[2]);
+
+	if (length > _node->_displacement) {
+		const float scale = _node->_displacement / length;
+
+		for (int i = 0; i < 3; i++) {
+			_danglyOffset[i] *= scale;
+			_danglySpeed [i] *= scale;
+		}
+	}
+
+	// Rotate the offset into node space
+	const float *m = world.get();
+
+	float offset[3];
+	bool  changed = false;
+	for (int i = 0; i < 3; i++) {
+		const float *axis = m + i * 4;
+
+		const float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (axisLength > 0.0f)
+			offset[i] = (axis[0] * _danglyOffset[0] + axis[1] * _danglyOffset[1] + axis[2] * _danglyOffset[2]) / axisLength;
+		else
+			offset[i] = 0.0f;
+
+		if (ABS(offset[i] - _appliedOffset[i]) > 1.0e-5f)
+			changed = true;
+	}
+
+	if (!changed)
+		return false;
+
+	std::memcpy(_appliedOffset, offset, sizeof(offset));
+	return true;
+}
+
+void MeshDeformer::dangle() {
+	displace(_vertexCount, &_constraints[0], _appliedOffset,
+	         &_restX[0], &_restY[0], &_restZ[0], &_x[0], &_y[0], &_z[0]);
+
+	scatter(_vertexCount, _positionAttrib, &_x[0], &_y[0], &_z[0]);
+
+	_needUpload = true;
+}
+
+VertexBuffer &MeshDeformer::getVertexBuffer() {
+	if (_needUpload)
+		initGL();
+
+	return _vertexBuffer;
+}
+
+void MeshDeformer::initGL() {
+	_vertexBuffer.updateGL();
+
+	_needUpload = false;
+}
+
+void MeshDeformer::destroyGL() {
+	_vertexBuffer.destroyGL();
+
+	_needUpload = true;
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
@@ -0,0 +1,151 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/meshdeformer.h
+ *  Deforming dangly and skin meshes on the CPU.
+ */
+
+#ifndef GRAPHICS_AURORA_MESHDEFORMER_H
+#define GRAPHICS_AURORA_MESHDEFORMER_H
+
+#include <vector>
+
+#include "common/types.h"
+
+#include "graphics/vertexbuffer.h"
+
+#include "graphics/aurora/modelnode.h"
+
+namespace Common {
+	class TransformationMatrix;
+}
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** Deforms the mesh of a dangly or skin node every frame.
+ *
+ *  The rest pose of the mesh is kept as a structure of arrays, so that
+ *  the deformation kernels are simple loops over contiguous floats. The
+ *  skinning kernels work on four vertices at once with SSE2, if available.
+ *  The result is written into the deformer's own copy of the vertex buffer,
+ *  which is streamed into OpenGL when drawn.
+ *
+ *  Skin vertices follow the bones they are weighted to. Dangly vertices
+ *  lag behind the movement of their node, swinging back like a damped
+ *  spring, scaled by their per-vertex constraint.
+ */
+class MeshDeformer {
+public:
+	/** Create a deformer for the node's mesh. The node's model transformation needs to be its rest pose. */
+	MeshDeformer(ModelNode &node);
+	~MeshDeformer();
+
+	/** Deform the mesh into the current pose of the model's nodes.
+	 *
+	 *  @param dt The time passed since the last deformation, in seconds.
+	 *  @param modelPosition The model's transformation into world space.
+	 */
+	void deform(float dt, const Common::TransformationMatrix &modelPosition);
+
+	/** Get the deformed vertices, uploading any changes into OpenGL. Must be called from the main thread. */
+	VertexBuffer &getVertexBuffer();
+
+	/** Create the vertex buffer object and upload the current mesh. Must be called from the main thread. */
+	void initGL();
+	/** Destroy the vertex buffer object. */
+	void destroyGL();
+
+private:
+	ModelNode *_node; ///< The node we deform.
+
+	VertexBuffer _vertexBuffer; ///< The deformed mesh.
+	bool _needUpload;           ///< Did the deformed mesh change since the last upload?
+
+	uint32 _vertexCount;
+
+	VertexAttrib _positionAttrib; ///< The position attribute within _vertexBuffer.
+	VertexAttrib _normalAttrib;   ///< The normal attribute within _vertexBuffer.
+	bool _hasNormals;             ///< Do we have usable normals?
+
+	std::vector<float> _restX,  _restY,  _restZ;  ///< Rest pose vertex positions.
+	std::vector<float> _restNX, _restNY, _restNZ; ///< Rest pose vertex normals.
+
+	std::vector<float> _x,  _y,  _z;  ///< Deformed vertex positions.
+	std::vector<float> _nx, _ny, _nz; ///< Deformed vertex normals.
+
+
+	// Skin
+
+	std::vector<const ModelNode *> _bones; ///< The bones the skin is weighted to.
+
+	/** Per bone, the transformation from the skin's rest pose into the bone's rest pose. */
+	std::vector<float> _bindPoses;
+	/** Per bone, the transformation from the skin's rest pose into its current pose. Identity first. */
+	std::vector<float> _boneMatrices;
+	/** Scratch space for calculating the next bone matrices. */
+	std::vector<float> _newBoneMatrices;
+
+	uint32 _influences; ///< Number of bone influences used by any vertex.
+
+	/** Per-vertex indices into _boneMatrices, for each influence. */
+	std::vector<uint32> _boneIndices[ModelNode::kSkinInfluences];
+	/** Per-vertex bone weights, for each influence. */
+	std::vector<float>  _boneWeights[ModelNode::kSkinInfluences];
+
+
+	// Dangly
+
+	std::vector<float> _constraints; ///< Per-vertex dangly constraints, 0.0 - 1.0.
+
+	bool  _hasLastPosition;  ///< Do we know where the node was at the last deformation?
+	float _lastPosition [3]; ///< The node's world position at the last deformation.
+	float _danglyOffset [3]; ///< The current world space displacement of the dangly vertices.
+	float _danglySpeed  [3]; ///< The current speed of the dangly displacement.
+	float _appliedOffset[3]; ///< The node space displacement currently in the deformed mesh.
+
+
+	/** Find a node by name within the node hierarchy starting at this node. */
+	static const ModelNode *findNode(const ModelNode &node, const Common::UString &name);
+
+	void loadRestPose();
+	void loadSkin();
+	void loadDangly();
+
+	/** Calculate the current bone matrices. Returns false if they didn't change. */
+	bool updateBones();
+	/** Move the dangly displacement along. Returns false if it didn't change. */
+	bool updateDangly(float dt, const Common::TransformationMatrix &modelPosition);
+
+	void skin();
+	void dangle();
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_MESHDEFORMER_H
@@ -27,10 +27,16 @@
  *  A 3D model of an object.
  */
 
+#include <cstring>
+
 #include <SDL_timer.h>
 
 #include "common/stream.h"
 #include "common/debug.h"
+#include "common/error.h"
+#include "common/hash.h"
+#include "common/file.h"
+#include "common/filepath.h"
 
 #include "graphics/graphics.h"
 #include "graphics/camera.h"
@@ -38,6 +44,8 @@
 #include "graphics/aurora/model.h"
 #include "graphics/aurora/animation.h"
 #include "graphics/aurora/modelnode.h"
+#include "graphics/aurora/cachedmodel.h"
+#include "graphics/aurora/meshdeformer.h"
 
 using Common::kDebugGraphics;
 
@@ -47,11 +55,9 @@ namespace Aurora {
 
 Model::Model(ModelType type) : Renderable((RenderableType) type),
 	_type(type), _supermodel(0), _currentState(0),
-	_currentAnimation(0), _nextAnimation(0), _drawBound(false),
-	_lists(0) {
-
-	for (int i = 0; i < kRenderPassAll; i++)
-		_needBuild[i] = true;
+	_currentAnimation(0), _nextAnimation(0),
+	_boundAnimation(0), _boundState(0), _boundScale(1.0f), _partiallyVisible(false),
+	_hasDeformers(false), _instanceCount(0), _drawBound(false) {
 
 	_position[0] = 0.0; _position[1] = 0.0; _position[2] = 0.0;
 	_rotation[0] = 0.0; _rotation[1] = 0.0; _rotation[2] = 0.0;
@@ -68,8 +74,12 @@ Model::Model(ModelType type) : Renderable((RenderableType) type),
 Model::~Model() {
 	hide();
 
-	if (_lists != 0)
-		GfxMan.abandon(_lists, kRenderPassAll);
+	// Make sure the main thread doesn't touch our buffers while we're deleting them
+	GLContainer::removeFromQueue(kQueueNewGLContainer);
+	GLContainer::removeFromQueue(kQueueGLContainer);
+
+	for (std::list<const Model *>::iterator s = _geometrySources.begin(); s != _geometrySources.end(); ++s)
+		(*s)->_instanceCount--;
 
 	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
 		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
@@ -137,7 +147,6 @@ float Model::getDepth() const {
 
 void Model::drawBound(bool enabled) {
 	_drawBound = enabled;
-	needRebuild();
 }
 
 void Model::playAnimation(const Common::UString &anim, bool restart, int32 loopCount) {
@@ -195,8 +204,6 @@ void Model::setPosition(float x, float y, float z) {
 
 	createAbsolutePosition();
 	calculateDistance();
-	needRebuild();
-
 	resort();
 
 	GfxMan.unlockFrame();
@@ -211,8 +218,6 @@ void Model::setRotation(float x, float y, float z) {
 
 	createAbsolutePosition();
 	calculateDistance();
-	needRebuild();
-
 	resort();
 
 	GfxMan.unlockFrame();
@@ -255,6 +260,29 @@ void Model::createAbsolutePosition() {
 	_absoluteBoundBox = _boundBox;
 	_absoluteBoundBox.transform(_absolutePosition);
 	_absoluteBoundBox.absolutize();
+
+	createNodeWorldBounds();
+}
+
+void Model::createNodeWorldBounds() {
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
+		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n) {
+			if (!(*n)->_cullable)
+				continue;
+
+			(*n)->_worldBoundBox = (*n)->_absoluteBoundBox;
+			(*n)->_worldBoundBox.transform(_absolutePosition);
+			(*n)->_worldBoundBox.absolutize();
+		}
+	}
+}
+
+void Model::createNodeCulling() {
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
+		for (NodeList::iterator n = (*s)->rootNodes.begin(); n != (*s)->rootNodes.end(); ++n)
+			(*n)->createCulling(false);
+
+	createNodeWorldBounds();
 }
 
 const std::list<Common::UString> &Model::getStates() const {
@@ -296,8 +324,6 @@ void Model::setState(const Common::UString &name) {
 	if (visible)
 		show();
 
-	needRebuild();
-
 	GfxMan.unlockFrame();
 }
 
@@ -335,6 +361,17 @@ ModelNode *Model::getNode(const Common::UString &node) {
 	return n->second;
 }
 
+ModelNode *Model::getOwnNode(const Common::UString &node) {
+	if (!_currentState)
+		return 0;
+
+	NodeMap::iterator n = _currentState->nodeMap.find(node);
+	if (n == _currentState->nodeMap.end())
+		return 0;
+
+	return n->second;
+}
+
 const ModelNode *Model::getNode(const Common::UString &node) const {
 	if (!_currentState)
 		return 0;
@@ -363,6 +400,17 @@ Animation *Model::getAnimation(const Common::UString &anim) {
 	return n->second;
 }
 
+bool Model::isNodeAnimated(const Common::UString &node) const {
+	for (AnimationMap::const_iterator a = _animationMap.begin(); a != _animationMap.end(); ++a)
+		if (a->second->animatesNode(node))
+			return true;
+
+	if (_supermodel)
+		return _supermodel->isNodeAnimated(node);
+
+	return false;
+}
+
 float Model::getAnimationScale(const Common::UString &anim) {
 	// TODO: We can cache this for performance
 	AnimationMap::iterator n = _animationMap.find(anim);
@@ -401,53 +449,9 @@ void Model::calculateDistance() {
 	_distance = x + y + z;
 }
 
-bool Model::buildList(RenderPass pass) {
-	if (!_needBuild[pass])
-		return false;
-
-	if (_lists == 0)
-		_lists = glGenLists(kRenderPassAll);
-
-	glNewList(_lists + pass, GL_COMPILE);
-
-
-	// Apply our global model transformation
-
-	glScalef(_modelScale[0], _modelScale[1], _modelScale[2]);
-
-	if (_type == kModelTypeObject)
-		// Aurora world objects have a rotated axis
-		glRotatef(90.0, -1.0, 0.0, 0.0);
-
-	glTranslatef(_position[0], _position[1], _position[2]);
-
-	glRotatef( _rotation[0], 1.0, 0.0, 0.0);
-	glRotatef( _rotation[1], 0.0, 1.0, 0.0);
-	glRotatef(-_rotation[2], 0.0, 0.0, 1.0);
-
-
-	// Draw the bounding box, if requested
-	doDrawBound();
-
-	// Draw the nodes
-	for (NodeList::iterator n = _currentState->rootNodes.begin();
-	     n != _currentState->rootNodes.end(); ++n) {
-
-		glPushMatrix();
-		(*n)->render(pass);
-		glPopMatrix();
-	}
-
-
-	glEndList();
-
-
-	_needBuild[pass] = false;
-	return true;
-}
-
 void Model::advanceTime(float dt) {
 	manageAnimations(dt);
+	deformMeshes(dt);
 }
 
 void Model::manageAnimations(float dt) {
@@ -490,8 +494,137 @@ void Model::manageAnimations(float dt) {
 	}
 
 	// Update the animation, if we have any
-	if (_currentAnimation)
-		_currentAnimation->update(this, lastFrame, nextFrame);
+	if (_currentAnimation) {
+		if ((_currentAnimation != _boundAnimation) || (_currentState != _boundState))
+			bindAnimation();
+
+		_currentAnimation->update(_animationTargets, lastFrame, nextFrame, _boundScale);
+	}
+}
+
+void Model::createModelTransforms() {
+	const Common::TransformationMatrix identity;
+
+	for (NodeList::iterator n = _currentState->rootNodes.begin(); n != _currentState->rootNodes.end(); ++n)
+		(*n)->createModelTransform(identity);
+}
+
+void Model::createDeformers() {
+	State *currentState = _currentState;
+
+	// The deformers take the nodes' current transformations as their rest pose
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
+		_currentState = *s;
+
+		createModelTransforms();
+
+		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n) {
+			delete (*n)->_deformer;
+			(*n)->_deformer = 0;
+
+			if (!(*n)->isDeformable())
+				continue;
+
+			(*n)->_deformer = new MeshDeformer(**n);
+			_hasDeformers   = true;
+		}
+	}
+
+	_currentState = currentState;
+}
+
+void Model::deformMeshes(float dt) {
+	if (!_hasDeformers || !_currentState)
+		return;
+
+	createModelTransforms();
+
+	for (NodeList::iterator n = _currentState->nodeList.begin(); n != _currentState->nodeList.end(); ++n)
+		if ((*n)->_deformer)
+			(*n)->_deformer->deform(dt, _absolutePosition);
+}
+
+void Model::bindAnimation() {
+	_boundAnimation = _currentAnimation;
+	_boundState     = _currentState;
+	_boundScale     = getAnimationScale(_currentAnimation->getName());
+
+	_currentAnimation->bind(*this, _animationTargets);
+}
+
+Model *Model::createInstance() const {
+	Model *model = new Model(_type);
+
+	model->instantiate(*this);
+
+	return model;
+}
+
+uint32 Model::getInstanceCount() const {
+	return _instanceCount;
+}
+
+void Model::instantiate(const Model &source) {
+	_fileName       = source._fileName;
+	_name           = source._name;
+	_superModelName = source._superModelName;
+	_supermodel     = source._supermodel;
+	_animationScale = source._animationScale;
+
+	memcpy(_modelScale, source._modelScale, 3 * sizeof(float));
+
+	// Animations only ever change the nodes they're bound to, so they can be shared
+	_animationMap      = source._animationMap;
+	_defaultAnimations = source._defaultAnimations;
+
+	// Copy the nodes of all states
+	std::map<const ModelNode *, ModelNode *> nodes;
+
+	for (StateList::const_iterator s = source._stateList.begin(); s != source._stateList.end(); ++s) {
+		State *state = new State;
+
+		state->name = (*s)->name;
+
+		for (NodeList::const_iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n) {
+			ModelNode *node = new ModelNode(*this, **n);
+
+			nodes.insert(std::make_pair(*n, node));
+
+			state->nodeList.push_back(node);
+			state->nodeMap.insert(std::make_pair(node->getName(), node));
+		}
+
+		_stateList.push_back(state);
+		_stateMap.insert(std::make_pair(state->name, state));
+	}
+
+	// Link the copies up the same way the source nodes are
+	for (std::map<const ModelNode *, ModelNode *>::iterator n = nodes.begin(); n != nodes.end(); ++n) {
+		const ModelNode &sourceNode = *n->first;
+		ModelNode &node = *n->second;
+
+		std::map<const ModelNode *, ModelNode *>::iterator parent = nodes.find(sourceNode._parent);
+		if (parent != nodes.end())
+			node._parent = parent->second;
+
+		for (std::list<ModelNode *>::const_iterator c = sourceNode._children.begin();
+		     c != sourceNode._children.end(); ++c) {
+
+			std::map<const ModelNode *, ModelNode *>::iterator child = nodes.find(*c);
+			if (child != nodes.end())
+				node._children.push_back(child->second);
+		}
+	}
+
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s)
+		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
+			if (!(*n)->getParent())
+				(*s)->rootNodes.push_back(*n);
+
+	finalize();
+
+	_geometrySources.push_back(&source);
+	source._instanceCount++;
 }
 
 void Model::render(RenderPass pass) {
@@ -499,14 +632,53 @@ void Model::render(RenderPass pass) {
 		return;
 
 	if (pass == kRenderPassAll) {
+		glPushMatrix();
 		Model::render(kRenderPassOpaque);
+		glPopMatrix();
+
+		glPushMatrix();
 		Model::render(kRenderPassTransparent);
+		glPopMatrix();
 		return;
 	}
 
-	// Render
-	buildList(pass);
-	glCallList(_lists + pass);
+	// Cull world objects outside the view frustum. If they're only partially
+	// visible, their nodes are tested individually
+	_partiallyVisible = false;
+	if (_type == kModelTypeObject) {
+		Frustum::Intersection visibility = GfxMan.getFrustum().test(_absoluteBoundBox);
+		if (visibility == Frustum::kOutside)
+			return;
+
+		_partiallyVisible = visibility == Frustum::kIntersect;
+	}
+
+	// Apply our global model transformation
+
+	glScalef(_modelScale[0], _modelScale[1], _modelScale[2]);
+
+	if (_type == kModelTypeObject)
+		// Aurora world objects have a rotated axis
+		glRotatef(90.0, -1.0, 0.0, 0.0);
+
+	glTranslatef(_position[0], _position[1], _position[2]);
+
+	glRotatef( _rotation[0], 1.0, 0.0, 0.0);
+	glRotatef( _rotation[1], 0.0, 1.0, 0.0);
+	glRotatef(-_rotation[2], 0.0, 0.0, 1.0);
+
+
+	// Draw the bounding box, if requested
+	doDrawBound();
+
+	// Draw the nodes
+	for (NodeList::iterator n = _currentState->rootNodes.begin();
+	     n != _currentState->rootNodes.end(); ++n) {
+
+		glPushMatrix();
+		(*n)->render(pass);
+		glPopMatrix();
+	}
 
 	// Reset the first texture units
 	TextureMan.reset();
@@ -569,15 +741,30 @@ void Model::doDrawBound() {
 }
 
 void Model::doRebuild() {
-	needRebuild();
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
+		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n) {
+			// Nodes that share another node's geometry leave it to that node's model
+			if ((*n)->_geometry == *n) {
+				(*n)->_vertexBuffer.initGL();
+				(*n)->_indexBuffer.initGL();
+			}
+
+			if ((*n)->_deformer)
+				(*n)->_deformer->initGL();
+		}
+	}
 }
 
 void Model::doDestroy() {
-	if (_lists == 0)
-		return;
+	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
+		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n) {
+			(*n)->_vertexBuffer.destroyGL();
+			(*n)->_indexBuffer.destroyGL();
 
-	glDeleteLists(_lists, kRenderPassAll);
-	_lists = 0;
+			if ((*n)->_deformer)
+				(*n)->_deformer->destroyGL();
+		}
+	}
 }
 
 void Model::finalize() {
@@ -593,14 +780,79 @@ void Model::finalize() {
 		for (NodeList::iterator n = (*s)->rootNodes.begin(); n != (*s)->rootNodes.end(); ++n)
 			(*n)->orderChildren();
 
-	needRebuild();
+	createDeformers();
+	createNodeCulling();
 
 	_currentAnimation = selectDefaultAnimation();
+
+	// Create the buffer objects in the main thread, before the next frame is drawn
+	GLContainer::addToQueue(kQueueNewGLContainer);
 }
 
-void Model::needRebuild() {
-	for (int i = 0; i < kRenderPassAll; i++)
-		_needBuild[i] = true;
+uint64 Model::hashSource(Common::SeekableReadStream *&source, uint64 hash) {
+	// Read the whole source into memory, so we only need to go to the disk once
+
+	const uint32 size = source->size();
+	byte *data = new byte[size];
+
+	source->seek(0);
+	if (source->read(data, size) != size) {
+		delete[] data;
+
+		throw Common::Exception(Common::kReadError);
+	}
+
+	delete source;
+	source = new Common::MemoryReadStream(data, size, true);
+
+	return Common::hashDataFNV64(data, size, hash);
+}
+
+static Common::UString getCacheFile(const Common::UString &cacheDir, uint64 hash) {
+	return cacheDir + "/" + Common::formatHash(hash) + ".xmc";
+}
+
+bool Model::loadCached(const Common::UString &cacheDir, uint64 hash) {
+	const Common::UString cacheFile = getCacheFile(cacheDir, hash);
+
+	Common::File file;
+	if (!file.open(cacheFile))
+		return false;
+
+	try {
+		CachedModel::load(*this, file, hash);
+	} catch (Common::Exception &) {
+		// Outdated or broken cache entry, just load the model again
+		return false;
+	}
+
+	return true;
+}
+
+void Model::saveCached(const Common::UString &cacheDir, uint64 hash) const {
+	if (!Common::FilePath::createDirectories(cacheDir))
+		return;
+
+	const Common::UString cacheFile = getCacheFile(cacheDir, hash);
+
+	Common::DumpFile file;
+	if (!file.open(cacheFile)) {
+		warning("Can't write model cache file \"%s\"", cacheFile.c_str());
+		return;
+	}
+
+	try {
+		CachedModel::write(file, *this, hash);
+	} catch (Common::Exception &e) {
+		e.add("Failed writing model cache file \"%s\"", cacheFile.c_str());
+		Common::printException(e, "WARNING: ");
+		return;
+	}
+
+	if (!file.flush() || file.err())
+		warning("Failed writing model cache file \"%s\"", cacheFile.c_str());
+
+	file.close();
 }
 
 void Model::createStateNamesList() {
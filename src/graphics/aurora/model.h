@@ -123,6 +123,8 @@ public:
 	ModelNode *getNode(const Common::UString &node);
 	/** Get the specified node, from the current state. */
 	const ModelNode *getNode(const Common::UString &node) const;
+	/** Get the specified node, from the current state, without looking into the supermodel. */
+	ModelNode *getOwnNode(const Common::UString &node);
 
 
 	// Animation
@@ -141,6 +143,20 @@ public:
 	void playDefaultAnimation();
 
 
+	// Instancing
+
+	/** Create a new instance of this model.
+	 *
+	 *  The instance has its own nodes, position, state and animation, but
+	 *  shares the geometry and the animations with this model. This model
+	 *  needs to stay alive as long as any of its instances do.
+	 */
+	Model *createInstance() const;
+
+	/** Return the number of existing models that still use this model's geometry. */
+	uint32 getInstanceCount() const;
+
+
 	// Renderable
 	void calculateDistance();
 	void render(RenderPass pass);
@@ -195,6 +211,11 @@ protected:
 	Animation *_currentAnimation; ///< The currently playing animations.
 	Animation *_nextAnimation;    ///< The animation that's scheduled next.
 
+	Animation *_boundAnimation;    ///< The animation the targets are bound for.
+	State     *_boundState;        ///< The state the targets are bound for.
+	float      _boundScale;        ///< The scale of the bound animation.
+	std::vector<ModelNode *> _animationTargets; ///< The nodes the current animation updates.
+
 	int32 _loopAnimation; ///< Number of times to loop the current animation.
 
 	float _animationScale; ///< The scale of the animation.
@@ -215,17 +236,47 @@ protected:
 	/** The model's box after translate/rotate. */
 	Common::BoundingBox _absoluteBoundBox;
 
+	/** Is the model only partially within the view frustum in this render pass? */
+	bool _partiallyVisible;
+
+	/** Does any node of the model have a mesh deformed on the CPU? */
+	bool _hasDeformers;
+
+	/** The models whose geometry our nodes use, i.e. what we're an instance of.
+	 *
+	 *  Nodes taken over from other instances (see ModelNode::addChild()) bring
+	 *  their model's references with them.
+	 */
+	std::list<const Model *> _geometrySources;
+	/** The number of existing models using this model's geometry. */
+	mutable uint32 _instanceCount;
+
 
 	// Animation
 
 	/** Get the animation from its name. */
 	Animation *getAnimation(const Common::UString &anim);
 
+	/** Is there any animation that moves the node with this name? */
+	bool isNodeAnimated(const Common::UString &node) const;
+
 
 	/** Finalize the loading procedure. */
 	void finalize();
-	/** Signal that the nodes changed and the OpenGL list needs to be rebuild. */
-	void needRebuild();
+
+
+	// Model cache
+
+	/** Read the model source completely into memory, and hash it for the model cache.
+	 *
+	 *  The stream is replaced by a memory stream of the same data.
+	 */
+	static uint64 hashSource(Common::SeekableReadStream *&source, uint64 hash);
+
+	/** Try to restore the model from the cache. Returns false if there's no valid entry. */
+	bool loadCached(const Common::UString &cacheDir, uint64 hash);
+	/** Store the loaded, not yet finalized model in the cache. */
+	void saveCached(const Common::UString &cacheDir, uint64 hash) const;
 
 
 	// GLContainer
@@ -234,23 +285,33 @@ protected:
 
 
 private:
-	bool _needBuild[kRenderPassAll];
 	bool _drawBound;
 	float _elapsedTime; ///< Track animation duration
 
-	ListID _lists; ///< OpenGL display lists for the model
-
-
-	bool buildList(RenderPass pass);
-
 	void createStateNamesList(); ///< Create the list of all state names.
 	void createBound();          ///< Create the model's bounding box.
 
 	void createAbsolutePosition();
+	/** Move the nodes' bounding boxes into world space, for culling. */
+	void createNodeWorldBounds();
+	/** Find the nodes that are never moved by an animation and can be culled. */
+	void createNodeCulling();
 
 	void doDrawBound();
 	void manageAnimations(float dt);
 
+	/** Calculate the current transformations of the current state's nodes. */
+	void createModelTransforms();
+	/** Create the CPU deformers for all dangly and skin meshes. */
+	void createDeformers();
+	/** Deform the dangly and skin meshes into the current pose. */
+	void deformMeshes(float dt);
+	/** Bind the current animation's nodes to our own nodes. */
+	void bindAnimation();
+
+	/** Turn this empty model into an instance of the source model. */
+	void instantiate(const Model &source);
+
 	Animation *selectDefaultAnimation() const;
 
 
@@ -268,6 +329,8 @@ public:
 	                      uint32 offset, uint32 count, std::vector<T> &values);
 
 	friend class ModelNode;
+	friend class StaticGeometry;
+	friend class CachedModel;
 };
 
 } // End of namespace Aurora
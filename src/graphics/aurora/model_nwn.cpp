@@ -31,14 +31,21 @@
 #pragma GCC diagnostic ignored "-Wunused-variable"
 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
 
+#include <cstring>
+
+#include <algorithm>
+
 #include <boost/unordered_set.hpp>
 
+#include "common/util.h"
 #include "common/error.h"
 #include "common/maths.h"
 #include "common/debug.h"
 #include "common/stream.h"
 #include "common/streamtokenizer.h"
 #include "common/vector3.h"
+#include "common/configman.h"
+#include "common/hash.h"
 
 #include "aurora/types.h"
 #include "aurora/resman.h"
@@ -46,6 +53,7 @@
 #include "graphics/aurora/model_nwn.h"
 #include "graphics/aurora/animation.h"
 #include "graphics/aurora/animnode.h"
+#include "graphics/aurora/cachedmodel.h"
 
 using Common::kDebugGraphics;
 
@@ -172,7 +180,8 @@ bool Model_NWN::ParserContext::findNode(const Common::UString &name,
 
 
 Model_NWN::Model_NWN(const Common::UString &name, ModelType type,
-                     const Common::UString &texture, std::map<Common::UString, Model *, Common::UString::iless> *modelCache) :
+                     const Common::UString &texture, std::map<Common::UString, Model *, Common::UString::iless> *modelCache,
+                     bool instanceSource) :
 	Model(type) {
 
 	if (_type == kModelTypeGUIFront) {
@@ -185,10 +194,25 @@ Model_NWN::Model_NWN(const Common::UString &name, ModelType type,
 
 	ParserContext ctx(name, texture);
 
-	if (ctx.isASCII)
-		loadASCII(ctx);
-	else
-		loadBinary(ctx);
+	// Look for an already loaded version of the model in the model cache
+	const Common::UString cacheDir = ConfigMan.getString("modelcache");
+
+	uint64 hash   = 0;
+	bool   cached = false;
+	if (!cacheDir.empty()) {
+		hash   = hashModel(ctx);
+		cached = loadCached(cacheDir, hash);
+	}
+
+	if (!cached) {
+		if (ctx.isASCII)
+			loadASCII(ctx);
+		else
+			loadBinary(ctx);
+
+		if (!cacheDir.empty())
+			saveCached(cacheDir, hash);
+	}
 
 	if (!_superModelName.empty() && _superModelName != "NULL") {
 		if ((*modelCache).count(_superModelName)>0)
@@ -202,12 +226,26 @@ Model_NWN::Model_NWN(const Common::UString &name, ModelType type,
 	// These are usually inherited from a supermodel
 	populateDefaultAnimations();
 
-	finalize();
+	// Instances finalize themselves, but draw with our buffers
+	if (!instanceSource)
+		finalize();
+	else
+		GLContainer::addToQueue(kQueueNewGLContainer);
 }
 
 Model_NWN::~Model_NWN() {
 }
 
+uint64 Model_NWN::hashModel(ParserContext &ctx) const {
+	// Everything that changes the loaded model needs to change the hash too
+	const uint32 version = CachedModel::kVersion;
+
+	uint64 hash = Common::hashDataFNV64((const byte *) &version, sizeof(version));
+	hash = Common::hashDataFNV64((const byte *) ctx.texture.c_str(), strlen(ctx.texture.c_str()) + 1, hash);
+
+	return hashSource(ctx.mdl, hash);
+}
+
 void Model_NWN::loadBinary(ParserContext &ctx) {
 	ctx.mdl->seek(4);
 
@@ -266,6 +304,9 @@ void Model_NWN::loadBinary(ParserContext &ctx) {
 	ctx.mdl->seek(ctx.offModelData + nodeHeadPointer);
 	rootNode->load(ctx);
 
+	for (std::list<ModelNode *>::iterator n = ctx.nodes.begin(); n != ctx.nodes.end(); ++n)
+		static_cast<ModelNode_NWN_Binary *>(*n)->resolveSkinBones(ctx);
+
 	addState(ctx);
 
 	std::vector<uint32> animOffsets;
@@ -506,7 +547,7 @@ void Model_NWN::populateDefaultAnimations() {
 }
 
 
-ModelNode_NWN_Binary::ModelNode_NWN_Binary(Model &model) : ModelNode(model) {
+ModelNode_NWN_Binary::ModelNode_NWN_Binary(Model &model) : ModelNode(model), _partNumber(0xFFFFFFFF) {
 	_hasTransparencyHint = true;
 	_transparencyHint = false;
 }
@@ -518,7 +559,8 @@ void ModelNode_NWN_Binary::load(Model_NWN::ParserContext &ctx) {
 	ctx.mdl->skip(24); // Function pointers
 
 	uint32 inheritColorFlag = ctx.mdl->readUint32LE();
-	uint32 partNumber       = ctx.mdl->readUint32LE();
+
+	_partNumber = ctx.mdl->readUint32LE();
 
 	_name.readFixedASCII(*ctx.mdl, 32);
 
@@ -568,8 +610,7 @@ void ModelNode_NWN_Binary::load(Model_NWN::ParserContext &ctx) {
 	}
 
 	if (flags & kNodeFlagHasSkin) {
-		// TODO: Skin
-		ctx.mdl->skip(0x64);
+		readSkin(ctx);
 	}
 
 	if (flags & kNodeFlagHasAnim) {
@@ -577,8 +618,7 @@ void ModelNode_NWN_Binary::load(Model_NWN::ParserContext &ctx) {
 	}
 
 	if (flags & kNodeFlagHasDangly) {
-		// TODO: Dangly
-		ctx.mdl->skip(0x18);
+		readDangly(ctx);
 	}
 
 	if (flags & kNodeFlagHasAABB) {
@@ -895,11 +935,119 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 
 	_vertexBuffer.setVertexDecl(vertexDecl);
 
+	// Remember where the vertices came from, for the per-vertex skin and dangly data
+	_vertexSources.resize(vertexCountNew);
+	for (uint32 i = 0; i < vertexCount; i++)
+		_vertexSources[i] = i;
+	for (uint32 i = 0; i < new_verts_norms.size(); i++)
+		_vertexSources[vertexCount + i] = new_verts_norms[i].vi;
+
 	createBound();
 
 	ctx.mdl->seekTo(endPos);
 }
 
+void ModelNode_NWN_Binary::readSkin(Model_NWN::ParserContext &ctx) {
+	ctx.mdl->skip(12); // Weights array
+
+	uint32 weightsOffset  = ctx.mdl->readUint32LE();
+	uint32 boneRefsOffset = ctx.mdl->readUint32LE();
+
+	ctx.mdl->skip(4 + 4); // Node to bone map offset + count
+
+	ctx.mdl->skip(12); // Inverse bone rotations
+	ctx.mdl->skip(12); // Inverse bone translations
+	ctx.mdl->skip(12); // Bone constant indices
+
+	// The part numbers of the nodes acting as the skin's bones, -1 if unused
+	_skinBoneParts.resize(17);
+	for (uint32 i = 0; i < 17; i++)
+		_skinBoneParts[i] = (uint32) ((int32) ctx.mdl->readSint16LE());
+
+	ctx.mdl->skip(2); // Padding
+
+	if (_vertexSources.empty() || (weightsOffset == 0xFFFFFFFF) || (boneRefsOffset == 0xFFFFFFFF)) {
+		_skinBoneParts.clear();
+		return;
+	}
+
+	uint32 endPos = ctx.mdl->pos();
+
+	uint32 sourceCount = 0;
+	for (std::vector<uint32>::const_iterator v = _vertexSources.begin(); v != _vertexSources.end(); ++v)
+		sourceCount = MAX(sourceCount, *v + 1);
+
+	// Each vertex is influenced by up to 4 bones
+	std::vector<float> weights(sourceCount * kSkinInfluences);
+	std::vector<uint8> boneRefs(sourceCount * kSkinInfluences);
+
+	ctx.mdl->seekTo(ctx.offRawData + weightsOffset);
+	for (uint32 i = 0; i < weights.size(); i++)
+		weights[i] = ctx.mdl->readIEEEFloatLE();
+
+	ctx.mdl->seekTo(ctx.offRawData + boneRefsOffset);
+	for (uint32 i = 0; i < boneRefs.size(); i++) {
+		const int16 bone = ctx.mdl->readSint16LE();
+
+		boneRefs[i] = ((bone >= 0) && (bone < 17)) ? bone : 0xFF;
+	}
+
+	_skinBoneIndices.resize(_vertexSources.size() * kSkinInfluences);
+	_skinWeights.resize(_vertexSources.size() * kSkinInfluences);
+
+	for (uint32 i = 0; i < _vertexSources.size(); i++) {
+		for (uint32 j = 0; j < kSkinInfluences; j++) {
+			_skinBoneIndices[i * kSkinInfluences + j] = boneRefs[_vertexSources[i] * kSkinInfluences + j];
+			_skinWeights    [i * kSkinInfluences + j] = weights [_vertexSources[i] * kSkinInfluences + j];
+		}
+	}
+
+	ctx.mdl->seekTo(endPos);
+}
+
+void ModelNode_NWN_Binary::resolveSkinBones(const Model_NWN::ParserContext &ctx) {
+	if (_skinBoneParts.empty())
+		return;
+
+	_skinBones.resize(_skinBoneParts.size());
+
+	for (std::list<ModelNode *>::const_iterator n = ctx.nodes.begin(); n != ctx.nodes.end(); ++n) {
+		const ModelNode_NWN_Binary &node = *static_cast<const ModelNode_NWN_Binary *>(*n);
+
+		for (uint32 i = 0; i < _skinBoneParts.size(); i++)
+			if (_skinBoneParts[i] == node._partNumber)
+				_skinBones[i] = node._name;
+	}
+
+	_skinBoneParts.clear();
+}
+
+void ModelNode_NWN_Binary::readDangly(Model_NWN::ParserContext &ctx) {
+	uint32 constraintsOffset, constraintsCount;
+	Model::readArrayDef(*ctx.mdl, constraintsOffset, constraintsCount);
+
+	_displacement = ctx.mdl->readIEEEFloatLE();
+	_tightness    = ctx.mdl->readIEEEFloatLE();
+	_period       = ctx.mdl->readIEEEFloatLE();
+
+	if (_vertexSources.empty())
+		return;
+
+	_dangly = true;
+
+	uint32 endPos = ctx.mdl->pos();
+
+	std::vector<float> constraints;
+	Model::readArray(*ctx.mdl, ctx.offModelData + constraintsOffset, constraintsCount, constraints);
+
+	// One constraint per vertex in the model file
+	_constraints.resize(_vertexSources.size());
+	for (uint32 i = 0; i < _vertexSources.size(); i++)
+		_constraints[i] = (_vertexSources[i] < constraints.size()) ? constraints[_vertexSources[i]] : 0.0;
+
+	ctx.mdl->seekTo(endPos);
+}
+
 void ModelNode_NWN_Binary::readAnim(Model_NWN::ParserContext &ctx) {
 	float samplePeriod = ctx.mdl->readIEEEFloatLE();
 
@@ -1076,16 +1224,22 @@ void ModelNode_NWN_ASCII::load(Model_NWN::ParserContext &ctx,
 			line[1].parse(_transparencyHint);
 		} else if (line[0] == "danglymesh") {
 			line[1].parse(_dangly);
+		} else if (line[0] == "displacement") {
+			line[1].parse(_displacement);
+		} else if (line[0] == "tightness") {
+			line[1].parse(_tightness);
+		} else if (line[0] == "period") {
+			line[1].parse(_period);
 		} else if (line[0] == "constraints") {
 			uint32 n;
 
 			line[1].parse(n);
-			readConstraints(ctx, n);
+			readConstraints(ctx, mesh, n);
 		} else if (line[0] == "weights") {
 			uint32 n;
 
 			line[1].parse(n);
-			readWeights(ctx, n);
+			readWeights(ctx, mesh, n);
 		} else if (line[0] == "bitmap") {
 			mesh.textures.push_back(line[1]);
 		} else if (line[0] == "verts") {
@@ -1116,7 +1270,9 @@ void ModelNode_NWN_ASCII::load(Model_NWN::ParserContext &ctx,
 	processMesh(mesh);
 }
 
-void ModelNode_NWN_ASCII::readConstraints(Model_NWN::ParserContext &ctx, uint32 n) {
+void ModelNode_NWN_ASCII::readConstraints(Model_NWN::ParserContext &ctx, Mesh &mesh, uint32 n) {
+	mesh.constraints.resize(n);
+
 	for (uint32 i = 0; i < n; ) {
 		std::vector<Common::UString> line;
 
@@ -1128,15 +1284,20 @@ void ModelNode_NWN_ASCII::readConstraints(Model_NWN::ParserContext &ctx, uint32
 		if ((count == 0) || line[0].empty() || (*line[0].begin() == '#'))
 			continue;
 
+		line[0].parse(mesh.constraints[i]);
+
 		i++;
 	}
 }
 
-void ModelNode_NWN_ASCII::readWeights(Model_NWN::ParserContext &ctx, uint32 n) {
+void ModelNode_NWN_ASCII::readWeights(Model_NWN::ParserContext &ctx, Mesh &mesh, uint32 n) {
+	mesh.boneIndices.resize(n * kSkinInfluences, 0xFF);
+	mesh.boneWeights.resize(n * kSkinInfluences, 0.0);
+
 	for (uint32 i = 0; i < n; ) {
 		std::vector<Common::UString> line;
 
-		int count = ctx.tokenize->getTokens(*ctx.mdl, line, 1);
+		int count = ctx.tokenize->getTokens(*ctx.mdl, line, 1, 2 * kSkinInfluences);
 
 		ctx.tokenize->nextChunk(*ctx.mdl);
 
@@ -1144,6 +1305,18 @@ void ModelNode_NWN_ASCII::readWeights(Model_NWN::ParserContext &ctx, uint32 n) {
 		if ((count == 0) || line[0].empty() || (*line[0].begin() == '#'))
 			continue;
 
+		// Pairs of bone node name and weight
+		for (uint32 j = 0; (2 * j + 1) < (uint32) count; j++) {
+			std::vector<Common::UString>::iterator bone =
+				std::find(_skinBones.begin(), _skinBones.end(), line[2 * j]);
+
+			if (bone == _skinBones.end())
+				bone = _skinBones.insert(_skinBones.end(), line[2 * j]);
+
+			mesh.boneIndices[i * kSkinInfluences + j] = bone - _skinBones.begin();
+			line[2 * j + 1].parse(mesh.boneWeights[i * kSkinInfluences + j]);
+		}
+
 		i++;
 	}
 }
@@ -1378,6 +1551,31 @@ void ModelNode_NWN_ASCII::processMesh(Mesh &mesh) {
 		}
 	}
 
+	// Per-vertex dangly and skin data
+	const bool hasConstraints = mesh.constraints.size() == mesh.vCount;
+	const bool hasWeights     = mesh.boneWeights.size() == (mesh.vCount * kSkinInfluences);
+
+	if (hasConstraints)
+		_constraints.resize(vertexCount);
+
+	if (hasWeights) {
+		_skinBoneIndices.resize(vertexCount * kSkinInfluences);
+		_skinWeights.resize(vertexCount * kSkinInfluences);
+	} else
+		_skinBones.clear();
+
+	for (verts_set_it i = verts.begin(); i != verts.end(); ++i) {
+		if (hasConstraints)
+			_constraints[i->i] = mesh.constraints[i->p];
+
+		if (hasWeights) {
+			for (uint32 j = 0; j < kSkinInfluences; j++) {
+				_skinBoneIndices[i->i * kSkinInfluences + j] = mesh.boneIndices[i->p * kSkinInfluences + j];
+				_skinWeights    [i->i * kSkinInfluences + j] = mesh.boneWeights[i->p * kSkinInfluences + j];
+			}
+		}
+	}
+
 	createBound();
 }
 
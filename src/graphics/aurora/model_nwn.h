@@ -48,8 +48,15 @@ class ModelNode_NWN_ASCII;
 /** A 3D model in the NWN MDL format. */
 class Model_NWN : public Model {
 public:
+	/** Load a model.
+	 *
+	 *  If instanceSource is true, the model is only loaded as the source of
+	 *  instances. It is never shown itself, so it isn't finalized and gets
+	 *  no mesh deformers.
+	 */
 	Model_NWN(const Common::UString &name, ModelType type = kModelTypeObject,
-	          const Common::UString &texture = "", std::map<Common::UString, Model*, Common::UString::iless> *modelCache = 0);
+	          const Common::UString &texture = "", std::map<Common::UString, Model*, Common::UString::iless> *modelCache = 0,
+	          bool instanceSource = false);
 	~Model_NWN();
 
 private:
@@ -82,6 +89,9 @@ private:
 	};
 
 
+	/** Hash the MDL and all loading parameters, for the model cache. */
+	uint64 hashModel(ParserContext &ctx) const;
+
 	void newState(ParserContext &ctx);
 	void addState(ParserContext &ctx);
 
@@ -105,9 +115,21 @@ public:
 
 	void load(Model_NWN::ParserContext &ctx);
 
+	/** Find the names of the skin's bones, once all nodes are loaded. */
+	void resolveSkinBones(const Model_NWN::ParserContext &ctx);
+
 private:
+	uint32 _partNumber; ///< The number identifying the node within the model.
+
+	/** For each vertex in the vertex buffer, the index of the vertex in the model file. */
+	std::vector<uint32> _vertexSources;
+	/** For each skin bone, the part number of its node. */
+	std::vector<uint32> _skinBoneParts;
+
 	void readMesh(Model_NWN::ParserContext &ctx);
+	void readSkin(Model_NWN::ParserContext &ctx);
 	void readAnim(Model_NWN::ParserContext &ctx);
+	void readDangly(Model_NWN::ParserContext &ctx);
 
 	void readNodeControllers(Model_NWN::ParserContext &ctx, uint32 offset,
                            uint32 count, std::vector<float> &data);
@@ -137,11 +159,16 @@ private:
 
 		std::vector<uint32> smooth, mat;
 
+		std::vector<float> constraints; ///< Dangly constraints, one per vertex.
+
+		std::vector<uint8> boneIndices; ///< Skin bone indices, 4 per vertex.
+		std::vector<float> boneWeights; ///< Skin bone weights, 4 per vertex.
+
 		Mesh();
 	};
 
-	void readConstraints(Model_NWN::ParserContext &ctx, uint32 n);
-	void readWeights(Model_NWN::ParserContext &ctx, uint32 n);
+	void readConstraints(Model_NWN::ParserContext &ctx, Mesh &mesh, uint32 n);
+	void readWeights(Model_NWN::ParserContext &ctx, Mesh &mesh, uint32 n);
 
 	void readFloats(const std::vector<Common::UString> &strings,
 	                float *floats, uint32 n, uint32 start);
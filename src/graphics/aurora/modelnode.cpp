@@ -38,6 +38,7 @@
 #include "graphics/aurora/modelnode.h"
 #include "graphics/aurora/model.h"
 #include "graphics/aurora/texture.h"
+#include "graphics/aurora/meshdeformer.h"
 
 namespace Graphics {
 
@@ -49,26 +50,26 @@ static bool nodeComp(ModelNode *a, ModelNode *b) {
 
 // OpenGL < 2 vertex attribute helper functions
 
-static void EnableVertexPos(const VertexAttrib &va) {
+static void EnableVertexPos(const VertexAttrib &va, const GLvoid *pointer) {
 	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(va.size, va.type, va.stride, va.pointer);
+	glVertexPointer(va.size, va.type, va.stride, pointer);
 }
 
-static void EnableVertexNorm(const VertexAttrib &va) {
+static void EnableVertexNorm(const VertexAttrib &va, const GLvoid *pointer) {
 	assert(va.size == 3);
 	glEnableClientState(GL_NORMAL_ARRAY);
-	glNormalPointer(va.type, va.stride, va.pointer);
+	glNormalPointer(va.type, va.stride, pointer);
 }
 
-static void EnableVertexCol(const VertexAttrib &va) {
+static void EnableVertexCol(const VertexAttrib &va, const GLvoid *pointer) {
 	glEnableClientState(GL_COLOR_ARRAY);
-	glColorPointer(va.size, va.type, va.stride, va.pointer);
+	glColorPointer(va.size, va.type, va.stride, pointer);
 }
 
-static void EnableVertexTex(const VertexAttrib &va) {
+static void EnableVertexTex(const VertexAttrib &va, const GLvoid *pointer) {
 	glClientActiveTextureARB(GL_TEXTURE0 + va.index - VTCOORD);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	glTexCoordPointer(va.size, va.type, va.stride, va.pointer);
+	glTexCoordPointer(va.size, va.type, va.stride, pointer);
 }
 
 static void DisableVertexPos(const VertexAttrib &va) {
@@ -88,15 +89,15 @@ static void DisableVertexTex(const VertexAttrib &va) {
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 }
 
-static void EnableVertexAttrib(const VertexAttrib &va) {
+static void EnableVertexAttrib(const VertexAttrib &va, const GLvoid *pointer) {
 	if (va.index == VPOSITION)
-		EnableVertexPos(va);
+		EnableVertexPos(va, pointer);
 	else if (va.index == VNORMAL)
-		EnableVertexNorm(va);
+		EnableVertexNorm(va, pointer);
 	else if (va.index == VCOLOR)
-		EnableVertexCol(va);
+		EnableVertexCol(va, pointer);
 	else if (va.index >= VTCOORD)
-		EnableVertexTex(va);
+		EnableVertexTex(va, pointer);
 }
 
 static void DisableVertexAttrib(const VertexAttrib &va) {
@@ -111,8 +112,9 @@ static void DisableVertexAttrib(const VertexAttrib &va) {
 }
 
 ModelNode::ModelNode(Model &model) :
-	_model(&model), _parent(0), _level(0),
-	_isTransparent(false), _render(false), _hasTransparencyHint(false) {
+	_model(&model), _parent(0), _level(0), _geometry(this),
+	_isTransparent(false), _dangly(false), _period(0.0), _tightness(0.0), _displacement(0.0),
+	_deformer(0), _render(false), _merged(false), _cullable(false), _hasTransparencyHint(false) {
 
 	_position[0] = 0.0; _position[1] = 0.0; _position[2] = 0.0;
 	_rotation[0] = 0.0; _rotation[1] = 0.0; _rotation[2] = 0.0;
@@ -123,8 +125,40 @@ ModelNode::ModelNode(Model &model) :
 	_orientation[3] = 0.0;
 }
 
+ModelNode::ModelNode(Model &model, const ModelNode &source) :
+	_model(&model), _parent(0), _level(source._level), _name(source._name),
+	_geometry(source._geometry),
+	_positionFrames(source._positionFrames), _orientationFrames(source._orientationFrames),
+	_shininess(source._shininess),
+	_isTransparent(source._isTransparent), _dangly(source._dangly), _period(source._period),
+	_tightness(source._tightness), _displacement(source._displacement),
+	_showdispl(source._showdispl), _displtype(source._displtype),
+	_constraints(source._constraints), _deformer(0), _tilefade(source._tilefade), _scale(source._scale),
+	_render(source._render), _merged(false), _cullable(false), _shadow(source._shadow),
+	_beaming(source._beaming), _inheritcolor(source._inheritcolor),
+	_rotatetexture(source._rotatetexture), _alpha(source._alpha),
+	_hasTransparencyHint(source._hasTransparencyHint), _transparencyHint(source._transparencyHint),
+	_boundBox(source._boundBox) {
+
+	memcpy(_center     , source._center     , 3 * sizeof(float));
+	memcpy(_position   , source._position   , 3 * sizeof(float));
+	memcpy(_rotation   , source._rotation   , 3 * sizeof(float));
+	memcpy(_orientation, source._orientation, 4 * sizeof(float));
+
+	memcpy(_wirecolor, source._wirecolor, 3 * sizeof(float));
+	memcpy(_ambient  , source._ambient  , 3 * sizeof(float));
+	memcpy(_diffuse  , source._diffuse  , 3 * sizeof(float));
+	memcpy(_specular , source._specular , 3 * sizeof(float));
+	memcpy(_selfIllum, source._selfIllum, 3 * sizeof(float));
+
+	// Request the textures again instead of copying the handles, so that
+	// every instance gets its own PLTs to color, like a fresh load would
+	if (!source._textureNames.empty())
+		loadTextures(source._textureNames);
+}
+
 ModelNode::~ModelNode() {
-	// dtor
+	delete _deformer;
 }
 
 ModelNode *ModelNode::getParent() {
@@ -197,14 +231,7 @@ void ModelNode::getAbsolutePosition(float &x, float &y, float &z) const {
 void ModelNode::setPosition(float x, float y, float z) {
 	GfxMan.lockFrame();
 
-	_position[0] = x / _model->_modelScale[0];
-	_position[1] = y / _model->_modelScale[1];
-	_position[2] = z / _model->_modelScale[2];
-
-	if (_parent)
-		_parent->orderChildren();
-
-	_model->needRebuild();
+	setAnimationPosition(x, y, z);
 
 	GfxMan.unlockFrame();
 }
@@ -216,22 +243,31 @@ void ModelNode::setRotation(float x, float y, float z) {
 	_rotation[1] = y;
 	_rotation[2] = z;
 
-	_model->needRebuild();
-
 	GfxMan.unlockFrame();
 }
 
 void ModelNode::setOrientation(float x, float y, float z, float a) {
 	GfxMan.lockFrame();
 
+	setAnimationOrientation(x, y, z, a);
+
+	GfxMan.unlockFrame();
+}
+
+void ModelNode::setAnimationPosition(float x, float y, float z) {
+	_position[0] = x / _model->_modelScale[0];
+	_position[1] = y / _model->_modelScale[1];
+	_position[2] = z / _model->_modelScale[2];
+
+	if (_parent)
+		_parent->orderChildren();
+}
+
+void ModelNode::setAnimationOrientation(float x, float y, float z, float a) {
 	_orientation[0] = x;
 	_orientation[1] = y;
 	_orientation[2] = z;
 	_orientation[3] = a;
-
-	_model->needRebuild();
-
-	GfxMan.unlockFrame();
 }
 
 void ModelNode::move(float x, float y, float z) {
@@ -262,8 +298,9 @@ void ModelNode::inheritGeometry(ModelNode &node) const {
 	node._textures      = _textures;
 	node._render        = _render;
 	node._isTransparent = _isTransparent;
-	node._vertexBuffer  = _vertexBuffer;
-	node._indexBuffer   = _indexBuffer;
+	node._vertexBuffer  = _geometry->_vertexBuffer;
+	node._indexBuffer   = _geometry->_indexBuffer;
+	node._geometry      = &node;
 
 	memcpy(node._center, _center, 3 * sizeof(float));
 	node._boundBox = _boundBox;
@@ -291,6 +328,9 @@ void ModelNode::addChild(Model *model) {
 	bool visible = _model->isVisible();
 	_model->hide();
 
+	// Don't let the main thread build our buffers while we move nodes around
+	_model->GLContainer::removeFromQueue(kQueueNewGLContainer);
+
 	// Take over the nodes in the model's currentstate
 
 	for (Model::NodeList::iterator r = model->_currentState->rootNodes.begin();
@@ -324,6 +364,9 @@ void ModelNode::addChild(Model *model) {
 		}
 	}
 
+	// The nodes we took over might still use the geometry of the model's source
+	_model->_geometrySources.splice(_model->_geometrySources.end(), model->_geometrySources);
+
 	// Delete the model
 	delete model;
 
@@ -336,12 +379,12 @@ void ModelNode::addChild(Model *model) {
 
 void ModelNode::setInvisible(bool invisible) {
 	_render = !invisible;
-	_model->needRebuild();
 }
 
 void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 	bool hasTexture = false;
 
+	_textureNames = textures;
 	_textures.resize(textures.size());
 
 	bool hasAlpha = true;
@@ -449,6 +492,64 @@ void ModelNode::orderChildren() {
 		(*c)->orderChildren();
 }
 
+bool ModelNode::createCulling(bool parentAnimated) {
+	// Animations move a node's children along with it
+	bool animated = parentAnimated || _model->isNodeAnimated(_name);
+
+	bool subtreeAnimated = animated;
+	for (std::list<ModelNode *>::iterator c = _children.begin(); c != _children.end(); ++c)
+		if ((*c)->createCulling(animated))
+			subtreeAnimated = true;
+
+	// Our bounding box only covers the rest pose, so it's only
+	// safe to cull us if nothing in our subtree ever moves
+	_cullable = !subtreeAnimated && !_deformer;
+
+	return subtreeAnimated;
+}
+
+bool ModelNode::isDeformable() const {
+	if (!_render || (_geometry->_indexBuffer.getCount() == 0))
+		return false;
+
+	const uint32 vertexCount = _geometry->_vertexBuffer.getCount();
+
+	// We can only deform three-component float positions
+	bool hasPosition = false;
+
+	const VertexDecl &decl = _geometry->_vertexBuffer.getVertexDecl();
+	for (VertexDecl::const_iterator a = decl.begin(); a != decl.end(); ++a)
+		if (a->index == VPOSITION)
+			hasPosition = (a->type == GL_FLOAT) && (a->size == 3);
+
+	if (!hasPosition || (vertexCount == 0))
+		return false;
+
+	const bool isSkin = !_geometry->_skinBones.empty() &&
+		(_geometry->_skinBoneIndices.size() == (vertexCount * kSkinInfluences)) &&
+		(_geometry->_skinWeights.size()     == (vertexCount * kSkinInfluences));
+
+	const bool isDangly = _dangly && (_displacement > 0.0) &&
+		(_geometry->_constraints.size() == vertexCount);
+
+	return isSkin || isDangly;
+}
+
+void ModelNode::createModelTransform(const Common::TransformationMatrix &parentTransform) {
+	// The same transformation render() applies
+	_modelTransform = parentTransform;
+
+	_modelTransform.translate(_position[0], _position[1], _position[2]);
+	_modelTransform.rotate(_orientation[3], _orientation[0], _orientation[1], _orientation[2]);
+
+	_modelTransform.rotate(_rotation[0], 1.0, 0.0, 0.0);
+	_modelTransform.rotate(_rotation[1], 0.0, 1.0, 0.0);
+	_modelTransform.rotate(_rotation[2], 0.0, 0.0, 1.0);
+
+	for (std::list<ModelNode *>::iterator c = _children.begin(); c != _children.end(); ++c)
+		(*c)->createModelTransform(_modelTransform);
+}
+
 void ModelNode::renderGeometry() {
 	// Enable all needed texture units
 	for (uint32 t = 0; t < _textures.size(); t++) {
@@ -460,16 +561,28 @@ void ModelNode::renderGeometry() {
 
 	// Render the node's faces
 
-	const VertexDecl &vertexDecl = _vertexBuffer.getVertexDecl();
+	// The buffer objects are created by the model's doRebuild(). Until then,
+	// the geometry is drawn from client memory. Deformed meshes are streamed
+	// anew whenever they changed.
+	VertexBuffer &vertexBuffer = _deformer ? _deformer->getVertexBuffer() : _geometry->_vertexBuffer;
+	IndexBuffer  &indexBuffer  = _geometry->_indexBuffer;
+
+	vertexBuffer.bind();
+	indexBuffer.bind();
+
+	const VertexDecl &vertexDecl = vertexBuffer.getVertexDecl();
 
 	for (uint32 i = 0; i < vertexDecl.size(); i++)
-		EnableVertexAttrib(vertexDecl[i]);
+		EnableVertexAttrib(vertexDecl[i], vertexBuffer.getAttribPointer(vertexDecl[i]));
 
-	glDrawElements(GL_TRIANGLES, _indexBuffer.getCount(), _indexBuffer.getType(), _indexBuffer.getData());
+	glDrawElements(GL_TRIANGLES, indexBuffer.getCount(), indexBuffer.getType(), indexBuffer.getPointer());
 
 	for (uint32 i = 0; i < vertexDecl.size(); i++)
 		DisableVertexAttrib(vertexDecl[i]);
 
+	indexBuffer.unbind();
+	vertexBuffer.unbind();
+
 	// Disable the texture units again
 	for (uint32 i = 0; i < _textures.size(); i++) {
 		TextureMan.activeTexture(i);
@@ -478,6 +591,16 @@ void ModelNode::renderGeometry() {
 }
 
 void ModelNode::render(RenderPass pass) {
+	// Skip invisible and too small static parts of world objects
+	if (_cullable && (_model->_type == kModelTypeObject)) {
+		const Frustum &frustum = GfxMan.getFrustum();
+
+		if (_model->_partiallyVisible && (frustum.test(_worldBoundBox) == Frustum::kOutside))
+			return;
+		if (frustum.isTooSmall(_worldBoundBox))
+			return;
+	}
+
 	// Apply the node's transformation
 
 	glTranslatef(_position[0], _position[1], _position[2]);
@@ -490,7 +613,7 @@ void ModelNode::render(RenderPass pass) {
 
 	// Render the node's geometry
 
-	bool shouldRender = _render && (_indexBuffer.getCount() > 0);
+	bool shouldRender = _render && !_merged && (_geometry->_indexBuffer.getCount() > 0);
 	if (((pass == kRenderPassOpaque)      &&  _isTransparent) ||
 	    ((pass == kRenderPassTransparent) && !_isTransparent))
 		shouldRender = false;
@@ -507,73 +630,6 @@ void ModelNode::render(RenderPass pass) {
 	}
 }
 
-void ModelNode::interpolatePosition(float time, float &x, float &y, float &z) const {
-	// If less than 2 keyframes, don't interpolate, just return the only position
-	if (_positionFrames.size() < 2) {
-		getPosition(x, y, z);
-		return;
-	}
-
-	uint32 lastFrame = 0;
-	for (uint32 i = 0; i < _positionFrames.size(); i++) {
-		const PositionKeyFrame &pos = _positionFrames[i];
-		if (pos.time >= time)
-			break;
-
-		lastFrame = i;
-	}
-
-	const PositionKeyFrame &last = _positionFrames[lastFrame];
-	if (lastFrame + 1 >= _positionFrames.size() || last.time == time) {
-		x = last.x;
-		y = last.y;
-		z = last.z;
-		return;
-	}
-
-	const PositionKeyFrame &next = _positionFrames[lastFrame + 1];
-
-	const float f = (time - last.time) / (next.time - last.time);
-	x = f * next.x + (1.0f - f) * last.x;
-	y = f * next.y + (1.0f - f) * last.y;
-	z = f * next.z + (1.0f - f) * last.z;
-}
-
-void ModelNode::interpolateOrientation(float time, float &x, float &y, float &z, float &a) const {
-	// If less than 2 keyframes, don't interpolate just return the only orientation
-	if (_orientationFrames.size() < 2) {
-		getOrientation(x, y, z, a);
-		return;
-	}
-
-	uint32 lastFrame = 0;
-	for (uint32 i = 0; i < _orientationFrames.size(); i++) {
-		const QuaternionKeyFrame &pos = _orientationFrames[i];
-		if (pos.time >= time)
-			break;
-
-		lastFrame = i;
-	}
-
-	const QuaternionKeyFrame &last = _orientationFrames[lastFrame];
-	if (lastFrame + 1 >= _orientationFrames.size() || last.time == time) {
-		x = last.x;
-		y = last.y;
-		z = last.z;
-		a = Common::rad2deg(acos(last.q) * 2.0);
-	}
-
-	const QuaternionKeyFrame &next = _orientationFrames[lastFrame + 1];
-
-	const float f = (time - last.time) / (next.time - last.time);
-	x = f * next.x + (1.0f - f) * last.x;
-	y = f * next.y + (1.0f - f) * last.y;
-	z = f * next.z + (1.0f - f) * last.z;
-
-	const float q = f * next.q + (1.0f - f) * last.q;
-	a = Common::rad2deg(acos(q) * 2.0);
-}
-
 } // End of namespace Aurora
 
 } // End of namespace Graphics
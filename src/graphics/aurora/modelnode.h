@@ -49,6 +49,7 @@ namespace Graphics {
 namespace Aurora {
 
 class Model;
+class MeshDeformer;
 
 struct PositionKeyFrame {
 	float time;
@@ -67,6 +68,9 @@ struct QuaternionKeyFrame {
 
 class ModelNode {
 public:
+	/** Maximum number of bones influencing a single skin vertex. */
+	static const uint32 kSkinInfluences = 4;
+
 	ModelNode(Model &model);
 	virtual ~ModelNode();
 
@@ -109,6 +113,12 @@ public:
 
 
 protected:
+	/** Create an instance of a node of another model, sharing its geometry.
+	 *
+	 *  The parent and children are left for the model to link up.
+	 */
+	ModelNode(Model &model, const ModelNode &source);
+
 	Model *_model; ///< The model this node belongs to.
 
 	ModelNode *_parent;               ///< The node's parent.
@@ -121,6 +131,9 @@ protected:
 	VertexBuffer _vertexBuffer; ///< Node geometry vertex buffer.
 	IndexBuffer _indexBuffer;   ///< Node geometry index buffer.
 
+	/** The node owning the buffers we draw. Ourselves, unless we're an instance. */
+	ModelNode *_geometry;
+
 	float _center     [3]; ///< The node's center.
 	float _position   [3]; ///< Position of the node.
 	float _rotation   [3]; ///< Node rotation.
@@ -140,6 +153,7 @@ protected:
 	float _shininess;    ///< Shiny?
 
 	std::vector<TextureHandle> _textures; ///< Textures.
+	std::vector<Common::UString> _textureNames; ///< Names of the textures, as requested.
 
 	bool _isTransparent;
 
@@ -152,13 +166,25 @@ protected:
 	bool _showdispl;
 	int  _displtype;
 
-	std::vector<float> _constraints;
+	std::vector<float> _constraints; ///< Per-vertex dangly constraints, 0.0 - 255.0.
+
+	/** Names of the nodes the skin mesh's vertices are weighted to. */
+	std::vector<Common::UString> _skinBones;
+	/** Per-vertex bone indices into _skinBones, kSkinInfluences each. 0xFF if unused. */
+	std::vector<uint8> _skinBoneIndices;
+	/** Per-vertex bone weights, kSkinInfluences each. */
+	std::vector<float> _skinWeights;
+
+	/** Deforms the dangly or skin mesh on the CPU, if we have one. */
+	MeshDeformer *_deformer;
 
 	int _tilefade;
 
 	float _scale;
 
 	bool _render; ///< Render the node?
+	bool _merged; ///< Is the geometry drawn by a StaticGeometry instead?
+	bool _cullable; ///< Does no animation ever move this node or its children?
 	bool _shadow; ///< Does the node have a shadow?
 
 	bool _beaming;
@@ -172,6 +198,11 @@ protected:
 
 	Common::BoundingBox _boundBox;
 	Common::BoundingBox _absoluteBoundBox;
+	/** The absolute bounding box in world space. Only kept up-to-date for cullable nodes. */
+	Common::BoundingBox _worldBoundBox;
+
+	/** The node's current transformation relative to the model. Only kept up-to-date for deforming models. */
+	Common::TransformationMatrix _modelTransform;
 
 
 	// Loading helpers
@@ -181,6 +212,9 @@ protected:
 
 	void render(RenderPass pass);
 
+	/** Does the node's mesh need to be deformed on the CPU? */
+	bool isDeformable() const;
+
 
 private:
 	const Common::BoundingBox &getAbsoluteBound() const;
@@ -188,6 +222,22 @@ private:
 
 	void orderChildren();
 
+	/** Set the position of the node, without locking the frame.
+	 *
+	 *  Only for the animation updates, which run on the animation threads
+	 *  while the frame is being rendered anyway. Each model is only ever
+	 *  updated by one of those threads.
+	 */
+	void setAnimationPosition(float x, float y, float z);
+	/** Set the orientation of the node, without locking the frame. */
+	void setAnimationOrientation(float x, float y, float z, float a);
+
+	/** Find out whether this node can be culled. Returns true if anything in the subtree is animated. */
+	bool createCulling(bool parentAnimated);
+
+	/** Calculate the node's current transformation relative to the model, and that of its children. */
+	void createModelTransform(const Common::TransformationMatrix &parentTransform);
+
 	void renderGeometry();
 
 
@@ -208,11 +258,11 @@ public:
 
 	void reparent(ModelNode &parent);
 
-	// Animation helpers
-	void interpolatePosition(float time, float &x, float &y, float &z) const;
-	void interpolateOrientation(float time, float &x, float &y, float &z, float &a) const;
-
 	friend class Model;
+	friend class AnimNode;
+	friend class StaticGeometry;
+	friend class CachedModel;
+	friend class MeshDeformer;
 };
 
 } // End of namespace Aurora
@@ -0,0 +1,365 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/staticgeometry.cpp
+ *  Static geometry of many models, merged for fast drawing.
+ */
+
+#include <cstring>
+
+#include "common/util.h"
+#include "common/maths.h"
+#include "common/transmatrix.h"
+
+#include "graphics/camera.h"
+
+#include "graphics/aurora/staticgeometry.h"
+#include "graphics/aurora/model.h"
+#include "graphics/aurora/modelnode.h"
+#include "graphics/aurora/texture.h"
+
+namespace Graphics {
+
+namespace Aurora {
+
+/** Number of floats per merged vertex: position, normal and texture coordinates. */
+static const uint32 kVertexFloats = 3 + 3 + 2;
+
+StaticGeometry::StaticGeometry() {
+	for (int i = 0; i < 3; i++) {
+		_min[i] =  FLT_MAX;
+		_max[i] = -FLT_MAX;
+	}
+}
+
+StaticGeometry::~StaticGeometry() {
+	hide();
+
+	// Make sure the main thread doesn't touch our buffers while we're deleting them
+	GLContainer::removeFromQueue(kQueueNewGLContainer);
+	GLContainer::removeFromQueue(kQueueGLContainer);
+
+	for (BatchMap::iterator b = _batches.begin(); b != _batches.end(); ++b)
+		delete b->second;
+}
+
+bool StaticGeometry::addModel(Model &model) {
+	if (!model._currentState)
+		return false;
+
+	bool hasOwnGeometry = false;
+
+	for (Model::NodeList::iterator n = model._currentState->rootNodes.begin();
+	     n != model._currentState->rootNodes.end(); ++n)
+		if (addNode(**n, model._absolutePosition, false))
+			hasOwnGeometry = true;
+
+	return hasOwnGeometry;
+}
+
+bool StaticGeometry::addNode(ModelNode &node, const Common::TransformationMatrix &parentPosition,
+                             bool animated) {
+
+	// If an animation moves this node, it also moves all its children
+	animated = animated || node._model->isNodeAnimated(node._name);
+
+	// The same transformation ModelNode::render() applies
+	Common::TransformationMatrix position = parentPosition;
+
+	position.translate(node._position[0], node._position[1], node._position[2]);
+	position.rotate(node._orientation[3], node._orientation[0], node._orientation[1], node._orientation[2]);
+
+	position.rotate(node._rotation[0], 1.0, 0.0, 0.0);
+	position.rotate(node._rotation[1], 0.0, 1.0, 0.0);
+	position.rotate(node._rotation[2], 0.0, 0.0, 1.0);
+
+	bool hasOwnGeometry = false;
+
+	if (node._render && (node._geometry->_indexBuffer.getCount() > 0)) {
+		if (!animated && canMerge(node)) {
+			mergeNode(node, position);
+			node._merged = true;
+		} else
+			hasOwnGeometry = true;
+	}
+
+	for (std::list<ModelNode *>::iterator c = node._children.begin(); c != node._children.end(); ++c)
+		if (addNode(**c, position, animated))
+			hasOwnGeometry = true;
+
+	return hasOwnGeometry;
+}
+
+bool StaticGeometry::canMerge(const ModelNode &node) const {
+	// Deformed meshes change every frame
+	if (node._deformer)
+		return false;
+
+	// Transparent nodes need to be sorted, and we only merge single-textured nodes
+	if (node._isTransparent || (node._textures.size() != 1) || node._textures[0].empty())
+		return false;
+
+	const GLenum indexType = node._geometry->_indexBuffer.getType();
+	if ((indexType != GL_UNSIGNED_SHORT) && (indexType != GL_UNSIGNED_INT))
+		return false;
+
+	bool hasPosition = false, hasTexCoords = false;
+
+	const VertexDecl &decl = node._geometry->_vertexBuffer.getVertexDecl();
+	for (VertexDecl::const_iterator a = decl.begin(); a != decl.end(); ++a) {
+		if (a->type != GL_FLOAT)
+			return false;
+
+		if      (a->index == VPOSITION)
+			hasPosition  = a->size == 3;
+		else if (a->index == VTCOORD)
+			hasTexCoords = a->size == 2;
+		else if (a->index == VCOLOR)
+			return false;
+		else if ((a->index == VNORMAL) && (a->size != 3))
+			return false;
+	}
+
+	return hasPosition && hasTexCoords;
+}
+
+/** Return the nth element of this vertex attribute. */
+static const float *getAttrib(const VertexAttrib &attrib, uint32 n) {
+	const uint32 stride = (attrib.stride != 0) ? attrib.stride : (attrib.size * sizeof(float));
+
+	return (const float *) ((const byte *) attrib.pointer + n * stride);
+}
+
+void StaticGeometry::mergeNode(ModelNode &node, const Common::TransformationMatrix &position) {
+	Batch *&batch = _batches[&node._textures[0].getTexture()];
+	if (!batch) {
+		batch = new Batch;
+
+		batch->texture = node._textures[0];
+	}
+
+	// The node might be an instance, drawing the geometry of another node
+	const VertexBuffer &vertexBuffer = node._geometry->_vertexBuffer;
+	const IndexBuffer  &indexBuffer  = node._geometry->_indexBuffer;
+
+	const VertexAttrib *vPos = 0, *vNorm = 0, *vTex = 0;
+
+	const VertexDecl &decl = vertexBuffer.getVertexDecl();
+	for (VertexDecl::const_iterator a = decl.begin(); a != decl.end(); ++a) {
+		if      (a->index == VPOSITION)
+			vPos  = &*a;
+		else if (a->index == VNORMAL)
+			vNorm = &*a;
+		else if (a->index == VTCOORD)
+			vTex  = &*a;
+	}
+
+	assert(vPos && vTex);
+
+	const uint32 firstVertex = batch->vertices.size() / kVertexFloats;
+	const uint32 vertexCount = vertexBuffer.getCount();
+
+	batch->vertices.reserve(batch->vertices.size() + vertexCount * kVertexFloats);
+
+	for (uint32 v = 0; v < vertexCount; v++) {
+		const float *p = getAttrib(*vPos, v);
+		const float *t = getAttrib(*vTex, v);
+
+		// Transform the position into world space
+		for (int i = 0; i < 3; i++) {
+			const float x = position(i, 0) * p[0] + position(i, 1) * p[1] + position(i, 2) * p[2] + position(i, 3);
+
+			_min[i] = MIN(_min[i], x);
+			_max[i] = MAX(_max[i], x);
+
+			batch->vertices.push_back(x);
+		}
+
+		// Rotate the normal along
+		float n[3] = { 0.0, 0.0, 1.0 };
+		if (vNorm) {
+			const float *vn = getAttrib(*vNorm, v);
+
+			for (int i = 0; i < 3; i++)
+				n[i] = position(i, 0) * vn[0] + position(i, 1) * vn[1] + position(i, 2) * vn[2];
+
+			const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length > 0.0)
+				for (int i = 0; i < 3; i++)
+					n[i] /= length;
+		}
+
+		batch->vertices.push_back(n[0]);
+		batch->vertices.push_back(n[1]);
+		batch->vertices.push_back(n[2]);
+
+		batch->vertices.push_back(t[0]);
+		batch->vertices.push_back(t[1]);
+	}
+
+	const uint32 indexCount = indexBuffer.getCount();
+
+	batch->indices.reserve(batch->indices.size() + indexCount);
+
+	if (indexBuffer.getType() == GL_UNSIGNED_SHORT) {
+		const uint16 *indices = (const uint16 *) indexBuffer.getData();
+		for (uint32 i = 0; i < indexCount; i++)
+			batch->indices.push_back(firstVertex + indices[i]);
+	} else {
+		const uint32 *indices = (const uint32 *) indexBuffer.getData();
+		for (uint32 i = 0; i < indexCount; i++)
+			batch->indices.push_back(firstVertex + indices[i]);
+	}
+}
+
+void StaticGeometry::finalize() {
+	for (BatchMap::iterator b = _batches.begin(); b != _batches.end(); ++b) {
+		Batch &batch = *b->second;
+
+		const uint32 vertexCount = batch.vertices.size() / kVertexFloats;
+
+		batch.vertexBuffer.setSize(vertexCount, kVertexFloats * sizeof(float));
+		if (vertexCount > 0)
+			memcpy(batch.vertexBuffer.getData(), &batch.vertices[0], batch.vertices.size() * sizeof(float));
+
+		const float *data   = (const float *) batch.vertexBuffer.getData();
+		const GLsizei stride = kVertexFloats * sizeof(float);
+
+		VertexDecl decl;
+		VertexAttrib attrib;
+
+		attrib.index   = VPOSITION;
+		attrib.size    = 3;
+		attrib.type    = GL_FLOAT;
+		attrib.stride  = stride;
+		attrib.pointer = data;
+		decl.push_back(attrib);
+
+		attrib.index   = VNORMAL;
+		attrib.pointer = data + 3;
+		decl.push_back(attrib);
+
+		attrib.index   = VTCOORD;
+		attrib.size    = 2;
+		attrib.pointer = data + 6;
+		decl.push_back(attrib);
+
+		batch.vertexBuffer.setVertexDecl(decl);
+
+		batch.indexBuffer.setSize(batch.indices.size(), sizeof(uint32), GL_UNSIGNED_INT);
+		if (!batch.indices.empty())
+			memcpy(batch.indexBuffer.getData(), &batch.indices[0], batch.indices.size() * sizeof(uint32));
+
+		// We don't need the intermediate copies anymore
+		std::vector<float>().swap(batch.vertices);
+		std::vector<uint32>().swap(batch.indices);
+	}
+
+	calculateDistance();
+
+	// Create the buffer objects in the main thread, before the next frame is drawn
+	GLContainer::addToQueue(kQueueNewGLContainer);
+}
+
+void StaticGeometry::calculateDistance() {
+	if (_batches.empty()) {
+		_distance = 0.0;
+		return;
+	}
+
+	const float cameraX =  CameraMan.getPosition()[0];
+	const float cameraY =  CameraMan.getPosition()[1];
+	const float cameraZ = -CameraMan.getPosition()[2];
+
+	const float x = ABS((_min[0] + _max[0]) / 2.0f - cameraX);
+	const float y = ABS((_min[1] + _max[1]) / 2.0f - cameraY);
+	const float z = ABS((_min[2] + _max[2]) / 2.0f - cameraZ);
+
+	_distance = x + y + z;
+}
+
+void StaticGeometry::render(RenderPass pass) {
+	// We only ever merge opaque geometry
+	if (pass == kRenderPassTransparent)
+		return;
+
+	TextureMan.activeTexture(0);
+	glEnable(GL_TEXTURE_2D);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+
+	glClientActiveTextureARB(GL_TEXTURE0);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	for (BatchMap::iterator b = _batches.begin(); b != _batches.end(); ++b) {
+		Batch &batch = *b->second;
+
+		if (batch.indexBuffer.getCount() == 0)
+			continue;
+
+		TextureMan.set(batch.texture);
+
+		batch.vertexBuffer.bind();
+		batch.indexBuffer.bind();
+
+		const VertexDecl &decl = batch.vertexBuffer.getVertexDecl();
+
+		glVertexPointer  (3, GL_FLOAT, decl[0].stride, batch.vertexBuffer.getAttribPointer(decl[0]));
+		glNormalPointer  (   GL_FLOAT, decl[1].stride, batch.vertexBuffer.getAttribPointer(decl[1]));
+		glTexCoordPointer(2, GL_FLOAT, decl[2].stride, batch.vertexBuffer.getAttribPointer(decl[2]));
+
+		glDrawElements(GL_TRIANGLES, batch.indexBuffer.getCount(), GL_UNSIGNED_INT, batch.indexBuffer.getPointer());
+
+		batch.indexBuffer.unbind();
+		batch.vertexBuffer.unbind();
+	}
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glDisable(GL_TEXTURE_2D);
+
+	TextureMan.reset();
+}
+
+void StaticGeometry::doRebuild() {
+	for (BatchMap::iterator b = _batches.begin(); b != _batches.end(); ++b) {
+		b->second->vertexBuffer.initGL();
+		b->second->indexBuffer.initGL();
+	}
+}
+
+void StaticGeometry::doDestroy() {
+	for (BatchMap::iterator b = _batches.begin(); b != _batches.end(); ++b) {
+		b->second->vertexBuffer.destroyGL();
+		b->second->indexBuffer.destroyGL();
+	}
+}
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
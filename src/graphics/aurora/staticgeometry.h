@@ -0,0 +1,117 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/aurora/staticgeometry.h
+ *  Static geometry of many models, merged for fast drawing.
+ */
+
+#ifndef GRAPHICS_AURORA_STATICGEOMETRY_H
+#define GRAPHICS_AURORA_STATICGEOMETRY_H
+
+#include <vector>
+#include <map>
+
+#include "common/types.h"
+
+#include "graphics/types.h"
+#include "graphics/glcontainer.h"
+#include "graphics/object.h"
+#include "graphics/vertexbuffer.h"
+#include "graphics/indexbuffer.h"
+
+#include "graphics/aurora/types.h"
+#include "graphics/aurora/textureman.h"
+
+namespace Common {
+	class TransformationMatrix;
+}
+
+namespace Graphics {
+
+namespace Aurora {
+
+class Texture;
+
+/** The static geometry of many models, merged by texture.
+ *
+ *  Opaque, textured nodes that are never moved by an animation are taken
+ *  out of their models and transformed into world space once. All of them
+ *  sharing a texture are then drawn with a single call. Everything else,
+ *  like animated or transparent nodes, is still drawn by the model itself.
+ *
+ *  The models must not be moved after they have been added.
+ */
+class StaticGeometry : public GLContainer, public Object {
+public:
+	StaticGeometry();
+	~StaticGeometry();
+
+	/** Take over the static geometry of this model.
+	 *
+	 *  @return true if the model still has geometry of its own to draw.
+	 */
+	bool addModel(Model &model);
+
+	/** Create the vertex and index buffers of all merged geometry. */
+	void finalize();
+
+	// Renderable
+	void calculateDistance();
+	void render(RenderPass pass);
+
+protected:
+	// GLContainer
+	void doRebuild();
+	void doDestroy();
+
+private:
+	/** All merged geometry using one texture. */
+	struct Batch {
+		TextureHandle texture;
+
+		std::vector<float>  vertices; ///< Position, normal and texture coordinates.
+		std::vector<uint32> indices;
+
+		VertexBuffer vertexBuffer;
+		IndexBuffer  indexBuffer;
+	};
+
+	typedef std::map<const Texture *, Batch *> BatchMap;
+
+	BatchMap _batches;
+
+	float _min[3]; ///< Minimum coordinates of all merged geometry.
+	float _max[3]; ///< Maximum coordinates of all merged geometry.
+
+	bool addNode(ModelNode &node, const Common::TransformationMatrix &parentPosition, bool animated);
+	bool canMerge(const ModelNode &node) const;
+	void mergeNode(ModelNode &node, const Common::TransformationMatrix &position);
+};
+
+} // End of namespace Aurora
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_AURORA_STATICGEOMETRY_H
@@ -40,7 +40,8 @@ namespace Aurora {
 
 Text::Text(const FontHandle &font, const Common::UString &str,
 		float r, float g, float b, float a, float align) :
-	_r(r), _g(g), _b(b), _a(a), _font(font), _x(0.0), _y(0.0), _align(align) {
+	_r(r), _g(g), _b(b), _a(a), _font(font), _x(0.0), _y(0.0), _align(align),
+	_drawListDirty(true), _fontGeneration(0) {
 
 	set(str);
 
@@ -59,12 +60,15 @@ void Text::set(const Common::UString &str) {
 	Font &font = _font.getFont();
 
 	font.buildChars(str);
+	_fontGeneration = font.getGeneration();
 
 	_lineCount = font.getLineCount(_str);
 
 	_height = font.getHeight(_str);
 	_width  = font.getWidth (_str);
 
+	_drawListDirty = true;
+
 	GfxMan.unlockFrame();
 }
 
@@ -83,6 +87,8 @@ void Text::setColor(float r, float g, float b, float a) {
 	_b = b;
 	_a = a;
 
+	_drawListDirty = true;
+
 	GfxMan.unlockFrame();
 }
 
@@ -136,11 +142,39 @@ void Text::render(RenderPass pass) {
 	if (pass == kRenderPassOpaque)
 		return;
 
+	checkFont();
+
 	glTranslatef(_x, _y, 0.0);
 
 	_font.getFont().draw(_str, _colors, _r, _g, _b, _a, _align);
 }
 
+bool Text::addToDrawList(GUIDrawList &list) {
+	checkFont();
+
+	if (_drawListDirty) {
+		_drawList.clear();
+		_font.getFont().addToDrawList(_drawList, _str, _colors, _r, _g, _b, _a, _align);
+
+		_drawListDirty = false;
+	}
+
+	list.add(_drawList, _x, _y);
+	return true;
+}
+
+void Text::checkFont() {
+	Font &font = _font.getFont();
+	if (font.getGeneration() == _fontGeneration)
+		return;
+
+	// The font evicted characters, maybe ours. Their quads might now show other characters
+	font.buildChars(_str);
+	_fontGeneration = font.getGeneration();
+
+	_drawListDirty = true;
+}
+
 bool Text::isIn(float x, float y) const {
 	if ((x < _x) || (y < _y))
 		return false;
@@ -35,6 +35,7 @@
 
 #include "graphics/types.h"
 #include "graphics/guifrontelement.h"
+#include "graphics/guidrawlist.h"
 
 #include "graphics/aurora/fontman.h"
 
@@ -70,6 +71,9 @@ public:
 	void render(RenderPass pass);
 	bool isIn(float x, float y) const;
 
+	// GUIFrontElement
+	bool addToDrawList(GUIDrawList &list);
+
 private:
 	float _r, _g, _b, _a;
 	FontHandle _font;
@@ -87,6 +91,16 @@ private:
 	Common::UString _str;
 	ColorPositions  _colors;
 
+	/** The text's quads, relative to its position. Only rebuilt when the text changes. */
+	GUIDrawList _drawList;
+	bool _drawListDirty;
+
+	/** The font's generation when our characters were last built. */
+	uint32 _fontGeneration;
+
+	/** Build our characters again if the font dropped some of them. */
+	void checkFont();
+
 
 	void parseColors(const Common::UString &str, Common::UString &parsed,
 	                 ColorPositions &colors);
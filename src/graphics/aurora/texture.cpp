@@ -31,6 +31,10 @@
 #include "common/util.h"
 #include "common/error.h"
 #include "common/stream.h"
+#include "common/configman.h"
+#include "common/hash.h"
+#include "common/file.h"
+#include "common/filepath.h"
 
 #include "graphics/aurora/texture.h"
 
@@ -43,6 +47,7 @@
 #include "graphics/images/tpc.h"
 #include "graphics/images/txb.h"
 #include "graphics/images/sbm.h"
+#include "graphics/images/cachedimage.h"
 
 #include "events/requests.h"
 
@@ -55,7 +60,8 @@ namespace Graphics {
 namespace Aurora {
 
 Texture::Texture(const Common::UString &name) : _textureID(0),
-	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0) {
+	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0),
+	_dirtyAll(true), _dirtyX(0), _dirtyY(0), _dirtyWidth(0), _dirtyHeight(0) {
 
 	_txi = new TXI();
 
@@ -66,7 +72,8 @@ Texture::Texture(const Common::UString &name) : _textureID(0),
 }
 
 Texture::Texture(ImageDecoder *image, const TXI *txi) : _textureID(0),
-	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0) {
+	_type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0),
+	_dirtyAll(true), _dirtyX(0), _dirtyY(0), _dirtyWidth(0), _dirtyHeight(0) {
 
 	if (txi)
 		_txi = new TXI(*txi);
@@ -116,26 +123,55 @@ void Texture::load(const Common::UString &name) {
 
 	_name = name;
 
-	// Loading the different image formats
-	if      (_type == ::Aurora::kFileTypeTGA)
-		_image = new TGA(*img);
-	else if (_type == ::Aurora::kFileTypeDDS)
-		_image = new DDS(*img);
-	else if (_type == ::Aurora::kFileTypeTPC)
-		_image = new TPC(*img);
-	else if (_type == ::Aurora::kFileTypeTXB)
-		_image = new TXB(*img);
-	else if (_type == ::Aurora::kFileTypeSBM)
-		_image = new SBM(*img);
-	else {
-		delete img;
-		throw Common::Exception("Unsupported image resource type %d", (int) _type);
+	_image = 0;
+
+	// The TXI changes how the image is processed, so we need it for the cache lookup too
+	Common::SeekableReadStream *txi = ResMan.getResource(name, ::Aurora::kFileTypeTXI);
+
+	// Look for an already decoded version of the image in the texture cache
+	const Common::UString cacheDir = ConfigMan.getString("texturecache");
+
+	uint64 hash = 0;
+	if (!cacheDir.empty()) {
+		try {
+			hash = hashImage(img, txi);
+		} catch (...) {
+			delete txi;
+			throw;
+		}
+
+		loadCached(cacheDir, hash);
+	}
+
+	const bool cached = _image != 0;
+
+	if (!cached) {
+		// Loading the different image formats
+		if      (_type == ::Aurora::kFileTypeTGA)
+			_image = new TGA(*img);
+		else if (_type == ::Aurora::kFileTypeDDS)
+			_image = new DDS(*img);
+		else if (_type == ::Aurora::kFileTypeTPC)
+			_image = new TPC(*img);
+		else if (_type == ::Aurora::kFileTypeTXB)
+			_image = new TXB(*img);
+		else if (_type == ::Aurora::kFileTypeSBM)
+			_image = new SBM(*img);
+		else {
+			delete img;
+			delete txi;
+			throw Common::Exception("Unsupported image resource type %d", (int) _type);
+		}
 	}
 
 	delete img;
 
-	loadTXI(ResMan.getResource(name, ::Aurora::kFileTypeTXI));
+	loadTXI(txi);
 	loadImage();
+	createMipMaps();
+
+	if (!cacheDir.empty() && !cached)
+		saveCached(cacheDir, hash);
 }
 
 void Texture::load(ImageDecoder *image) {
@@ -184,6 +220,99 @@ void Texture::loadImage() {
 	loadTXI(_image->getTXI());
 }
 
+void Texture::createMipMaps() {
+	if (!_image)
+		return;
+
+	// Filtered textures without mip maps of their own get a generated chain.
+	// Minifying these is much cheaper and more stable than without any.
+	if (_txi->getFeatures().filter)
+		_image->generateMipMaps(ConfigMan.getBool("mipmapgamma", false));
+}
+
+uint64 Texture::hashImage(Common::SeekableReadStream *&img, Common::SeekableReadStream *txi) const {
+	// Read the whole image into memory, so we only need to go to the disk once
+
+	const uint32 size = img->size();
+	byte *data = new byte[size];
+
+	img->seek(0);
+	if (img->read(data, size) != size) {
+		delete[] data;
+		delete img;
+
+		throw Common::Exception(Common::kReadError);
+	}
+
+	delete img;
+	img = new Common::MemoryReadStream(data, size, true);
+
+	// Everything that changes the decoded image needs to change the hash too
+	uint64 hash = Common::hashDataFNV64(data, size);
+
+	if (txi) {
+		const uint32 txiSize = txi->size();
+		byte *txiData = new byte[txiSize];
+
+		txi->seek(0);
+		const bool txiRead = txi->read(txiData, txiSize) == txiSize;
+
+		hash = Common::hashDataFNV64(txiData, txiSize, hash);
+		delete[] txiData;
+
+		if (!txiRead)
+			throw Common::Exception(Common::kReadError);
+
+		txi->seek(0);
+	}
+
+	const uint32 settings[4] = {
+		(uint32) _type, CachedImage::kVersion,
+		GfxMan.needManualDeS3TC() ? 1U : 0U, ConfigMan.getBool("mipmapgamma", false) ? 1U : 0U
+	};
+
+	return Common::hashDataFNV64((const byte *) settings, sizeof(settings), hash);
+}
+
+static Common::UString getCacheFile(const Common::UString &cacheDir, uint64 hash) {
+	return cacheDir + "/" + Common::formatHash(hash) + ".xtc";
+}
+
+void Texture::loadCached(const Common::UString &cacheDir, uint64 hash) {
+	const Common::UString cacheFile = getCacheFile(cacheDir, hash);
+
+	Common::File file;
+	if (!file.open(cacheFile))
+		return;
+
+	try {
+		_image = new CachedImage(file, hash);
+	} catch (Common::Exception &) {
+		// Outdated or broken cache entry, just decode the image again
+		_image = 0;
+	}
+}
+
+void Texture::saveCached(const Common::UString &cacheDir, uint64 hash) const {
+	if (!_image || !Common::FilePath::createDirectories(cacheDir))
+		return;
+
+	const Common::UString cacheFile = getCacheFile(cacheDir, hash);
+
+	Common::DumpFile file;
+	if (!file.open(cacheFile)) {
+		warning("Can't write texture cache file \"%s\"", cacheFile.c_str());
+		return;
+	}
+
+	CachedImage::write(file, *_image, hash);
+
+	if (!file.flush() || file.err())
+		warning("Failed writing texture cache file \"%s\"", cacheFile.c_str());
+
+	file.close();
+}
+
 void Texture::doDestroy() {
 	if (_textureID == 0)
 		return;
@@ -198,6 +327,15 @@ void Texture::doRebuild() {
 		// No image
 		return;
 
+	if (canUpdateArea()) {
+		// Only a part of the image changed, just upload that
+		updateArea();
+		return;
+	}
+
+	_dirtyAll   = false;
+	_dirtyWidth = _dirtyHeight = 0;
+
 	// Generate the texture ID
 	if (_textureID == 0)
 		glGenTextures(1, &_textureID);
@@ -220,7 +358,7 @@ void Texture::doRebuild() {
 	}
 
 	if (_image->getMipMapCount() == 1) {
-		// Texture doesn't specify any mip maps, generate our own
+		// Texture doesn't specify any mip maps, let the driver generate them
 
 		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
@@ -233,6 +371,9 @@ void Texture::doRebuild() {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _image->getMipMapCount() - 1);
 	}
 
+	// Mip maps of uncompressed images might have rows with odd sizes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
 	// Texture image data
 	if (_image->isCompressed()) {
 		// Compressed texture data
@@ -260,6 +401,39 @@ void Texture::doRebuild() {
 
 }
 
+bool Texture::canUpdateArea() const {
+	if (_dirtyAll || (_textureID == 0) || (_dirtyWidth == 0) || (_dirtyHeight == 0))
+		return false;
+
+	// We can only update single-level uncompressed images in place
+	if (_image->isCompressed() || (_image->getMipMapCount() != 1))
+		return false;
+
+	const ImageDecoder::MipMap &mipMap = _image->getMipMap(0);
+
+	return ((_dirtyX + _dirtyWidth) <= (uint32) mipMap.width) && ((_dirtyY + _dirtyHeight) <= (uint32) mipMap.height);
+}
+
+void Texture::updateArea() {
+	const ImageDecoder::MipMap &mipMap = _image->getMipMap(0);
+
+	glBindTexture(GL_TEXTURE_2D, _textureID);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT  , 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH , mipMap.width);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, _dirtyX);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS  , _dirtyY);
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0, _dirtyX, _dirtyY, _dirtyWidth, _dirtyHeight,
+	                _image->getFormat(), _image->getDataType(), mipMap.data);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH , 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS  , 0);
+
+	_dirtyWidth = _dirtyHeight = 0;
+}
+
 const TXI &Texture::getTXI() const {
 	return *_txi;
 }
@@ -276,6 +450,9 @@ bool Texture::reload(ImageDecoder *image, const TXI *txi) {
 	delete _image;
 
 	load(image);
+	createMipMaps();
+
+	_dirtyAll = true;
 
 	addToQueue(kQueueTexture);
 	addToQueue(kQueueNewTexture);
@@ -301,12 +478,50 @@ bool Texture::reload(const Common::UString &name) {
 
 	load(_name);
 
+	_dirtyAll = true;
+
 	addToQueue(kQueueTexture);
 	addToQueue(kQueueNewTexture);
 
 	return true;
 }
 
+void Texture::refresh() {
+	lockQueue(kQueueNewTexture);
+
+	_dirtyAll = true;
+
+	addToQueue(kQueueNewTexture);
+	unlockQueue(kQueueNewTexture);
+}
+
+void Texture::refresh(uint32 x, uint32 y, uint32 width, uint32 height) {
+	if ((width == 0) || (height == 0))
+		return;
+
+	lockQueue(kQueueNewTexture);
+
+	if ((_dirtyWidth == 0) || (_dirtyHeight == 0)) {
+		_dirtyX      = x;
+		_dirtyY      = y;
+		_dirtyWidth  = width;
+		_dirtyHeight = height;
+	} else {
+		// Grow the dirty area to include the new area
+
+		const uint32 x2 = MAX(_dirtyX + _dirtyWidth , x + width);
+		const uint32 y2 = MAX(_dirtyY + _dirtyHeight, y + height);
+
+		_dirtyX      = MIN(_dirtyX, x);
+		_dirtyY      = MIN(_dirtyY, y);
+		_dirtyWidth  = x2 - _dirtyX;
+		_dirtyHeight = y2 - _dirtyY;
+	}
+
+	addToQueue(kQueueNewTexture);
+	unlockQueue(kQueueNewTexture);
+}
+
 bool Texture::dumpTGA(const Common::UString &fileName) const {
 	if (!_image)
 		return false;
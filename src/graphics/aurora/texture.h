@@ -73,6 +73,14 @@ public:
 	/** Dump the texture into a TGA. */
 	bool dumpTGA(const Common::UString &fileName) const;
 
+	/** Upload the texture's image again, with the next frame. */
+	void refresh();
+	/** Upload only this area of the texture's image again, with the next frame. */
+	void refresh(uint32 x, uint32 y, uint32 width, uint32 height);
+
+	// Graphics::Texture
+	TextureID getID() const;
+
 protected:
 	// GLContainer
 	void doRebuild();
@@ -91,13 +99,33 @@ private:
 	uint32 _width;
 	uint32 _height;
 
+	bool _dirtyAll;       ///< Does the whole image need to be uploaded again?
+	uint32 _dirtyX;       ///< Left edge of the area that needs to be uploaded again.
+	uint32 _dirtyY;       ///< Top edge of the area that needs to be uploaded again.
+	uint32 _dirtyWidth;   ///< Width of the area that needs to be uploaded again.
+	uint32 _dirtyHeight;  ///< Height of the area that needs to be uploaded again.
+
 	void load(const Common::UString &name);
 	void load(ImageDecoder *image);
 
 	void loadTXI(Common::SeekableReadStream *stream);
 	void loadImage();
 
-	TextureID getID() const;
+	/** Generate mip maps for images that don't come with their own. */
+	void createMipMaps();
+
+	/** Can the dirty area be uploaded on its own, instead of the whole image? */
+	bool canUpdateArea() const;
+	/** Upload only the dirty area of the image. */
+	void updateArea();
+
+	/** Read the image data into memory and hash it, together with its TXI and all decoding settings. */
+	uint64 hashImage(Common::SeekableReadStream *&img, Common::SeekableReadStream *txi) const;
+
+	/** Try to load the image from the texture cache. */
+	void loadCached(const Common::UString &cacheDir, uint64 hash);
+	/** Write the decoded image into the texture cache. */
+	void saveCached(const Common::UString &cacheDir, uint64 hash) const;
 
 	friend class TextureManager;
 };
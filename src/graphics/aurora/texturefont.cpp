@@ -103,6 +103,42 @@ void TextureFont::draw(uint32 c) const {
 	glTranslatef(cC.width + _spaceR, 0.0, 0.0);
 }
 
+void TextureFont::getMissingQuad(CharQuad &quad) const {
+	const float width = getWidth('m') - _spaceR;
+
+	quad.texture = 0;
+
+	quad.vX[0] = 0.0  ; quad.vY[0] =     0.0;
+	quad.vX[1] = width; quad.vY[1] =     0.0;
+	quad.vX[2] = width; quad.vY[2] = _height;
+	quad.vX[3] = 0.0  ; quad.vY[3] = _height;
+
+	for (int i = 0; i < 4; i++)
+		quad.tX[i] = quad.tY[i] = 0.0;
+
+	quad.advance = width + _spaceR;
+}
+
+void TextureFont::getCharQuad(uint32 c, CharQuad &quad) const {
+	if (c >= _chars.size()) {
+		getMissingQuad(quad);
+		return;
+	}
+
+	const Char &cC = _chars[c];
+
+	quad.texture = &_texture.getTexture();
+
+	for (int i = 0; i < 4; i++) {
+		quad.vX[i] = cC.vX[i];
+		quad.vY[i] = cC.vY[i];
+		quad.tX[i] = cC.tX[i];
+		quad.tY[i] = cC.tY[i];
+	}
+
+	quad.advance = cC.width + _spaceR;
+}
+
 void TextureFont::load() {
 	const Texture &texture = _texture.getTexture();
 	const TXI::Features &txiFeatures = texture.getTXI().getFeatures();
@@ -60,6 +60,7 @@ public:
 	float getLineSpacing() const;
 
 	void draw(uint32 c) const;
+	void getCharQuad(uint32 c, CharQuad &quad) const;
 
 private:
 	/** A font character. */
@@ -80,6 +81,7 @@ private:
 	void load();
 
 	void drawMissing() const;
+	void getMissingQuad(CharQuad &quad) const;
 };
 
 } // End of namespace Aurora
@@ -39,20 +39,30 @@
 
 #include "graphics/graphics.h"
 
+#include "graphics/images/decoder.h"
+#include "graphics/images/surface.h"
+
 #include "events/requests.h"
 
 DECLARE_SINGLETON(Graphics::Aurora::TextureManager)
 
+/** Width and height of a texture atlas page. */
+static const uint32 kAtlasPageSize = 1024;
+/** Maximum width and height of a texture to be placed into an atlas page. */
+static const uint32 kAtlasMaxSize  = 256;
+
 namespace Graphics {
 
 namespace Aurora {
 
-ManagedTexture::ManagedTexture(const Common::UString &name) : reloadable(false) {
+ManagedTexture::ManagedTexture(const Common::UString &name) : reloadable(false), atlasPage(false) {
 	referenceCount = 0;
 	texture = new Texture(name);
 }
 
-ManagedTexture::ManagedTexture(const Common::UString &name, Texture *t) : reloadable(false) {
+ManagedTexture::ManagedTexture(const Common::UString &name, Texture *t) :
+	reloadable(false), atlasPage(false) {
+
 	referenceCount = 0;
 	texture = t;
 }
@@ -154,7 +164,24 @@ PLTFile &PLTHandle::getPLT() const {
 }
 
 
-TextureManager::TextureManager() {
+TextureAtlasArea::TextureAtlasArea() : x(0.0), y(0.0), width(1.0), height(1.0), hasAlpha(false) {
+}
+
+
+TextureManager::AtlasPage::AtlasPage() : curX(0), curY(0), rowHeight(0) {
+	surface = new Surface(kAtlasPageSize, kAtlasPageSize);
+	surface->fill(0x00, 0x00, 0x00, 0x00);
+
+	texture = TextureMan.add(new Texture(surface));
+}
+
+TextureManager::AtlasPage::~AtlasPage() {
+	// The surface belongs to the texture
+	texture.clear();
+}
+
+
+TextureManager::TextureManager() : _atlasGeneration(0) {
 }
 
 TextureManager::~TextureManager() {
@@ -164,6 +191,8 @@ TextureManager::~TextureManager() {
 void TextureManager::clear() {
 	Common::StackLock lock(_mutex);
 
+	clearAtlas();
+
 	_newPLTs.clear();
 
 	for (PLTList::iterator p = _plts.begin(); p != _plts.end(); ++p)
@@ -253,10 +282,14 @@ void TextureManager::release(TextureHandle &texture) {
 	Common::StackLock lock(_mutex);
 
 	if (!texture._empty && (texture._it != _textures.end())) {
-		if (--texture._it->second->referenceCount == 0) {
+		const uint32 referenceCount = --texture._it->second->referenceCount;
+
+		if (referenceCount == 0) {
 			delete texture._it->second;
 			_textures.erase(texture._it);
-		}
+		} else if ((referenceCount == 1) && texture._it->second->atlasPage)
+			// Only the atlas page itself is still holding on to it
+			freeAtlasPage(texture._it);
 	}
 
 	texture._empty = true;
@@ -278,22 +311,28 @@ void TextureManager::release(PLTHandle &plt) {
 }
 
 void TextureManager::reloadAll() {
-	Common::StackLock lock(_mutex);
-
 	GfxMan.lockFrame();
 
-	TextureMap::iterator texture;
-	try {
+	{
+		Common::StackLock lock(_mutex);
 
-		for (texture = _textures.begin(); texture != _textures.end(); ++texture)
-			if (texture->second->reloadable)
-				texture->second->texture->reload(texture->first);
+		TextureMap::iterator texture;
+		try {
 
-	} catch (Common::Exception &e) {
-		e.add("Failed reloading texture \"%s\"", texture->first.c_str());
-		throw;
+			for (texture = _textures.begin(); texture != _textures.end(); ++texture)
+				if (texture->second->reloadable)
+					texture->second->texture->reload(texture->first);
+
+		} catch (Common::Exception &e) {
+			e.add("Failed reloading texture \"%s\"", texture->first.c_str());
+			throw;
+		}
+
+		// The atlas pages hold copies of the old images
+		repackAtlas();
 	}
 
+	// Don't hold the lock while waiting, the main thread might want it for the atlas
 	RequestMan.sync();
 	GfxMan.unlockFrame();
 }
@@ -308,6 +347,198 @@ void TextureManager::clearNewPLTs() {
 	_newPLTs.clear();
 }
 
+void TextureManager::clearAtlas() {
+	_atlasEntries.clear();
+
+	// Deleting a page releases its texture, so take the pages out of the list first
+	AtlasPages pages;
+	pages.swap(_atlasPages);
+
+	for (AtlasPages::iterator p = pages.begin(); p != pages.end(); ++p)
+		delete *p;
+}
+
+void TextureManager::repackAtlas() {
+	std::list<Common::UString> names;
+	for (AtlasEntries::const_iterator e = _atlasEntries.begin(); e != _atlasEntries.end(); ++e)
+		names.push_back(e->first);
+
+	clearAtlas();
+
+	for (std::list<Common::UString>::const_iterator n = names.begin(); n != names.end(); ++n) {
+		AtlasEntries::iterator entry = _atlasEntries.insert(std::make_pair(*n, AtlasEntry())).first;
+
+		if (!addToAtlas(*n, entry->second))
+			entry->second.page = 0;
+	}
+
+	_atlasGeneration++;
+}
+
+void TextureManager::freeAtlasPage(TextureMap::iterator &texture) {
+	AtlasPages::iterator p;
+	for (p = _atlasPages.begin(); p != _atlasPages.end(); ++p)
+		if (!(*p)->texture._empty && ((*p)->texture._it == texture))
+			break;
+
+	if (p == _atlasPages.end())
+		return;
+
+	AtlasPage *page = *p;
+	_atlasPages.erase(p);
+
+	// Textures on this page need to be placed again when they're used the next time
+	for (AtlasEntries::iterator e = _atlasEntries.begin(); e != _atlasEntries.end(); ) {
+		if (e->second.page == page)
+			_atlasEntries.erase(e++);
+		else
+			++e;
+	}
+
+	delete page;
+}
+
+bool TextureManager::getAtlas(const Common::UString &name, TextureHandle &page, TextureAtlasArea &area) {
+	Common::StackLock lock(_mutex);
+
+	// Let go of the old page first, so it can't be freed while we hand it out again
+	page.clear();
+
+	AtlasEntries::iterator entry = _atlasEntries.find(name);
+	if (entry == _atlasEntries.end()) {
+		entry = _atlasEntries.insert(std::make_pair(name, AtlasEntry())).first;
+
+		if (!addToAtlas(name, entry->second))
+			entry->second.page = 0;
+	}
+
+	if (!entry->second.page)
+		return false;
+
+	page = entry->second.page->texture;
+	area = entry->second.area;
+
+	return true;
+}
+
+bool TextureManager::findAtlas(const Common::UString &name, TextureHandle &page, TextureAtlasArea &area) {
+	Common::StackLock lock(_mutex);
+
+	AtlasEntries::const_iterator entry = _atlasEntries.find(name);
+	if ((entry == _atlasEntries.end()) || !entry->second.page)
+		return false;
+
+	page = entry->second.page->texture;
+	area = entry->second.area;
+
+	return true;
+}
+
+uint32 TextureManager::getAtlasGeneration() {
+	Common::StackLock lock(_mutex);
+
+	return _atlasGeneration;
+}
+
+/** Convert a pixel of an 8-bit image into BGRA. */
+static inline void convertToBGRA(byte *dst, const byte *src, PixelFormat format) {
+	switch (format) {
+		case kPixelFormatBGRA:
+			memcpy(dst, src, 4);
+			break;
+
+		case kPixelFormatRGBA:
+			dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0]; dst[3] = src[3];
+			break;
+
+		case kPixelFormatBGR:
+			dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 0xFF;
+			break;
+
+		case kPixelFormatRGB:
+			dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0]; dst[3] = 0xFF;
+			break;
+	}
+}
+
+bool TextureManager::addToAtlas(const Common::UString &name, AtlasEntry &entry) {
+	entry.page = 0;
+
+	// PLTs get recolored at runtime, so they can't share a texture
+	if (ResMan.hasResource(name, ::Aurora::kFileTypePLT))
+		return false;
+
+	TextureHandle handle;
+	try {
+		handle = get(name);
+	} catch (...) {
+		return false;
+	}
+
+	const ImageDecoder *image = handle.getTexture()._image;
+	if (!image || image->isCompressed() || (image->getDataType() != kPixelDataType8))
+		return false;
+
+	const PixelFormat format = image->getFormat();
+	const uint32 bpp = ((format == kPixelFormatRGB) || (format == kPixelFormatBGR)) ? 3 : 4;
+
+	const ImageDecoder::MipMap &mipMap = image->getMipMap(0);
+
+	const uint32 width  = mipMap.width;
+	const uint32 height = mipMap.height;
+	if ((width == 0) || (height == 0) || (width > kAtlasMaxSize) || (height > kAtlasMaxSize) ||
+	    (mipMap.size < (width * height * bpp)))
+		return false;
+
+	// Each texture gets a 1 pixel border of its own edge pixels, against bleeding when filtering
+	const uint32 paddedWidth  = width  + 2;
+	const uint32 paddedHeight = height + 2;
+
+	// Simple shelf packing: fill rows from left to right, start a new page when full
+
+	AtlasPage *page = _atlasPages.empty() ? 0 : _atlasPages.back();
+	if (page && ((page->curX + paddedWidth) > kAtlasPageSize)) {
+		page->curX       = 0;
+		page->curY      += page->rowHeight;
+		page->rowHeight  = 0;
+	}
+
+	if (!page || ((page->curY + paddedHeight) > kAtlasPageSize)) {
+		_atlasPages.push_back(new AtlasPage);
+		page = _atlasPages.back();
+
+		page->texture._it->second->atlasPage = true;
+	}
+
+	byte *dst = page->surface->getData() + (page->curY * kAtlasPageSize + page->curX) * 4;
+	for (uint32 y = 0; y < paddedHeight; y++, dst += kAtlasPageSize * 4) {
+		const uint32 srcY = CLIP<int32>((int32) y - 1, 0, (int32) height - 1);
+		const byte  *src  = mipMap.data + srcY * width * bpp;
+
+		for (uint32 x = 0; x < paddedWidth; x++) {
+			const uint32 srcX = CLIP<int32>((int32) x - 1, 0, (int32) width - 1);
+
+			convertToBGRA(dst + x * 4, src + srcX * bpp, format);
+		}
+	}
+
+	entry.page = page;
+
+	entry.area.x        = (float) (page->curX + 1) / kAtlasPageSize;
+	entry.area.y        = (float) (page->curY + 1) / kAtlasPageSize;
+	entry.area.width    = (float) width            / kAtlasPageSize;
+	entry.area.height   = (float) height           / kAtlasPageSize;
+	entry.area.hasAlpha = image->hasAlpha();
+
+	// Upload the changed part of the page with the next frame
+	page->texture.getTexture().refresh(page->curX, page->curY, paddedWidth, paddedHeight);
+
+	page->curX      += paddedWidth;
+	page->rowHeight  = MAX(page->rowHeight, paddedHeight);
+
+	return true;
+}
+
 void TextureManager::reset() {
 	activeTexture(0);
 	glEnable(GL_TEXTURE_2D);
@@ -42,6 +42,8 @@
 
 namespace Graphics {
 
+class Surface;
+
 namespace Aurora {
 
 class Texture;
@@ -53,6 +55,7 @@ struct ManagedTexture {
 	uint32 referenceCount;
 
 	bool reloadable;
+	bool atlasPage; ///< Is this the texture of a texture atlas page?
 
 	ManagedTexture(const Common::UString &name);
 	ManagedTexture(const Common::UString &name, Texture *t);
@@ -118,6 +121,18 @@ private:
 	friend class TextureManager;
 };
 
+/** The area a texture occupies within a shared texture atlas page, in texture coordinates. */
+struct TextureAtlasArea {
+	float x;      ///< Left edge of the texture within the atlas page.
+	float y;      ///< Bottom edge of the texture within the atlas page.
+	float width;  ///< Width of the texture within the atlas page.
+	float height; ///< Height of the texture within the atlas page.
+
+	bool hasAlpha; ///< Does the original texture have an alpha channel?
+
+	TextureAtlasArea();
+};
+
 /** The global Aurora texture manager. */
 class TextureManager : public Common::Singleton<TextureManager> {
 public:
@@ -146,10 +161,64 @@ public:
 	void activeTexture(uint32 n);
 
 
+	/** Get a small texture packed into a shared atlas page.
+	 *
+	 *  Small textures, like the ones used by GUI elements, are packed
+	 *  together into a few big textures, so that drawing them doesn't
+	 *  need to switch textures all the time.
+	 *
+	 *  @param  name The name of the texture resource.
+	 *  @param  page The handle of the atlas page containing the texture.
+	 *  @param  area The area of the atlas page the texture occupies.
+	 *  @return false if the texture can't be placed in an atlas.
+	 */
+	bool getAtlas(const Common::UString &name, TextureHandle &page, TextureAtlasArea &area);
+
+	/** Look up a texture already packed into an atlas page, without packing it.
+	 *
+	 *  @return false if the texture isn't in the atlas.
+	 */
+	bool findAtlas(const Common::UString &name, TextureHandle &page, TextureAtlasArea &area);
+
+	/** Return a number that changes whenever the whole atlas is packed anew.
+	 *
+	 *  Users of the atlas have to look up their texture's page and area
+	 *  again when this changes.
+	 */
+	uint32 getAtlasGeneration();
+
+
 private:
+	/** A page of the texture atlas. */
+	struct AtlasPage {
+		Surface *surface;      ///< The page's image data.
+		TextureHandle texture; ///< The page's texture.
+
+		uint32 curX;      ///< Horizontal position of the next texture in the current row.
+		uint32 curY;      ///< Vertical position of the current row.
+		uint32 rowHeight; ///< Height of the current row.
+
+		AtlasPage();
+		~AtlasPage();
+	};
+
+	/** A texture placed in the texture atlas. */
+	struct AtlasEntry {
+		AtlasPage *page; ///< The page containing the texture, 0 if the texture isn't suitable.
+		TextureAtlasArea area;
+	};
+
+	typedef std::list<AtlasPage *> AtlasPages;
+	typedef std::map<Common::UString, AtlasEntry> AtlasEntries;
+
 	TextureMap _textures;
 	PLTList    _plts;
 
+	AtlasPages   _atlasPages;
+	AtlasEntries _atlasEntries;
+
+	uint32 _atlasGeneration; ///< Bumped whenever the whole atlas is packed anew.
+
 	std::list<PLTHandle> _newPLTs;
 
 	Common::Mutex _mutex;
@@ -162,6 +231,13 @@ private:
 	void release(TextureHandle &texture);
 	void release(PLTHandle &plt);
 
+	void clearAtlas();
+	/** Throw away all atlas pages, and pack all textures that were in the atlas again. */
+	void repackAtlas();
+	bool addToAtlas(const Common::UString &name, AtlasEntry &entry);
+	/** Free the atlas page with this texture, if there is one. */
+	void freeAtlasPage(TextureMap::iterator &texture);
+
 	friend class PLTHandle;
 	friend class TextureHandle;
 };
@@ -41,15 +41,28 @@
 #include "graphics/aurora/ttffont.h"
 #include "graphics/aurora/texture.h"
 
-static const uint32 kPageWidth  = 256;
-static const uint32 kPageHeight = 256;
+static const uint32 kPageWidth  = 512;
+static const uint32 kPageHeight = 512;
+
+/** The number of pages after which we start evicting the least recently used one.
+ *
+ *  This is a soft limit: pages used by the current buildChars() call
+ *  are never evicted, so a single huge string can still grow the pool.
+ */
+static const uint kMaxPages = 8;
 
 namespace Graphics {
 
 namespace Aurora {
 
-TTFFont::Page::Page() : needRebuild(false),
-		curX(0), curY(0), heightLeft(kPageHeight), widthLeft(kPageWidth) {
+std::vector<TTFFont::Page *> TTFFont::_pages;
+std::list<TTFFont *> TTFFont::_fonts;
+uint TTFFont::_openPage = 0;
+uint32 TTFFont::_useTime = 0;
+Common::Mutex TTFFont::_pagesMutex;
+
+TTFFont::Page::Page() : nextY(0), lastUsed(0),
+	dirtyX1(kPageWidth), dirtyY1(kPageHeight), dirtyX2(0), dirtyY2(0) {
 
 	surface = new Surface(kPageWidth, kPageHeight);
 	surface->fill(0x00, 0x00, 0x00, 0x00);
@@ -57,20 +70,47 @@ TTFFont::Page::Page() : needRebuild(false),
 	texture = TextureMan.add(new Texture(surface));
 }
 
+void TTFFont::Page::addDirty(uint32 x, uint32 y, uint32 width, uint32 height) {
+	dirtyX1 = MIN(dirtyX1, x);
+	dirtyY1 = MIN(dirtyY1, y);
+	dirtyX2 = MAX(dirtyX2, x + width);
+	dirtyY2 = MAX(dirtyY2, y + height);
+}
+
+void TTFFont::Page::clear() {
+	surface->fill(0x00, 0x00, 0x00, 0x00);
+
+	nextY = 0;
+
+	addDirty(0, 0, kPageWidth, kPageHeight);
+}
+
 void TTFFont::Page::rebuild() {
-	if (!needRebuild)
+	if ((dirtyX1 >= dirtyX2) || (dirtyY1 >= dirtyY2))
 		return;
 
-	texture.getTexture().rebuild();
-	needRebuild = false;
+	texture.getTexture().refresh(dirtyX1, dirtyY1, dirtyX2 - dirtyX1, dirtyY2 - dirtyY1);
+
+	dirtyX1 = kPageWidth;
+	dirtyY1 = kPageHeight;
+	dirtyX2 = 0;
+	dirtyY2 = 0;
+}
+
+
+TTFFont::Row::Row() : page(0), curX(kPageWidth), curY(0) {
 }
 
 
-TTFFont::TTFFont(Common::SeekableReadStream *ttf, int height) : _ttf(0) {
+TTFFont::TTFFont(Common::SeekableReadStream *ttf, int height) :
+	_ttf(0), _missingChar(0), _generation(0) {
+
 	load(ttf, height);
 }
 
-TTFFont::TTFFont(const Common::UString &name, int height) : _ttf(0) {
+TTFFont::TTFFont(const Common::UString &name, int height) :
+	_ttf(0), _missingChar(0), _generation(0) {
+
 	Common::SeekableReadStream *ttf = ResMan.getResource(name, ::Aurora::kFileTypeTTF);
 	if (!ttf)
 		throw Common::Exception("No such font \"%s\"", name.c_str());
@@ -79,10 +119,21 @@ TTFFont::TTFFont(const Common::UString &name, int height) : _ttf(0) {
 }
 
 TTFFont::~TTFFont() {
+	delete _ttf;
+
+	Common::StackLock lock(_pagesMutex);
+
+	_fonts.remove(this);
+	if (_fonts.empty())
+		destroyPages();
+}
+
+void TTFFont::destroyPages() {
 	for (std::vector<Page *>::iterator p = _pages.begin(); p != _pages.end(); ++p)
 		delete *p;
 
-	delete _ttf;
+	_pages.clear();
+	_openPage = 0;
 }
 
 void TTFFont::load(Common::SeekableReadStream *ttf, int height) {
@@ -96,42 +147,77 @@ void TTFFont::load(Common::SeekableReadStream *ttf, int height) {
 	delete ttf;
 
 	_height = _ttf->getHeight();
-	if (_height > kPageHeight)
+	if (_height > kPageHeight) {
+		delete _ttf;
 		throw Common::Exception("Font height too big (%d)", _height);
+	}
+
+	// From here on, we're using the shared pages
+	Common::StackLock lock(_pagesMutex);
+
+	_fonts.push_back(this);
+	_useTime++;
 
 	// Add all ASCII characters
 	for (uint32 i = 0; i < 128; i++)
 		addChar(i);
 
 	// Add the Unicode "replacement character" character
-	addChar(0xFFFD);
-	_missingChar = _chars.find(0xFFFD);
+	addMissingChar();
 
 	// Find an appropriate width for a "missing character" character
-	if (_missingChar == _chars.end()) {
+	if (!_missingChar) {
 		// This font doesn't have the Unicode "replacement character"
 
 		// Try to find the width of an m. Alternatively, take half of a line's height.
-		std::map<uint32, Char>::const_iterator m = _chars.find('m');
+		CharMap::const_iterator m = _chars.find('m');
 		if (m != _chars.end())
 			_missingWidth = m->second.width;
 		else
 			_missingWidth = MAX<float>(2.0, _height / 2);
 
 	} else
-		_missingWidth = _missingChar->second.width;
+		_missingWidth = _missingChar->width;
+
+	// Add the characters used by the European localizations up front, so
+	// that they don't have to be rendered and uploaded while the game runs
+	preloadRange(0x00A0, 0x00FF); // Latin-1 Supplement
+	preloadRange(0x0100, 0x017F); // Latin Extended-A
+	preloadRange(0x0400, 0x045F); // Cyrillic
+	preloadRange(0x2010, 0x2026); // General Punctuation: dashes, quotes, ellipsis
 
 	rebuildPages();
 }
 
+void TTFFont::addMissingChar() {
+	addChar(0xFFFD);
+
+	// Element pointers stay valid when the hash map grows, unlike its iterators
+	CharMap::const_iterator missing = _chars.find(0xFFFD);
+	_missingChar = (missing != _chars.end()) ? &missing->second : 0;
+}
+
+void TTFFont::preloadRange(uint32 from, uint32 to) {
+	for (uint32 c = from; c <= to; c++)
+		addChar(c);
+}
+
 float TTFFont::getWidth(uint32 c) const {
-	std::map<uint32, Char>::const_iterator cC = _chars.find(c);
+	CharMap::const_iterator cC = _chars.find(c);
 	if (cC == _chars.end())
 		return _missingWidth;
 
 	return cC->second.width;
 }
 
+const TTFFont::Char *TTFFont::findChar(uint32 c) const {
+	CharMap::const_iterator cC = _chars.find(c);
+	if (cC != _chars.end())
+		return &cC->second;
+
+	return _missingChar;
+}
+
 float TTFFont::getHeight() const {
 	return _height;
 }
@@ -152,47 +238,166 @@ void TTFFont::drawMissing() const {
 }
 
 void TTFFont::draw(uint32 c) const {
-	std::map<uint32, Char>::const_iterator cC = _chars.find(c);
-	if (cC == _chars.end()) {
-		cC = _missingChar;
-
-		if (cC == _chars.end()) {
-			drawMissing();
-			return;
-		}
+	const Char *cC = findChar(c);
+	if (!cC) {
+		drawMissing();
+		return;
 	}
 
-	uint page = cC->second.page;
-	assert(page < _pages.size());
-
-	TextureMan.set(_pages[page]->texture);
+	TextureMan.set(cC->page->texture);
 
 	glBegin(GL_QUADS);
 	for (int i = 0; i < 4; i++) {
-		glTexCoord2f(cC->second.tX[i], cC->second.tY[i]);
-		glVertex2f  (cC->second.vX[i], cC->second.vY[i]);
+		glTexCoord2f(cC->tX[i], cC->tY[i]);
+		glVertex2f  (cC->vX[i], cC->vY[i]);
 	}
 	glEnd();
 
-	glTranslatef(cC->second.width, 0.0, 0.0);
+	glTranslatef(cC->width, 0.0, 0.0);
+}
+
+void TTFFont::getMissingQuad(CharQuad &quad) const {
+	const float width = _missingWidth - 1.0;
+
+	quad.texture = 0;
+
+	quad.vX[0] = 0.0  ; quad.vY[0] =     0.0;
+	quad.vX[1] = width; quad.vY[1] =     0.0;
+	quad.vX[2] = width; quad.vY[2] = _height;
+	quad.vX[3] = 0.0  ; quad.vY[3] = _height;
+
+	for (int i = 0; i < 4; i++)
+		quad.tX[i] = quad.tY[i] = 0.0;
+
+	quad.advance = width + 1.0;
+}
+
+void TTFFont::getCharQuad(uint32 c, CharQuad &quad) const {
+	const Char *cC = findChar(c);
+	if (!cC) {
+		getMissingQuad(quad);
+		return;
+	}
+
+	quad.texture = &cC->page->texture.getTexture();
+
+	for (int i = 0; i < 4; i++) {
+		quad.vX[i] = cC->vX[i];
+		quad.vY[i] = cC->vY[i];
+		quad.tX[i] = cC->tX[i];
+		quad.tY[i] = cC->tY[i];
+	}
+
+	quad.advance = cC->width;
 }
 
 void TTFFont::buildChars(const Common::UString &str) {
+	Common::StackLock lock(_pagesMutex);
+
+	_useTime++;
+
 	for (Common::UString::iterator c = str.begin(); c != str.end(); ++c)
 		addChar(*c);
 
+	// Our "missing character" character might have been evicted
+	if (!_missingChar)
+		addMissingChar();
+
 	rebuildPages();
 }
 
+uint32 TTFFont::getGeneration() const {
+	Common::StackLock lock(_pagesMutex);
+
+	return _generation;
+}
+
 void TTFFont::rebuildPages() {
 	for (std::vector<Page *>::iterator p = _pages.begin(); p != _pages.end(); ++p)
 		(*p)->rebuild();
 }
 
+uint TTFFont::findFreePage() {
+	if (_pages.size() < kMaxPages) {
+		_pages.push_back(new Page);
+		return _pages.size() - 1;
+	}
+
+	// Find the least recently used page, ignoring the ones we're using right now
+	uint oldest = _pages.size();
+	for (uint i = 0; i < _pages.size(); i++) {
+		if (_pages[i]->lastUsed == _useTime)
+			continue;
+
+		if ((oldest == _pages.size()) || (_pages[i]->lastUsed < _pages[oldest]->lastUsed))
+			oldest = i;
+	}
+
+	if (oldest == _pages.size()) {
+		_pages.push_back(new Page);
+		return _pages.size() - 1;
+	}
+
+	evictPage(oldest);
+	return oldest;
+}
+
+void TTFFont::evictPage(uint index) {
+	for (std::list<TTFFont *>::iterator f = _fonts.begin(); f != _fonts.end(); ++f)
+		(*f)->dropPage(index);
+
+	_pages[index]->clear();
+}
+
+void TTFFont::dropPage(uint index) {
+	const Page *page = _pages[index];
+
+	bool dropped = false;
+	for (CharMap::iterator c = _chars.begin(); c != _chars.end(); ) {
+		if (c->second.page != page) {
+			++c;
+			continue;
+		}
+
+		if (&c->second == _missingChar)
+			_missingChar = 0;
+
+		c = _chars.erase(c);
+		dropped = true;
+	}
+
+	if (dropped)
+		_generation++;
+
+	// Our current row is gone, too
+	if (_row.page == index)
+		_row.curX = kPageWidth;
+}
+
+void TTFFont::allocChar(uint32 width) {
+	if ((_row.page < _pages.size()) && ((_row.curX + width) <= kPageWidth))
+		return;
+
+	// The current character doesn't fit into the current row, start a new one
+
+	if ((_openPage >= _pages.size()) || ((_pages[_openPage]->nextY + _height) > kPageHeight))
+		_openPage = findFreePage();
+
+	Page &page = *_pages[_openPage];
+
+	_row.page = _openPage;
+	_row.curX = 0;
+	_row.curY = page.nextY;
+
+	page.nextY += _height;
+}
+
 void TTFFont::addChar(uint32 c) {
-	std::map<uint32, Char>::iterator cC = _chars.find(c);
-	if (cC != _chars.end())
+	CharMap::iterator cC = _chars.find(c);
+	if (cC != _chars.end()) {
+		cC->second.page->lastUsed = _useTime;
 		return;
+	}
 
 	if (!_ttf->hasChar(c))
 		return;
@@ -203,51 +408,31 @@ void TTFFont::addChar(uint32 c) {
 		if (cWidth > kPageWidth)
 			return;
 
-		if (_pages.empty())
-			_pages.push_back(new Page);
-
-		if (_pages.back()->widthLeft < cWidth) {
-			// The current character doesn't fit into the current line
-
-			if (_pages.back()->heightLeft >= _height) {
-				// Create a new line
+		allocChar(cWidth);
 
-				_pages.back()->curX  = 0;
-				_pages.back()->curY += _height;
+		Page &page = *_pages[_row.page];
+		page.lastUsed = _useTime;
 
-				_pages.back()->heightLeft -= _height;
-				_pages.back()->widthLeft   = kPageWidth;
+		_ttf->drawCharacter(c, *page.surface, _row.curX, _row.curY);
 
-			} else {
-				// Create a new page
-
-				_pages.push_back(new Page);
-				_pages.back()->heightLeft -= _height;
-			}
-
-		}
-
-		_ttf->drawCharacter(c, *_pages.back()->surface, _pages.back()->curX, _pages.back()->curY);
-
-		std::pair<std::map<uint32, Char>::iterator, bool> result;
+		std::pair<CharMap::iterator, bool> result;
 
 		result = _chars.insert(std::make_pair(c, Char()));
 
 		cC = result.first;
 
-		Char &ch   = cC->second;
-		Page &page = *_pages.back();
+		Char &ch = cC->second;
 
 		ch.width = cWidth;
-		ch.page  = _pages.size() - 1;
+		ch.page  = &page;
 
 		ch.vX[0] = 0.00;   ch.vY[0] = 0.00;
 		ch.vX[1] = cWidth; ch.vY[1] = 0.00;
 		ch.vX[2] = cWidth; ch.vY[2] = _height;
 		ch.vX[3] = 0.00;   ch.vY[3] = _height;
 
-		const float tX = (float) page.curX / (float) kPageWidth;
-		const float tY = (float) page.curY / (float) kPageHeight;
+		const float tX = (float) _row.curX / (float) kPageWidth;
+		const float tY = (float) _row.curY / (float) kPageHeight;
 		const float tW = (float) cWidth    / (float) kPageWidth;
 		const float tH = (float) _height   / (float) kPageHeight;
 
@@ -256,9 +441,9 @@ void TTFFont::addChar(uint32 c) {
 		ch.tX[2] = tX + tW; ch.tY[2] = tY;
 		ch.tX[3] = tX;      ch.tY[3] = tY;
 
-		_pages.back()->widthLeft  -= cWidth;
-		_pages.back()->curX       += cWidth;
-		_pages.back()->needRebuild = true;
+		page.addDirty(_row.curX, _row.curY, cWidth, _height);
+
+		_row.curX += cWidth;
 
 	} catch (Common::Exception &e) {
 		if (cC != _chars.end())
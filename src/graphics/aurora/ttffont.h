@@ -31,9 +31,12 @@
 #define GRAPHICS_AURORA_TTFFONT_H
 
 #include <vector>
-#include <map>
+#include <list>
+
+#include <boost/unordered/unordered_map.hpp>
 
 #include "common/types.h"
+#include "common/mutex.h"
 
 #include "graphics/font.h"
 
@@ -62,28 +65,44 @@ public:
 	float getHeight()         const;
 
 	void draw(uint32 c) const;
+	void getCharQuad(uint32 c, CharQuad &quad) const;
 
 	void buildChars(const Common::UString &str);
 
+	uint32 getGeneration() const;
+
 private:
-	/** A texture page filled with characters. */
+	/** A texture page filled with characters, shared between all TrueType fonts. */
 	struct Page {
 		Surface *surface;
 		TextureHandle texture;
 
-		bool needRebuild;
-
-		uint32 curX;
-		uint32 curY;
+		uint32 nextY;    ///< Top edge of the first unused row.
+		uint32 lastUsed; ///< The last time a character on this page was built.
 
-		uint32 heightLeft;
-		uint32 widthLeft;
+		/** The area that changed since the last upload. */
+		uint32 dirtyX1, dirtyY1, dirtyX2, dirtyY2;
 
 		Page();
 
+		/** Mark this area as changed. */
+		void addDirty(uint32 x, uint32 y, uint32 width, uint32 height);
+		/** Empty the page, so that it can be filled anew. */
+		void clear();
+		/** Upload the changed area. */
 		void rebuild();
 	};
 
+	/** A row of a page, reserved for the characters of one font. */
+	struct Row {
+		uint page;
+
+		uint32 curX;
+		uint32 curY;
+
+		Row();
+	};
+
 	/** A font character. */
 	struct Char {
 		float width;
@@ -91,25 +110,66 @@ private:
 		float tX[4], tY[4];
 		float vX[4], vY[4];
 
-		uint page;
+		/** The page with the character. Pages stay put while any font exists. */
+		Page *page;
 	};
 
+	typedef boost::unordered_map<uint32, Char> CharMap;
+
 
 	TTFRenderer *_ttf;
 
-	std::vector<Page *> _pages;
-	std::map<uint32, Char> _chars;
+	Row _row;
+	CharMap _chars;
 
-	std::map<uint32, Char>::const_iterator _missingChar;
+	const Char *_missingChar;
 	float _missingWidth;
 
 	uint32 _height;
 
+	/** Bumped whenever characters of this font were evicted. */
+	uint32 _generation;
+
+	static std::vector<Page *>  _pages; ///< All pages, shared by all fonts.
+	static std::list<TTFFont *> _fonts; ///< All fonts using the shared pages.
+
+	static uint   _openPage; ///< The page new rows are reserved on.
+	static uint32 _useTime;  ///< Bumped for every buildChars(), to find the least recently used page.
+
+	/** Protects the shared pages, the font list and the generations.
+	 *
+	 *  Drawing doesn't need it: the characters point to their pages directly,
+	 *  and pages are only freed once the last font is gone. Evicting a page
+	 *  bumps the generation of the fonts that lost characters, so that texts
+	 *  build them again.
+	 */
+	static Common::Mutex _pagesMutex;
+
 	void load(Common::SeekableReadStream *ttf, int height);
 
-	void rebuildPages();
+	/** Add all characters of a commonly used block, so we don't have to do it later. */
+	void preloadRange(uint32 from, uint32 to);
+
+	static void rebuildPages();
+	static void destroyPages();
+
+	/** Return a page with room for new rows, evicting the least recently used one if necessary. */
+	static uint findFreePage();
+	/** Throw out all characters on this page. */
+	static void evictPage(uint index);
+
+	/** Forget all our characters on this page. */
+	void dropPage(uint index);
+	/** Add the "missing character" character, if we have one. */
+	void addMissingChar();
+
+	/** Find space for a character of this width, starting a new row if necessary. */
+	void allocChar(uint32 width);
+	/** Return the character, or the "missing character" character if we don't have it. */
+	const Char *findChar(uint32 c) const;
 	void addChar(uint32 c);
 	void drawMissing() const;
+	void getMissingQuad(CharQuad &quad) const;
 };
 
 } // End of namespace Aurora
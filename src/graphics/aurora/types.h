@@ -44,6 +44,7 @@ enum ModelType {
 
 class Model;
 class ModelNode;
+class StaticGeometry;
 class Text;
 class GUIQuad;
 
@@ -0,0 +1,245 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/benchmark.cpp
+ *  Measuring the render performance along a scripted camera path.
+ */
+
+#include <algorithm>
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/ustring.h"
+#include "common/stream.h"
+#include "common/streamtokenizer.h"
+
+#include "graphics/benchmark.h"
+#include "graphics/camera.h"
+
+namespace Graphics {
+
+FrameTime::FrameTime() {
+	clear();
+}
+
+void FrameTime::clear() {
+	world     = 0.0;
+	gui       = 0.0;
+	animation = 0.0;
+	textures  = 0.0;
+	frame     = 0.0;
+}
+
+
+Benchmark::Benchmark(uint32 frames, float frameLength) : _frames(frames),
+	_frameLength(frameLength), _currentFrame(0), _hasStart(false) {
+
+	_times.reserve(_frames);
+}
+
+Benchmark::~Benchmark() {
+}
+
+void Benchmark::loadCameraPath(Common::SeekableReadStream &path) {
+	Common::StreamTokenizer tokenize(Common::StreamTokenizer::kRuleIgnoreAll);
+
+	tokenize.addSeparator(' ');
+	tokenize.addSeparator('\t');
+	tokenize.addChunkEnd('\n');
+	tokenize.addIgnore('\r');
+
+	std::vector<CameraKey> keys;
+
+	while (!path.eos() && !path.err()) {
+		std::vector<Common::UString> line;
+
+		int count = tokenize.getTokens(path, line, 7);
+
+		tokenize.nextChunk(path);
+
+		// Ignore empty lines and comments
+		if ((count == 0) || line[0].empty() || (*line[0].begin() == '#'))
+			continue;
+
+		if (count < 7)
+			throw Common::Exception("Broken camera path point in line %u", (uint) (keys.size() + 1));
+
+		CameraKey key;
+
+		line[0].parse(key.time);
+		for (int i = 0; i < 3; i++) {
+			line[1 + i].parse(key.position   [i]);
+			line[4 + i].parse(key.orientation[i]);
+		}
+
+		if (!keys.empty() && (key.time < keys.back().time))
+			throw Common::Exception("Camera path points out of order");
+
+		keys.push_back(key);
+	}
+
+	if (keys.empty())
+		throw Common::Exception("Empty camera path");
+
+	Common::StackLock lock(_mutex);
+
+	_path.swap(keys);
+	_hasStart = true;
+}
+
+bool Benchmark::isFinished() const {
+	Common::StackLock lock(_mutex);
+
+	return _currentFrame >= _frames;
+}
+
+void Benchmark::createDefaultPath() {
+	CameraKey start;
+
+	CameraMan.lock();
+	memcpy(start.position   , CameraMan.getPosition   (), 3 * sizeof(float));
+	memcpy(start.orientation, CameraMan.getOrientation(), 3 * sizeof(float));
+	CameraMan.unlock();
+
+	start.time = 0.0f;
+
+	// Turn around once
+	CameraKey end = start;
+
+	end.time            = _frames * _frameLength;
+	end.orientation[1] += 360.0f;
+
+	_path.clear();
+	_path.push_back(start);
+	_path.push_back(end);
+}
+
+void Benchmark::getCamera(float time, float *position, float *orientation) const {
+	// Find the path segment we're in
+	uint32 next = 0;
+	while ((next < _path.size()) && (_path[next].time <= time))
+		next++;
+
+	if ((next == 0) || (next == _path.size())) {
+		// Before the first or after the last point, stay there
+		const CameraKey &key = _path[(next == 0) ? 0 : (next - 1)];
+
+		memcpy(position   , key.position   , 3 * sizeof(float));
+		memcpy(orientation, key.orientation, 3 * sizeof(float));
+		return;
+	}
+
+	const CameraKey &a = _path[next - 1];
+	const CameraKey &b = _path[next];
+
+	const float f = (time - a.time) / (b.time - a.time);
+
+	for (int i = 0; i < 3; i++) {
+		position   [i] = a.position   [i] + f * (b.position   [i] - a.position   [i]);
+		orientation[i] = a.orientation[i] + f * (b.orientation[i] - a.orientation[i]);
+	}
+}
+
+float Benchmark::beginFrame() {
+	float position[3], orientation[3];
+
+	{
+		Common::StackLock lock(_mutex);
+
+		if (!_hasStart) {
+			createDefaultPath();
+			_hasStart = true;
+		}
+
+		getCamera(_currentFrame * _frameLength, position, orientation);
+	}
+
+	CameraMan.setPosition   (position   [0], position   [1], position   [2]);
+	CameraMan.setOrientation(orientation[0], orientation[1], orientation[2]);
+
+	return _frameLength;
+}
+
+void Benchmark::endFrame(const FrameTime &time) {
+	Common::StackLock lock(_mutex);
+
+	if (_currentFrame >= _frames)
+		return;
+
+	_times.push_back(time);
+	_currentFrame++;
+}
+
+void Benchmark::writeReport(Common::WriteStream &report) const {
+	Common::StackLock lock(_mutex);
+
+	report.writeString("frame,frame_ms,world_ms,gui_ms,animation_ms,textures_ms\n");
+
+	for (uint32 i = 0; i < _times.size(); i++) {
+		const FrameTime &t = _times[i];
+
+		report.writeString(Common::UString::sprintf("%u,%.3f,%.3f,%.3f,%.3f,%.3f\n", i,
+		                   t.frame, t.world, t.gui, t.animation, t.textures));
+	}
+}
+
+void Benchmark::printSummary() const {
+	Common::StackLock lock(_mutex);
+
+	if (_times.empty()) {
+		status("Benchmark: No frames rendered");
+		return;
+	}
+
+	FrameTime average;
+	std::vector<double> frames;
+
+	frames.reserve(_times.size());
+	for (std::vector<FrameTime>::const_iterator t = _times.begin(); t != _times.end(); ++t) {
+		average.world     += t->world;
+		average.gui       += t->gui;
+		average.animation += t->animation;
+		average.textures  += t->textures;
+		average.frame     += t->frame;
+
+		frames.push_back(t->frame);
+	}
+
+	const double count = _times.size();
+
+	std::sort(frames.begin(), frames.end());
+
+	const double median = frames[frames.size() / 2];
+	const double p95    = frames[MIN<size_t>((size_t) (frames.size() * 0.95), frames.size() - 1)];
+
+	status("Benchmark: %u frames, %.3f ms per frame on average (%.1f fps)", (uint) _times.size(),
+	       average.frame / count, (average.frame > 0.0) ? (1000.0 * count / average.frame) : 0.0);
+	status("Benchmark: Frame time min %.3f ms, median %.3f ms, 95th percentile %.3f ms, max %.3f ms",
+	       frames.front(), median, p95, frames.back());
+	status("Benchmark: Average world %.3f ms, GUI %.3f ms, animation %.3f ms, textures %.3f ms",
+	       average.world / count, average.gui / count, average.animation / count, average.textures / count);
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,125 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/benchmark.h
+ *  Measuring the render performance along a scripted camera path.
+ */
+
+#ifndef GRAPHICS_BENCHMARK_H
+#define GRAPHICS_BENCHMARK_H
+
+#include <vector>
+
+#include "common/types.h"
+#include "common/mutex.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Graphics {
+
+/** The CPU time spent on the parts of rendering one frame, in milliseconds. */
+struct FrameTime {
+	double world;     ///< Drawing the world objects, without animations and texture uploads.
+	double gui;       ///< Drawing the GUI front objects, without texture uploads.
+	double animation; ///< Advancing the animations of the world objects.
+	double textures;  ///< Uploading new textures.
+	double frame;     ///< The whole frame, including the buffer swap.
+
+	FrameTime();
+
+	void clear();
+};
+
+/** A render benchmark.
+ *
+ *  While a benchmark is set in the GraphicsManager, each rendered frame
+ *  moves the camera along the benchmark's path and advances the animations
+ *  by a fixed time step, so that every run renders exactly the same frames.
+ *  The time each frame took is recorded, for a report at the end.
+ *
+ *  Without an explicit camera path, the camera turns around once on the
+ *  spot where it was when the benchmark started.
+ */
+class Benchmark {
+public:
+	/** A point on the camera path. */
+	struct CameraKey {
+		float time;           ///< Time of this point on the path, in seconds.
+		float position   [3]; ///< Camera position.
+		float orientation[3]; ///< Camera orientation.
+	};
+
+	/** Create a benchmark rendering this many frames, each advancing the animations by frameLength seconds. */
+	Benchmark(uint32 frames, float frameLength = 1.0f / 30.0f);
+	~Benchmark();
+
+	/** Read the camera path from a text file.
+	 *
+	 *  Each line holds one point of the path, consisting of seven numbers:
+	 *  the time in seconds, the position and the orientation. The camera
+	 *  moves linearly between the points. Empty lines and lines starting
+	 *  with a '#' are ignored.
+	 */
+	void loadCameraPath(Common::SeekableReadStream &path);
+
+	/** Have all frames been rendered? */
+	bool isFinished() const;
+
+	/** Write the time of every frame in CSV format. */
+	void writeReport(Common::WriteStream &report) const;
+	/** Print a summary of the frame times. */
+	void printSummary() const;
+
+
+	// Called by the GraphicsManager from within the render thread
+
+	/** Position the camera for the next frame. Returns the time step to advance the animations by. */
+	float beginFrame();
+	/** Record the time the frame took. */
+	void endFrame(const FrameTime &time);
+
+private:
+	uint32 _frames;      ///< Number of frames to render.
+	float  _frameLength; ///< Time step between frames, in seconds.
+
+	uint32 _currentFrame; ///< Number of frames already rendered.
+	bool   _hasStart;     ///< Did we already pick up the camera's starting point?
+
+	std::vector<CameraKey> _path;  ///< The camera path.
+	std::vector<FrameTime> _times; ///< The times of all rendered frames.
+
+	mutable Common::Mutex _mutex;
+
+	void createDefaultPath();
+
+	void getCamera(float time, float *position, float *orientation) const;
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_BENCHMARK_H
@@ -32,6 +32,7 @@
 
 #include "graphics/types.h"
 #include "graphics/font.h"
+#include "graphics/guidrawlist.h"
 
 namespace Graphics {
 
@@ -71,6 +72,10 @@ float Font::getHeight(const Common::UString &text) const {
 void Font::buildChars(const Common::UString &str) {
 }
 
+uint32 Font::getGeneration() const {
+	return 0;
+}
+
 void Font::draw(Common::UString text, const ColorPositions &colors,
                 float r, float g, float b, float a, float align) const {
 
@@ -122,6 +127,62 @@ void Font::draw(Common::UString text, const ColorPositions &colors,
 	glColor4f(1.0, 1.0, 1.0, 1.0);
 }
 
+void Font::addToDrawList(GUIDrawList &list, const Common::UString &text, const ColorPositions &colors,
+                         float r, float g, float b, float a, float align) const {
+
+	float curR = r, curG = g, curB = b, curA = a;
+
+	list.reserve(text.size());
+
+	std::vector<Common::UString> lines;
+	float maxLength = split(text, lines);
+
+	// Start at the top
+	float y = (lines.size() - 1) * (getHeight() + getLineSpacing());
+
+	uint32 position = 0;
+
+	ColorPositions::const_iterator color = colors.begin();
+
+	CharQuad quad;
+	float vX[4], vY[4];
+
+	for (std::vector<Common::UString>::iterator l = lines.begin(); l != lines.end(); ++l) {
+		// Align
+		float x = roundf((maxLength - getLineWidth(*l)) * align);
+
+		for (Common::UString::iterator s = l->begin(); s != l->end(); ++s, position++) {
+			// If we have color changes, apply them
+			while ((color != colors.end()) && (color->position <= position)) {
+				if (color->defaultColor) {
+					curR = r; curG = g; curB = b; curA = a;
+				} else {
+					curR = color->r; curG = color->g; curB = color->b; curA = color->a;
+				}
+
+				++color;
+			}
+
+			getCharQuad(*s, quad);
+
+			for (int i = 0; i < 4; i++) {
+				vX[i] = quad.vX[i] + x;
+				vY[i] = quad.vY[i] + y;
+			}
+
+			list.addQuad(quad.texture, vX, vY, quad.tX, quad.tY, curR, curG, curB, curA);
+
+			x += quad.advance;
+		}
+
+		// Move to the next line
+		y -= getHeight() + getLineSpacing();
+
+		// \n character
+		position++;
+	}
+}
+
 float Font::split(const Common::UString &line, std::vector<Common::UString> &lines,
                   float maxWidth) const {
 
@@ -38,9 +38,22 @@
 
 namespace Graphics {
 
+class Texture;
+class GUIDrawList;
+
 /** An abstract font. */
 class Font {
 public:
+	/** The quad needed to draw a character. */
+	struct CharQuad {
+		const Texture *texture; ///< The texture to draw the character with, 0 for none.
+
+		float vX[4], vY[4]; ///< Vertex coordinates, relative to the current position.
+		float tX[4], tY[4]; ///< Texture coordinates.
+
+		float advance; ///< Distance to the next character.
+	};
+
 	Font();
 	virtual ~Font();
 
@@ -63,12 +76,26 @@ public:
 	/** Build all necessary characters to display this string. */
 	virtual void buildChars(const Common::UString &str);
 
+	/** Return a counter that changes whenever previously built characters were dropped.
+	 *
+	 *  Once it changes, quads taken from getCharQuad() might be stale, and
+	 *  the characters need to be built again.
+	 */
+	virtual uint32 getGeneration() const;
+
 	/** Draw this character. */
 	virtual void draw(uint32 c) const = 0;
 
+	/** Return the quad needed to draw this character. */
+	virtual void getCharQuad(uint32 c, CharQuad &quad) const = 0;
+
 	void draw(Common::UString text, const ColorPositions &colors,
 	          float r, float g, float b, float a, float align = 0.0) const;
 
+	/** Add the quads needed to draw this text to a draw list, instead of drawing it directly. */
+	void addToDrawList(GUIDrawList &list, const Common::UString &text, const ColorPositions &colors,
+	                   float r, float g, float b, float a, float align = 0.0) const;
+
 	float split(const Common::UString &line, std::vector<Common::UString> &lines,
 	            float maxWidth = 0.0) const;
 	float split(Common::UString &line, float maxWidth) const;
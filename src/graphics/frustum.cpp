@@ -0,0 +1,136 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/frustum.cpp
+ *  The view frustum, for culling invisible objects.
+ */
+
+#include <cmath>
+
+#include "common/matrix.h"
+#include "common/boundingbox.h"
+
+#include "graphics/frustum.h"
+
+namespace Graphics {
+
+Frustum::Frustum() : _detailRatio(0.0) {
+	// Start out with a frustum that doesn't cull anything
+	for (int i = 0; i < 6; i++)
+		for (int j = 0; j < 4; j++)
+			_planes[i][j] = 0.0;
+
+	_eye[0] = _eye[1] = _eye[2] = 0.0;
+}
+
+Frustum::~Frustum() {
+}
+
+void Frustum::set(const Common::Matrix &projection, const Common::Matrix &modelView, const float eye[3]) {
+	const Common::Matrix clip = projection * modelView;
+
+	// Each plane is the last row of the clip matrix plus or minus one of the others
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			_planes[i * 2 + 0][j] = clip(3, j) + clip(i, j);
+			_planes[i * 2 + 1][j] = clip(3, j) - clip(i, j);
+		}
+	}
+
+	for (int i = 0; i < 6; i++) {
+		const float length = sqrtf(_planes[i][0] * _planes[i][0] +
+		                           _planes[i][1] * _planes[i][1] +
+		                           _planes[i][2] * _planes[i][2]);
+
+		if (length > 0.0)
+			for (int j = 0; j < 4; j++)
+				_planes[i][j] /= length;
+	}
+
+	_eye[0] = eye[0];
+	_eye[1] = eye[1];
+	_eye[2] = eye[2];
+}
+
+void Frustum::setDetailRatio(float ratio) {
+	_detailRatio = ratio;
+}
+
+Frustum::Intersection Frustum::test(const Common::BoundingBox &box) const {
+	if (box.isEmpty())
+		return kInside;
+
+	float min[3], max[3];
+	box.getMin(min[0], min[1], min[2]);
+	box.getMax(max[0], max[1], max[2]);
+
+	Intersection result = kInside;
+	for (int i = 0; i < 6; i++) {
+		const float *plane = _planes[i];
+
+		// The corner furthest along the plane normal, and the one opposite to it
+		float pos = plane[3], neg = plane[3];
+		for (int j = 0; j < 3; j++) {
+			if (plane[j] >= 0.0) {
+				pos += plane[j] * max[j];
+				neg += plane[j] * min[j];
+			} else {
+				pos += plane[j] * min[j];
+				neg += plane[j] * max[j];
+			}
+		}
+
+		if (pos < 0.0)
+			return kOutside;
+
+		if (neg < 0.0)
+			result = kIntersect;
+	}
+
+	return result;
+}
+
+bool Frustum::isTooSmall(const Common::BoundingBox &box) const {
+	if ((_detailRatio <= 0.0) || box.isEmpty())
+		return false;
+
+	float min[3], max[3];
+	box.getMin(min[0], min[1], min[2]);
+	box.getMax(max[0], max[1], max[2]);
+
+	float size = 0.0, distance = 0.0;
+	for (int i = 0; i < 3; i++) {
+		const float extent = max[i] - min[i];
+		const float offset = _eye[i] - (min[i] + extent / 2.0);
+
+		size     += extent * extent;
+		distance += offset * offset;
+	}
+
+	// Compare the squares, to avoid the square roots
+	return size < (_detailRatio * _detailRatio * distance);
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,85 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/frustum.h
+ *  The view frustum, for culling invisible objects.
+ */
+
+#ifndef GRAPHICS_FRUSTUM_H
+#define GRAPHICS_FRUSTUM_H
+
+namespace Common {
+	class Matrix;
+	class BoundingBox;
+}
+
+namespace Graphics {
+
+/** The volume visible from the camera, described by six planes. */
+class Frustum {
+public:
+	/** Where is a box relative to the frustum? */
+	enum Intersection {
+		kOutside   = 0, ///< Completely outside, invisible.
+		kIntersect = 1, ///< Partially visible.
+		kInside    = 2  ///< Completely visible.
+	};
+
+	Frustum();
+	~Frustum();
+
+	/** Extract the frustum planes out of the projection and modelview matrices.
+	 *
+	 *  @param projection The projection matrix.
+	 *  @param modelView  The camera's modelview matrix.
+	 *  @param eye        The position of the camera, in world coordinates.
+	 */
+	void set(const Common::Matrix &projection, const Common::Matrix &modelView, const float eye[3]);
+
+	/** Set the ratio of size to distance below which a box is considered too small to see.
+	 *
+	 *  0.0 disables the distance culling.
+	 */
+	void setDetailRatio(float ratio);
+
+	/** Test an absolutized, world space box against the frustum.
+	 *
+	 *  An empty box is always considered to be inside.
+	 */
+	Intersection test(const Common::BoundingBox &box) const;
+
+	/** Is this absolutized, world space box too small to see from this far away? */
+	bool isTooSmall(const Common::BoundingBox &box) const;
+
+private:
+	float _planes[6][4]; ///< The six planes, as (a, b, c, d) with normals pointing inwards.
+	float _eye[3];       ///< The position of the camera.
+
+	float _detailRatio;  ///< Minimum size/distance ratio for a visible box.
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_FRUSTUM_H
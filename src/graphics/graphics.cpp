@@ -37,6 +37,7 @@
 #include "common/file.h"
 #include "common/configman.h"
 #include "common/threads.h"
+#include "common/threadpool.h"
 #include "common/transmatrix.h"
 
 #include "events/requests.h"
@@ -50,6 +51,8 @@
 #include "graphics/queueman.h"
 #include "graphics/glcontainer.h"
 #include "graphics/renderable.h"
+#include "graphics/guifrontelement.h"
+#include "graphics/guidrawlist.h"
 #include "graphics/camera.h"
 
 #include "graphics/images/decoder.h"
@@ -61,13 +64,40 @@ namespace Graphics {
 
 PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2D;
 
+/** Advancing the animation of each object in a list, one object per job. */
+class AdvanceTimeJobs : public Common::ThreadPool::Jobs {
+public:
+	AdvanceTimeJobs(const std::vector<Queueable *> &objects, float dt) : _objects(objects), _dt(dt) {
+	}
+
+	uint getCount() const {
+		return _objects.size();
+	}
+
+	void runJob(uint n) {
+		static_cast<Renderable *>(_objects[n])->advanceTime(_dt);
+	}
+
+private:
+	const std::vector<Queueable *> &_objects;
+
+	float _dt;
+};
+
+/** Return the milliseconds that have passed since this performance counter value. */
+static double getElapsedMS(uint64 start) {
+	return ((SDL_GetPerformanceCounter() - start) * 1000.0) / SDL_GetPerformanceFrequency();
+}
+
 GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
 	_ready = false;
 
 	_needManualDeS3TC        = false;
 	_supportMultipleTextures = false;
+	_supportVertexBuffers    = false;
 
 	_fullScreen = false;
+	_headless   = false;
 
 	_fsaa    = 0;
 	_fsaaMax = 0;
@@ -80,6 +110,9 @@ GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
 	_height = 600;
 
 	_fpsCounter = new FPSCounter(3);
+	_guiDrawList = new GUIDrawList;
+
+	_animationThreads = new Common::ThreadPool;
 
 	_frameLock = 0;
 
@@ -94,12 +127,17 @@ GraphicsManager::GraphicsManager() : _projection(4, 4), _projectionInv(4, 4) {
 
 	_lastSampled = 0;
 
+	_benchmark     = 0;
+	_benchmarkStep = 0.0f;
+
 	glCompressedTexImage2D = 0;
 }
 
 GraphicsManager::~GraphicsManager() {
 	deinit();
 
+	delete _animationThreads;
+	delete _guiDrawList;
 	delete _fpsCounter;
 }
 
@@ -117,8 +155,22 @@ void GraphicsManager::init() {
 #endif
 */
 
-	if (SDL_Init(sdlInitFlags) < 0)
-		throw Common::Exception("Failed to initialize SDL: %s", SDL_GetError());
+	// Render into a hidden window, preferably without needing a display at all
+	_headless = ConfigMan.getBool("headless", false);
+	if (_headless)
+		SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+
+	if (SDL_Init(sdlInitFlags) < 0) {
+		if (!_headless)
+			throw Common::Exception("Failed to initialize SDL: %s", SDL_GetError());
+
+		// No offscreen video driver, try the default one with a hidden window instead
+		warning("Failed to initialize SDL headless (%s), trying the default video driver", SDL_GetError());
+
+		SDL_setenv("SDL_VIDEODRIVER", "", 1);
+		if (SDL_Init(sdlInitFlags) < 0)
+			throw Common::Exception("Failed to initialize SDL: %s", SDL_GetError());
+	}
 
 	int  width  = ConfigMan.getInt ("width"     , _width);
 	int  height = ConfigMan.getInt ("height"    , _height);
@@ -137,6 +189,12 @@ void GraphicsManager::init() {
 	if (ConfigMan.hasKey("gamma"))
 		setGamma(ConfigMan.getDouble("gamma", 1.0));
 
+	// Skip drawing small, far away parts of models. Off by default
+	_frustum.setDetailRatio(CLIP(ConfigMan.getDouble("detailculling", 0.0), 0.0, 1.0));
+
+	// One animation thread per additional core. The render thread helps out as well
+	_animationThreads->init(CLIP(SDL_GetCPUCount() - 1, 0, 7));
+
 	_ready = true;
 }
 
@@ -146,6 +204,10 @@ void GraphicsManager::deinit() {
 	if (!_ready)
 		return;
 
+	_animationThreads->deinit();
+
+	_guiDrawList->destroyGL();
+
 	QueueMan.clearAllQueues();
 
 	SDL_Quit();
@@ -154,6 +216,7 @@ void GraphicsManager::deinit() {
 
 	_needManualDeS3TC        = false;
 	_supportMultipleTextures = false;
+	_supportVertexBuffers    = false;
 }
 
 bool GraphicsManager::ready() const {
@@ -168,6 +231,14 @@ bool GraphicsManager::supportMultipleTextures() const {
 	return _supportMultipleTextures;
 }
 
+bool GraphicsManager::supportVertexBuffers() const {
+	return _supportVertexBuffers;
+}
+
+const Frustum &GraphicsManager::getFrustum() const {
+	return _frustum;
+}
+
 int GraphicsManager::getMaxFSAA() const {
 	return _fsaaMax;
 }
@@ -183,9 +254,11 @@ uint32 GraphicsManager::getFPS() const {
 void GraphicsManager::initSize(int width, int height, bool fullscreen) {
 	uint32 flags = SDL_WINDOW_OPENGL;
 
-	_fullScreen = fullscreen;
+	_fullScreen = fullscreen && !_headless;
 	if (_fullScreen)
 		flags |= SDL_WINDOW_FULLSCREEN | SDL_WINDOW_RESIZABLE ;
+	if (_headless)
+		flags |= SDL_WINDOW_HIDDEN;
 
 	if (!setupSDLGL(width, height, flags))
 		throw Common::Exception("Failed setting the video mode: %s", SDL_GetError());
@@ -281,7 +354,8 @@ int GraphicsManager::probeFSAA(int width, int height, uint32 flags) {
 }
 
 bool GraphicsManager::setupSDLGL(int width, int height, uint32 flags) {
-	_fsaaMax = probeFSAA(width, height, flags);
+	// Software contexts used for headless rendering rarely do FSAA, and probing is slow
+	_fsaaMax = _headless ? 0 : probeFSAA(width, height, flags);
 
 	SDL_GL_SetAttribute(SDL_GL_RED_SIZE    ,   8);
 	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE  ,   8);
@@ -332,6 +406,14 @@ void GraphicsManager::checkGLExtensions() {
 		_supportMultipleTextures = false;
 	} else
 		_supportMultipleTextures = true;
+
+	if (!GLEW_VERSION_1_5) {
+		warning("Your graphics card does not support vertex buffer objects");
+		warning("Model geometry will be sent to the graphics card every frame");
+
+		_supportVertexBuffers = false;
+	} else
+		_supportVertexBuffers = true;
 }
 
 void GraphicsManager::setWindowTitle(const Common::UString &title) {
@@ -599,8 +681,8 @@ void GraphicsManager::recalculateObjectDistances() {
 	// World objects
 	QueueMan.lockQueue(kQueueVisibleWorldObject);
 
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
-	for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o)
+	const std::vector<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
+	for (std::vector<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o)
 		static_cast<Renderable *>(*o)->calculateDistance();
 
 	QueueMan.sortQueue(kQueueVisibleWorldObject);
@@ -609,8 +691,8 @@ void GraphicsManager::recalculateObjectDistances() {
 	// GUI front objects
 	QueueMan.lockQueue(kQueueVisibleGUIFrontObject);
 
-	const std::list<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
-	for (std::list<Queueable *>::const_iterator g = gui.begin(); g != gui.end(); ++g)
+	const std::vector<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
+	for (std::vector<Queueable *>::const_iterator g = gui.begin(); g != gui.end(); ++g)
 		static_cast<Renderable *>(*g)->calculateDistance();
 
 	QueueMan.sortQueue(kQueueVisibleGUIFrontObject);
@@ -648,6 +730,19 @@ void GraphicsManager::abandon(ListID ids, uint32 count) {
 	_hasAbandoned = true;
 }
 
+void GraphicsManager::abandonBuffers(BufferID *ids, uint32 count) {
+	if (count == 0)
+		return;
+
+	Common::StackLock lock(_abandonMutex);
+
+	_abandonBuffers.reserve(_abandonBuffers.size() + count);
+	while (count-- > 0)
+		_abandonBuffers.push_back(*ids++);
+
+	_hasAbandoned = true;
+}
+
 void GraphicsManager::setCursor(Cursor *cursor) {
 	lockFrame();
 
@@ -679,10 +774,10 @@ Renderable *GraphicsManager::getGUIObjectAt(float x, float y) const {
 	Renderable *object = 0;
 
 	QueueMan.lockQueue(kQueueVisibleGUIFrontObject);
-	const std::list<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
+	const std::vector<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
 
 	// Go through the GUI elements, from nearest to furthest
-	for (std::list<Queueable *>::const_iterator g = gui.begin(); g != gui.end(); ++g) {
+	for (std::vector<Queueable *>::const_iterator g = gui.begin(); g != gui.end(); ++g) {
 		Renderable &r = static_cast<Renderable &>(**g);
 
 		if (!r.isClickable())
@@ -714,9 +809,9 @@ Renderable *GraphicsManager::getWorldObjectAt(float x, float y) const {
 	Renderable *object = 0;
 
 	QueueMan.lockQueue(kQueueVisibleWorldObject);
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
+	const std::vector<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
 
-	for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
+	for (std::vector<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
 		Renderable &r = static_cast<Renderable &>(**o);
 
 		if (!r.isClickable())
@@ -748,17 +843,50 @@ Renderable *GraphicsManager::getObjectAt(float x, float y) {
 
 void GraphicsManager::buildNewTextures() {
 	QueueMan.lockQueue(kQueueNewTexture);
-	const std::list<Queueable *> &text = QueueMan.getQueue(kQueueNewTexture);
+	const std::vector<Queueable *> &text = QueueMan.getQueue(kQueueNewTexture);
 	if (text.empty()) {
 		QueueMan.unlockQueue(kQueueNewTexture);
 		return;
 	}
 
-	for (std::list<Queueable *>::const_iterator t = text.begin(); t != text.end(); ++t)
-		static_cast<GLContainer *>(*t)->rebuild();
+	const uint64 start = SDL_GetPerformanceCounter();
+
+	// Index, since a rebuild might queue further textures
+	for (uint32 t = 0; t < text.size(); t++)
+		static_cast<GLContainer *>(text[t])->rebuild();
 
 	QueueMan.clearQueue(kQueueNewTexture);
 	QueueMan.unlockQueue(kQueueNewTexture);
+
+	_frameTime.textures += getElapsedMS(start);
+}
+
+void GraphicsManager::buildNewGLContainers() {
+	QueueMan.lockQueue(kQueueNewGLContainer);
+
+	const std::vector<Queueable *> &cont = QueueMan.getQueue(kQueueNewGLContainer);
+	for (uint32 c = 0; c < cont.size(); c++)
+		static_cast<GLContainer *>(cont[c])->rebuild();
+
+	QueueMan.clearQueue(kQueueNewGLContainer);
+	QueueMan.unlockQueue(kQueueNewGLContainer);
+}
+
+float GraphicsManager::getElapsedTime() {
+	// Get the current time
+	uint32 now = EventMan.getTimestamp();
+	if (_lastSampled == 0)
+		_lastSampled = now;
+
+	// Calc elapsed time
+	float elapsedTime = (now - _lastSampled) / 1000.0f;
+	_lastSampled = now;
+
+	// A benchmark advances the animations by fixed steps, to get the same frames every run
+	if (_benchmark)
+		return _benchmarkStep;
+
+	return elapsedTime;
 }
 
 void GraphicsManager::beginScene() {
@@ -787,9 +915,9 @@ bool GraphicsManager::playVideo() {
 	glLoadIdentity();
 
 	QueueMan.lockQueue(kQueueVisibleVideo);
-	const std::list<Queueable *> &videos = QueueMan.getQueue(kQueueVisibleVideo);
+	const std::vector<Queueable *> &videos = QueueMan.getQueue(kQueueVisibleVideo);
 
-	for (std::list<Queueable *>::const_iterator v = videos.begin(); v != videos.end(); ++v) {
+	for (std::vector<Queueable *>::const_iterator v = videos.begin(); v != videos.end(); ++v) {
 		glPushMatrix();
 		static_cast<Renderable *>(*v)->render(kRenderPassAll);
 		glPopMatrix();
@@ -803,6 +931,9 @@ bool GraphicsManager::renderWorld() {
 	if (QueueMan.isQueueEmpty(kQueueVisibleWorldObject))
 		return false;
 
+	const uint64 start    = SDL_GetPerformanceCounter();
+	const double textures = _frameTime.textures;
+
 	float cPos[3];
 	float cOrient[3];
 
@@ -827,30 +958,38 @@ bool GraphicsManager::renderWorld() {
 	// Apply camera position
 	glTranslatef(-cPos[0], -cPos[1], cPos[2]);
 
+	// Mirror the camera transformation, to find out what's visible
+	Common::TransformationMatrix modelView;
+
+	modelView.rotate(-cOrient[0], 1.0, 0.0, 0.0);
+	modelView.rotate( cOrient[1], 0.0, 1.0, 0.0);
+	modelView.rotate(-cOrient[2], 0.0, 0.0, 1.0);
+
+	modelView.translate(-cPos[0], -cPos[1], cPos[2]);
+
+	const float eye[3] = { cPos[0], cPos[1], -cPos[2] };
+	_frustum.set(_projection, modelView, eye);
+
 	QueueMan.lockQueue(kQueueVisibleWorldObject);
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
+	const std::vector<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
 
 	buildNewTextures();
 
-	// Get the current time
-	uint32 now = EventMan.getTimestamp();
-	if (_lastSampled == 0)
-		_lastSampled = now;
-
-	// Calc elapsed time
-	float elapsedTime = (now - _lastSampled) / 1000.0f;
-	_lastSampled = now;
+	float elapsedTime = getElapsedTime();
 
 	// If game paused, skip the advanceTime loop below
 
-	// Advance time for animation queues
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
-		static_cast<Renderable *>(*o)->advanceTime(elapsedTime);
-	}
+	const uint64 animationStart = SDL_GetPerformanceCounter();
+
+	// Advance time for animation queues. Each object only animates its own
+	// nodes, so we can spread the objects over all animation threads.
+	AdvanceTimeJobs advanceTime(objects, elapsedTime);
+	_animationThreads->run(advanceTime, advanceTime.getCount());
+
+	_frameTime.animation = getElapsedMS(animationStart);
 
 	// Draw opaque objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
+	for (std::vector<Queueable *>::const_reverse_iterator o = objects.rbegin();
 	     o != objects.rend(); ++o) {
 
 		glPushMatrix();
@@ -859,7 +998,7 @@ bool GraphicsManager::renderWorld() {
 	}
 
 	// Draw transparent objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
+	for (std::vector<Queueable *>::const_reverse_iterator o = objects.rbegin();
 	     o != objects.rend(); ++o) {
 
 		glPushMatrix();
@@ -868,6 +1007,8 @@ bool GraphicsManager::renderWorld() {
 	}
 
 	QueueMan.unlockQueue(kQueueVisibleWorldObject);
+
+	_frameTime.world = getElapsedMS(start) - _frameTime.animation - (_frameTime.textures - textures);
 	return true;
 }
 
@@ -884,21 +1025,40 @@ bool GraphicsManager::renderGUIFront() {
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 
+	const uint64 start    = SDL_GetPerformanceCounter();
+	const double textures = _frameTime.textures;
+
 	QueueMan.lockQueue(kQueueVisibleGUIFrontObject);
-	const std::list<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
+	const std::vector<Queueable *> &gui = QueueMan.getQueue(kQueueVisibleGUIFrontObject);
 
 	buildNewTextures();
 
-	for (std::list<Queueable *>::const_reverse_iterator g = gui.rbegin();
+	// Collect as many elements as possible into the draw list. Elements that
+	// need to be rendered directly get the elements before them drawn first,
+	// so that the drawing order stays the same.
+	for (std::vector<Queueable *>::const_reverse_iterator g = gui.rbegin();
 	     g != gui.rend(); ++g) {
 
+		GUIFrontElement *element = static_cast<GUIFrontElement *>(*g);
+		if (element->addToDrawList(*_guiDrawList))
+			continue;
+
+		_guiDrawList->flush();
+
 		glPushMatrix();
-		static_cast<Renderable *>(*g)->render(kRenderPassAll);
+		element->render(kRenderPassAll);
 		glPopMatrix();
 	}
 
+	_guiDrawList->flush();
+
+	// Keep the vertices, so that next frame only uploads what changed
+	_guiDrawList->clear();
+
 	QueueMan.unlockQueue(kQueueVisibleGUIFrontObject);
 
+	_frameTime.gui = getElapsedMS(start) - (_frameTime.textures - textures);
+
 	glEnable(GL_DEPTH_TEST);
 	return true;
 }
@@ -945,18 +1105,35 @@ void GraphicsManager::renderScene() {
 	if (_frameLock > 0)
 		return;
 
+	Common::StackLock benchmarkLock(_benchmarkMutex);
+
+	const uint64 start = SDL_GetPerformanceCounter();
+
+	_frameTime.clear();
+	if (_benchmark)
+		_benchmarkStep = _benchmark->beginFrame();
+
 	beginScene();
 
-	if (playVideo()) {
-		endScene();
-		return;
-	}
+	buildNewGLContainers();
 
-	renderWorld();
-	renderGUIFront();
-	renderCursor();
+	if (!playVideo()) {
+		renderWorld();
+		renderGUIFront();
+		renderCursor();
+	}
 
 	endScene();
+
+	_frameTime.frame = getElapsedMS(start);
+	if (_benchmark)
+		_benchmark->endFrame(_frameTime);
+}
+
+void GraphicsManager::setBenchmark(Benchmark *benchmark) {
+	Common::StackLock benchmarkLock(_benchmarkMutex);
+
+	_benchmark = benchmark;
 }
 
 int GraphicsManager::getScreenWidth() const {
@@ -998,8 +1175,8 @@ bool GraphicsManager::isFullScreen() const {
 void GraphicsManager::rebuildGLContainers() {
 	QueueMan.lockQueue(kQueueGLContainer);
 
-	const std::list<Queueable *> &cont = QueueMan.getQueue(kQueueGLContainer);
-	for (std::list<Queueable *>::const_iterator c = cont.begin(); c != cont.end(); ++c)
+	const std::vector<Queueable *> &cont = QueueMan.getQueue(kQueueGLContainer);
+	for (std::vector<Queueable *>::const_iterator c = cont.begin(); c != cont.end(); ++c)
 		static_cast<GLContainer *>(*c)->rebuild();
 
 	QueueMan.unlockQueue(kQueueGLContainer);
@@ -1008,8 +1185,8 @@ void GraphicsManager::rebuildGLContainers() {
 void GraphicsManager::destroyGLContainers() {
 	QueueMan.lockQueue(kQueueGLContainer);
 
-	const std::list<Queueable *> &cont = QueueMan.getQueue(kQueueGLContainer);
-	for (std::list<Queueable *>::const_iterator c = cont.begin(); c != cont.end(); ++c)
+	const std::vector<Queueable *> &cont = QueueMan.getQueue(kQueueGLContainer);
+	for (std::vector<Queueable *>::const_iterator c = cont.begin(); c != cont.end(); ++c)
 		static_cast<GLContainer *>(*c)->destroy();
 
 	QueueMan.unlockQueue(kQueueGLContainer);
@@ -1019,6 +1196,8 @@ void GraphicsManager::destroyContext() {
 	// Destroying all GL containers, since we need to
 	// reload/rebuild them anyway when the context is recreated
 	destroyGLContainers();
+
+	_guiDrawList->destroyGL();
 }
 
 void GraphicsManager::rebuildContext() {
@@ -1060,8 +1239,12 @@ void GraphicsManager::cleanupAbandoned() {
 	for (std::list<ListID>::iterator l = _abandonLists.begin(); l != _abandonLists.end(); ++l)
 		glDeleteLists(*l, 1);
 
+	if (!_abandonBuffers.empty())
+		glDeleteBuffers(_abandonBuffers.size(), &_abandonBuffers[0]);
+
 	_abandonTextures.clear();
 	_abandonLists.clear();
+	_abandonBuffers.clear();
 
 	_hasAbandoned = false;
 }
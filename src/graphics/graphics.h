@@ -34,6 +34,8 @@
 #include <list>
 
 #include "graphics/types.h"
+#include "graphics/frustum.h"
+#include "graphics/benchmark.h"
 
 #include "common/types.h"
 #include "common/singleton.h"
@@ -42,6 +44,7 @@
 
 namespace Common {
 	class UString;
+	class ThreadPool;
 }
 
 namespace Graphics {
@@ -49,6 +52,7 @@ namespace Graphics {
 class FPSCounter;
 class Cursor;
 class Renderable;
+class GUIDrawList;
 
 /** The graphics manager. */
 class GraphicsManager : public Common::Singleton<GraphicsManager> {
@@ -68,6 +72,8 @@ public:
 	bool needManualDeS3TC() const;
 	/** Do we have support for multiple textures? */
 	bool supportMultipleTextures() const;
+	/** Do we have support for vertex buffer objects? */
+	bool supportVertexBuffers() const;
 
 	/** Set the screen size. */
 	void setScreenSize(int width, int height);
@@ -133,6 +139,9 @@ public:
 	/** Get the object at this screen position. */
 	Renderable *getObjectAt(float x, float y);
 
+	/** Return the view frustum of the world objects rendered in the current frame. */
+	const Frustum &getFrustum() const;
+
 	/** Recalculate all object distances to the camera and resort the objebts. */
 	void recalculateObjectDistances();
 
@@ -148,11 +157,16 @@ public:
 	void abandon(TextureID *ids, uint32 count);
 	/** Abandon these lists. */
 	void abandon(ListID ids, uint32 count);
+	/** Abandon these buffer objects. */
+	void abandonBuffers(BufferID *ids, uint32 count);
 
 
 	/** Render one complete frame of the scene. */
 	void renderScene();
 
+	/** Measure the rendered frames with this benchmark, or stop measuring if 0. */
+	void setBenchmark(Benchmark *benchmark);
+
 
 private:
 	enum CursorState {
@@ -166,8 +180,10 @@ private:
 	// Extensions
 	bool _needManualDeS3TC;        ///< Do we need to do manual S3TC DXTn decompression?
 	bool _supportMultipleTextures; ///< Do we have support for multiple textures?
+	bool _supportVertexBuffers;    ///< Do we have support for vertex buffer objects?
 
 	bool _fullScreen; ///< Are we currently in fullscreen mode?
+	bool _headless;   ///< Are we rendering into a hidden window?
 
 	int _fsaa;    ///< Current FSAA settings.
 	int _fsaaMax; ///< Max supported FSAA level.
@@ -181,10 +197,14 @@ private:
 	SDL_GLContext _glContext;
 
 	FPSCounter *_fpsCounter; ///< Counts the current frames per seconds value.
+	GUIDrawList *_guiDrawList; ///< Collects the quads of GUI elements for drawing.
+	Common::ThreadPool *_animationThreads; ///< Advances the animations of world objects.
 	uint32 _lastSampled; ///< Timestamp used to advance animations.
 	Common::Matrix _projection;    ///< Our projection matrix.
 	Common::Matrix _projectionInv; ///< The inverse of our projection matrix.
 
+	Frustum _frustum; ///< The view frustum, for culling invisible world objects.
+
 	uint32 _frameLock;
 
 	Common::Mutex _frameLockMutex; ///< A soft mutex locked for each frame.
@@ -202,9 +222,15 @@ private:
 
 	std::vector<TextureID> _abandonTextures; ///< Abandoned textures.
 	std::list<ListID>      _abandonLists;    ///< Abandoned lists.
+	std::vector<BufferID>  _abandonBuffers;  ///< Abandoned buffer objects.
 
 	Common::Mutex _abandonMutex; ///< A mutex protecting abandoned structures.
 
+	Benchmark    *_benchmark;      ///< The benchmark measuring our frames.
+	float         _benchmarkStep;  ///< The benchmark's animation time step for the current frame.
+	FrameTime     _frameTime;      ///< The time spent on the parts of the current frame.
+	Common::Mutex _benchmarkMutex; ///< A mutex protecting the benchmark.
+
 	void initSize(int width, int height, bool fullscreen);
 	void setupScene();
 
@@ -230,6 +256,9 @@ private:
 	Renderable *getWorldObjectAt(float x, float y) const;
 
 	void buildNewTextures();
+	void buildNewGLContainers();
+
+	float getElapsedTime();
 
 	void beginScene();
 	bool playVideo();
@@ -0,0 +1,216 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/guidrawlist.cpp
+ *  A list of textured quads, for drawing many GUI elements at once.
+ */
+
+#include <cstddef>
+#include <cstring>
+
+#include "common/util.h"
+
+#include "graphics/guidrawlist.h"
+#include "graphics/texture.h"
+#include "graphics/graphics.h"
+
+namespace Graphics {
+
+GUIDrawList::GUIDrawList() : _count(0), _dirtyStart(0), _dirtyEnd(0), _vbo(0), _vboSize(0) {
+}
+
+GUIDrawList::~GUIDrawList() {
+	if (_vbo)
+		GfxMan.abandonBuffers(&_vbo, 1);
+}
+
+bool GUIDrawList::empty() const {
+	return _batches.empty();
+}
+
+void GUIDrawList::clear() {
+	_batches.clear();
+
+	_count = 0;
+}
+
+void GUIDrawList::reserve(uint32 quadCount) {
+	const size_t needed = _count + 4 * quadCount;
+	if (needed <= _vertices.capacity())
+		return;
+
+	// Grow geometrically, so that many small reservations don't copy over and over
+	_vertices.reserve(MAX<size_t>(needed, 2 * _vertices.capacity()));
+}
+
+GUIDrawList::Batch &GUIDrawList::getBatch(const Texture *texture) {
+	if (_batches.empty() || (_batches.back().texture != texture)) {
+		Batch batch;
+
+		batch.texture = texture;
+		batch.start   = _count;
+		batch.count   = 0;
+
+		_batches.push_back(batch);
+	}
+
+	return _batches.back();
+}
+
+void GUIDrawList::addQuad(const Texture *texture, const float *vX, const float *vY,
+                          const float *tX, const float *tY, float r, float g, float b, float a) {
+
+	getBatch(texture).count += 4;
+
+	for (int i = 0; i < 4; i++) {
+		Vertex vertex;
+
+		vertex.x = vX[i];
+		vertex.y = vY[i];
+		vertex.u = tX[i];
+		vertex.v = tY[i];
+		vertex.r = r;
+		vertex.g = g;
+		vertex.b = b;
+		vertex.a = a;
+
+		addVertex(vertex);
+	}
+}
+
+void GUIDrawList::add(const GUIDrawList &list, float x, float y) {
+	reserve(list._count / 4);
+
+	for (std::vector<Batch>::const_iterator b = list._batches.begin(); b != list._batches.end(); ++b) {
+		getBatch(b->texture).count += b->count;
+
+		for (uint32 i = 0; i < b->count; i++) {
+			Vertex vertex = list._vertices[b->start + i];
+
+			vertex.x += x;
+			vertex.y += y;
+
+			addVertex(vertex);
+		}
+	}
+}
+
+void GUIDrawList::addVertex(const Vertex &vertex) {
+	if (_count < _vertices.size()) {
+		// Most GUI elements stay the same from one frame to the next
+		Vertex &old = _vertices[_count];
+		if (!memcmp(&old, &vertex, sizeof(Vertex))) {
+			_count++;
+			return;
+		}
+
+		old = vertex;
+	} else
+		_vertices.push_back(vertex);
+
+	if (_dirtyStart >= _dirtyEnd) {
+		_dirtyStart = _count;
+		_dirtyEnd   = _count + 1;
+	} else {
+		_dirtyStart = MIN(_dirtyStart, _count);
+		_dirtyEnd   = MAX(_dirtyEnd  , _count + 1);
+	}
+
+	_count++;
+}
+
+void GUIDrawList::upload() {
+	if (!_vbo) {
+		glGenBuffers(1, &_vbo);
+		_vboSize = 0;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+	if (_vboSize < _vertices.size()) {
+		// Too small, specify the buffer anew with room to grow
+		_vboSize = _vertices.capacity();
+
+		glBufferData(GL_ARRAY_BUFFER, _vboSize * sizeof(Vertex), 0, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, _vertices.size() * sizeof(Vertex), &_vertices[0]);
+
+	} else if (_dirtyStart < _dirtyEnd)
+		glBufferSubData(GL_ARRAY_BUFFER, _dirtyStart * sizeof(Vertex),
+		                (_dirtyEnd - _dirtyStart) * sizeof(Vertex), &_vertices[_dirtyStart]);
+
+	_dirtyStart = 0;
+	_dirtyEnd   = 0;
+}
+
+void GUIDrawList::destroyGL() {
+	if (!_vbo)
+		return;
+
+	glDeleteBuffers(1, &_vbo);
+
+	_vbo     = 0;
+	_vboSize = 0;
+}
+
+void GUIDrawList::flush() {
+	if (_batches.empty())
+		return;
+
+	const GLsizei stride = sizeof(Vertex);
+
+	// With a bound buffer object, the pointers are offsets into the buffer
+	const byte *data = (const byte *) &_vertices[0];
+	if (GfxMan.supportVertexBuffers()) {
+		upload();
+		data = 0;
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	glVertexPointer  (2, GL_FLOAT, stride, data + offsetof(Vertex, x));
+	glTexCoordPointer(2, GL_FLOAT, stride, data + offsetof(Vertex, u));
+	glColorPointer   (4, GL_FLOAT, stride, data + offsetof(Vertex, r));
+
+	for (std::vector<Batch>::const_iterator b = _batches.begin(); b != _batches.end(); ++b) {
+		glBindTexture(GL_TEXTURE_2D, b->texture ? b->texture->getID() : 0);
+
+		glDrawArrays(GL_QUADS, b->start, b->count);
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	if (_vbo)
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glColor4f(1.0, 1.0, 1.0, 1.0);
+
+	_batches.clear();
+}
+
+} // End of namespace Graphics
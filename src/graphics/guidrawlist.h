@@ -0,0 +1,127 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/guidrawlist.h
+ *  A list of textured quads, for drawing many GUI elements at once.
+ */
+
+#ifndef GRAPHICS_GUIDRAWLIST_H
+#define GRAPHICS_GUIDRAWLIST_H
+
+#include <vector>
+
+#include "graphics/types.h"
+
+namespace Graphics {
+
+class Texture;
+
+/** A list of textured, colored quads.
+ *
+ *  Instead of drawing each quad immediately, GUI elements add them to a draw
+ *  list. When the list is drawn, consecutive quads using the same texture are
+ *  drawn together, with one call each, in the order they were added.
+ *
+ *  The vertices are kept after they are drawn. If the list is filled the same
+ *  way again, only the vertices that changed are uploaded into the list's
+ *  vertex buffer object.
+ */
+class GUIDrawList {
+public:
+	GUIDrawList();
+	~GUIDrawList();
+
+	/** Is the list empty? */
+	bool empty() const;
+
+	/** Remove all quads from the list, keeping the memory for the next ones. */
+	void clear();
+
+	/** Make room for this many more quads. */
+	void reserve(uint32 quadCount);
+
+	/** Add a quad.
+	 *
+	 *  @param texture The quad's texture, or 0 for an untextured quad.
+	 *  @param vX The x coordinates of the quad's 4 vertices.
+	 *  @param vY The y coordinates of the quad's 4 vertices.
+	 *  @param tX The x texture coordinates of the quad's 4 vertices.
+	 *  @param tY The y texture coordinates of the quad's 4 vertices.
+	 */
+	void addQuad(const Texture *texture, const float *vX, const float *vY,
+	             const float *tX, const float *tY, float r, float g, float b, float a);
+
+	/** Add all the quads of another list, moved by x and y. */
+	void add(const GUIDrawList &list, float x, float y);
+
+	/** Draw the quads added since the last flush.
+	 *
+	 *  The drawn quads stay in the list until clear() is called, so that
+	 *  unchanged vertices don't need to be uploaded again.
+	 */
+	void flush();
+
+	/** Delete the vertex buffer object. It is recreated on the next flush. */
+	void destroyGL();
+
+private:
+	/** A vertex of a quad. */
+	struct Vertex {
+		float x, y;
+		float u, v;
+		float r, g, b, a;
+	};
+
+	/** A run of consecutive quads using the same texture. */
+	struct Batch {
+		const Texture *texture;
+
+		uint32 start; ///< Index of the first vertex.
+		uint32 count; ///< Number of vertices.
+	};
+
+	std::vector<Vertex> _vertices; ///< All vertices, including unused ones from earlier.
+	std::vector<Batch>  _batches;  ///< The batches that still need to be drawn.
+
+	uint32 _count; ///< Number of used vertices.
+
+	/** The range of vertices that changed since the last upload. */
+	uint32 _dirtyStart, _dirtyEnd;
+
+	BufferID _vbo;     ///< The vertex buffer object, if we have one.
+	uint32   _vboSize; ///< Number of vertices the vertex buffer object can hold.
+
+	Batch &getBatch(const Texture *texture);
+
+	/** Add a vertex, only marking it as changed if it's different from the old one. */
+	void addVertex(const Vertex &vertex);
+
+	/** Upload the changed vertices into the vertex buffer object and bind it. */
+	void upload();
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_GUIDRAWLIST_H
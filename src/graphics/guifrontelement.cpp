@@ -38,4 +38,8 @@ GUIFrontElement::GUIFrontElement() : Renderable(kRenderableTypeGUIFront) {
 GUIFrontElement::~GUIFrontElement() {
 }
 
+bool GUIFrontElement::addToDrawList(GUIDrawList &list) {
+	return false;
+}
+
 } // End of namespace Graphics
@@ -34,11 +34,19 @@
 
 namespace Graphics {
 
+class GUIDrawList;
+
 /** An element of the front GUI. */
 class GUIFrontElement : public Renderable {
 public:
 	GUIFrontElement();
 	~GUIFrontElement();
+
+	/** Add the element to a draw list, instead of rendering it directly.
+	 *
+	 *  @return false if the element can't be drawn that way and needs to be rendered.
+	 */
+	virtual bool addToDrawList(GUIDrawList &list);
 };
 
 } // End of namespace Graphics
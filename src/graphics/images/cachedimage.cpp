@@ -0,0 +1,163 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/images/cachedimage.cpp
+ *  Ready-to-upload image data, as stored in the on-disk texture cache.
+ */
+
+#include "common/util.h"
+#include "common/error.h"
+#include "common/stream.h"
+
+#include "graphics/images/cachedimage.h"
+
+static const uint32 kCacheID = MKTAG('X', 'T', 'E', 'X');
+
+namespace Graphics {
+
+CachedImage::CachedImage(Common::SeekableReadStream &cache, uint64 hash) : _txiData(0), _txiDataSize(0) {
+	load(cache, hash);
+}
+
+CachedImage::~CachedImage() {
+	delete[] _txiData;
+}
+
+Common::SeekableReadStream *CachedImage::getTXI() const {
+	if (!_txiData || (_txiDataSize == 0))
+		return 0;
+
+	return new Common::MemoryReadStream(_txiData, _txiDataSize);
+}
+
+void CachedImage::load(Common::SeekableReadStream &cache, uint64 hash) {
+	try {
+
+		// Read the whole file in one go, and then take it apart in memory
+		const uint32 size = cache.size();
+		if (size < 44)
+			throw Common::Exception("File too small");
+
+		byte *data = new byte[size];
+		Common::MemoryReadStream stream(data, size, true);
+
+		if (!cache.seek(0) || (cache.read(data, size) != size))
+			throw Common::Exception(Common::kReadError);
+
+		if (stream.readUint32BE() != kCacheID)
+			throw Common::Exception("Not a texture cache file");
+
+		const uint32 version = stream.readUint32LE();
+		if (version != kVersion)
+			throw Common::Exception("Unsupported texture cache version %d", version);
+
+		if (stream.readUint64LE() != hash)
+			throw Common::Exception("Texture cache hash mismatch");
+
+		_compressed = stream.readUint32LE() != 0;
+		_hasAlpha   = stream.readUint32LE() != 0;
+
+		_format    = (PixelFormat)    stream.readUint32LE();
+		_formatRaw = (PixelFormatRaw) stream.readUint32LE();
+		_dataType  = (PixelDataType)  stream.readUint32LE();
+
+		const uint32 mipMapCount = stream.readUint32LE();
+		_txiDataSize             = stream.readUint32LE();
+
+		_mipMaps.reserve(mipMapCount);
+		for (uint32 i = 0; i < mipMapCount; i++) {
+			MipMap *mipMap = new MipMap;
+			_mipMaps.push_back(mipMap);
+
+			mipMap->width  = stream.readUint32LE();
+			mipMap->height = stream.readUint32LE();
+			mipMap->size   = stream.readUint32LE();
+
+			if ((uint32) (stream.size() - stream.pos()) < mipMap->size)
+				throw Common::Exception(Common::kReadError);
+
+			mipMap->data = new byte[mipMap->size];
+			stream.read(mipMap->data, mipMap->size);
+		}
+
+		if (_txiDataSize > 0) {
+			if ((uint32) (stream.size() - stream.pos()) < _txiDataSize)
+				throw Common::Exception(Common::kReadError);
+
+			_txiData = new byte[_txiDataSize];
+			stream.read(_txiData, _txiDataSize);
+		}
+
+		if (stream.err() || _mipMaps.empty())
+			throw Common::Exception(Common::kReadError);
+
+	} catch (Common::Exception &e) {
+		// The destructor won't run when we throw out of the constructor
+		delete[] _txiData;
+
+		_txiData     = 0;
+		_txiDataSize = 0;
+
+		e.add("Failed reading cached texture");
+		throw;
+	}
+}
+
+void CachedImage::write(Common::WriteStream &cache, const ImageDecoder &image, uint64 hash) {
+	Common::SeekableReadStream *txi = image.getTXI();
+
+	cache.writeUint32BE(kCacheID);
+	cache.writeUint32LE(kVersion);
+	cache.writeUint64LE(hash);
+
+	cache.writeUint32LE(image.isCompressed() ? 1 : 0);
+	cache.writeUint32LE(image.hasAlpha()     ? 1 : 0);
+
+	cache.writeUint32LE((uint32) image.getFormat());
+	cache.writeUint32LE((uint32) image.getFormatRaw());
+	cache.writeUint32LE((uint32) image.getDataType());
+
+	cache.writeUint32LE(image.getMipMapCount());
+	cache.writeUint32LE(txi ? txi->size() : 0);
+
+	for (uint32 i = 0; i < image.getMipMapCount(); i++) {
+		const MipMap &mipMap = image.getMipMap(i);
+
+		cache.writeUint32LE(mipMap.width);
+		cache.writeUint32LE(mipMap.height);
+		cache.writeUint32LE(mipMap.size);
+
+		cache.write(mipMap.data, mipMap.size);
+	}
+
+	if (txi) {
+		txi->seek(0);
+		cache.writeStream(*txi);
+	}
+
+	delete txi;
+}
+
+} // End of namespace Graphics
@@ -0,0 +1,76 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file graphics/images/cachedimage.h
+ *  Ready-to-upload image data, as stored in the on-disk texture cache.
+ */
+
+#ifndef GRAPHICS_IMAGES_CACHEDIMAGE_H
+#define GRAPHICS_IMAGES_CACHEDIMAGE_H
+
+#include "graphics/images/decoder.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Graphics {
+
+/** An image restored from the texture cache.
+ *
+ *  The cache holds the image data exactly as it is going to be uploaded to
+ *  OpenGL, i.e. after any manual decompression and mip map generation, so
+ *  reading it back needs no decoding at all.
+ */
+class CachedImage : public ImageDecoder {
+public:
+	/** Read the cached image, checking that it was created for this source hash. */
+	CachedImage(Common::SeekableReadStream &cache, uint64 hash);
+	~CachedImage();
+
+	/** Return the enclosed TXI data. */
+	Common::SeekableReadStream *getTXI() const;
+
+	/** Write an image into the texture cache format. */
+	static void write(Common::WriteStream &cache, const ImageDecoder &image, uint64 hash);
+
+	/** The version of the cache format and the decoders filling it.
+	 *
+	 *  Needs to be bumped whenever an image decoder changes its output,
+	 *  so that stale cache entries get discarded.
+	 */
+	static const uint32 kVersion = 1;
+
+private:
+	byte  *_txiData;
+	uint32 _txiDataSize;
+
+	void load(Common::SeekableReadStream &cache, uint64 hash);
+};
+
+} // End of namespace Graphics
+
+#endif // GRAPHICS_IMAGES_CACHEDIMAGE_H
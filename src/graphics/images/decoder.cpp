@@ -27,6 +27,8 @@
  *  Generic image decoder interface.
  */
 
+#include <cmath>
+
 #include "common/util.h"
 #include "common/error.h"
 #include "common/stream.h"
@@ -39,6 +41,28 @@
 
 namespace Graphics {
 
+/** Gamma-encoded 8-bit value -> 12-bit linear value. */
+static uint16 kGammaToLinear[256];
+/** 12-bit linear value -> gamma-encoded 8-bit value. */
+static byte   kLinearToGamma[4096];
+
+/** Fills the gamma tables at startup.
+ *
+ *  Images are decoded on worker threads, so the tables must not be
+ *  created lazily on first use.
+ */
+static struct GammaTables {
+	GammaTables() {
+		// Plain 2.2 power curve, close enough to sRGB for our purposes
+
+		for (int i = 0; i < 256; i++)
+			kGammaToLinear[i] = (uint16) floor(pow(i / 255.0, 2.2) * 4095.0 + 0.5);
+
+		for (int i = 0; i < 4096; i++)
+			kLinearToGamma[i] = (byte) floor(pow(i / 4095.0, 1.0 / 2.2) * 255.0 + 0.5);
+	}
+} gammaTables;
+
 ImageDecoder::MipMap::MipMap() : width(0), height(0), size(0), data(0) {
 }
 
@@ -139,6 +163,73 @@ void ImageDecoder::decompress() {
 	_compressed = false;
 }
 
+void ImageDecoder::scaleDown(MipMap &out, const MipMap &in, int bpp, bool gammaCorrect) {
+	out.width  = MAX(in.width  / 2, 1);
+	out.height = MAX(in.height / 2, 1);
+	out.size   = out.width * out.height * bpp;
+	out.data   = new byte[out.size];
+
+	const int inPitch = in.width * bpp;
+
+	// Odd or 1-pixel dimensions just sample the last row/column twice
+	const int nextRow = (in.height > 1) ? inPitch : 0;
+	const int nextCol = (in.width  > 1) ? bpp     : 0;
+
+	byte *dst = out.data;
+	for (int y = 0; y < out.height; y++) {
+		const byte *src0 = in.data + (y * 2) * inPitch;
+		const byte *src1 = src0 + nextRow;
+
+		if (!gammaCorrect || (bpp < 3)) {
+			// Straight 2x2 box filter. Simple enough for the compiler to vectorize
+
+			for (int x = 0; x < out.width; x++, src0 += 2 * bpp, src1 += 2 * bpp)
+				for (int c = 0; c < bpp; c++)
+					*dst++ = (src0[c] + src0[c + nextCol] + src1[c] + src1[c + nextCol] + 2) >> 2;
+
+			continue;
+		}
+
+		// Gamma-aware box filter, average the color channels in linear space
+
+		for (int x = 0; x < out.width; x++, src0 += 2 * bpp, src1 += 2 * bpp) {
+			for (int c = 0; c < 3; c++) {
+				const uint32 sum = kGammaToLinear[src0[c]] + kGammaToLinear[src0[c + nextCol]] +
+				                   kGammaToLinear[src1[c]] + kGammaToLinear[src1[c + nextCol]];
+
+				*dst++ = kLinearToGamma[(sum + 2) >> 2];
+			}
+
+			// Alpha is linear already
+			if (bpp == 4)
+				*dst++ = (src0[3] + src0[3 + nextCol] + src1[3] + src1[3 + nextCol] + 2) >> 2;
+		}
+	}
+}
+
+void ImageDecoder::generateMipMaps(bool gammaCorrect) {
+	if (_compressed || (_dataType != kPixelDataType8) || (_mipMaps.size() != 1))
+		return;
+
+	int bpp = 0;
+	if      ((_format == kPixelFormatRGB ) || (_format == kPixelFormatBGR ))
+		bpp = 3;
+	else if ((_format == kPixelFormatRGBA) || (_format == kPixelFormatBGRA))
+		bpp = 4;
+
+	const MipMap *base = _mipMaps[0];
+	if ((bpp == 0) || !base->data || (base->size < (uint32) (base->width * base->height * bpp)))
+		return;
+
+	while ((_mipMaps.back()->width > 1) || (_mipMaps.back()->height > 1)) {
+		MipMap *mipMap = new MipMap;
+
+		scaleDown(*mipMap, *_mipMaps.back(), bpp, gammaCorrect);
+
+		_mipMaps.push_back(mipMap);
+	}
+}
+
 bool ImageDecoder::dumpTGA(const Common::UString &fileName) const {
 	if (_mipMaps.size() < 1)
 		return false;
@@ -84,6 +84,16 @@ public:
 	/** Manually decompress the texture image data. */
 	void decompress();
 
+	/** Generate a full mip map chain out of the base image.
+	 *
+	 *  This only works on uncompressed images with 8 bits per color channel,
+	 *  and only if the image does not already contain mip maps of its own.
+	 *
+	 *  @param gammaCorrect Average the color channels in linear space instead
+	 *                      of directly on the (gamma-encoded) image values.
+	 */
+	void generateMipMaps(bool gammaCorrect = false);
+
 	/** Return TXI data, if embedded in the image. */
 	virtual Common::SeekableReadStream *getTXI() const;
 
@@ -101,6 +111,9 @@ protected:
 	std::vector<MipMap *> _mipMaps;
 
 	static void decompress(MipMap &out, const MipMap &in, PixelFormatRaw format);
+
+	/** Box-filter a mip map down to the next smaller mip map level. */
+	static void scaleDown(MipMap &out, const MipMap &in, int bpp, bool gammaCorrect);
 };
 
 } // End of namespace Graphics
@@ -29,6 +29,8 @@
  *  Decoding TGA (TarGa) images.
  */
 
+#include <vector>
+
 #include "common/util.h"
 #include "common/stream.h"
 #include "common/error.h"
@@ -158,16 +160,20 @@ void TGA::readData(Common::SeekableReadStream &tga, ImageType imageType, byte pi
 		_mipMaps[0]->size = _mipMaps[0]->width * _mipMaps[0]->height * 4;
 		_mipMaps[0]->data = new byte[_mipMaps[0]->size];
 
-		byte  *data  = _mipMaps[0]->data;
-		uint32 count = _mipMaps[0]->width * _mipMaps[0]->height;
+		const uint32 count = _mipMaps[0]->width * _mipMaps[0]->height;
 
-		while (count-- > 0) {
-			byte g = tga.readByte();
+		// Read the grayscale values into the back of the image, then expand in place
+		byte *data = _mipMaps[0]->data;
+		byte *gray = data + 3 * count;
 
-			memset(data, g, 3);
-			data[3] = 0xFF;
+		if (tga.read(gray, count) != count)
+			throw Common::Exception(Common::kReadError);
 
-			data += 4;
+		for (uint32 i = 0; i < count; i++, data += 4) {
+			const byte g = gray[i];
+
+			data[0] = data[1] = data[2] = g;
+			data[3] = 0xFF;
 		}
 
 	}
@@ -181,47 +187,60 @@ void TGA::readRLE(Common::SeekableReadStream &tga, byte pixelDepth) {
 	if (pixelDepth != 24 && pixelDepth != 32)
 		throw Common::Exception("Unhandled RLE depth %d", pixelDepth);
 
-	byte  *data  = _mipMaps[0]->data;
-	uint32 count = _mipMaps[0]->width * _mipMaps[0]->height;
+	const uint32 bpp = pixelDepth / 8;
+
+	// Read all the remaining RLE data in one go and decode it from memory
+	const uint32 rleSize = tga.size() - tga.pos();
+	if (rleSize == 0)
+		throw Common::Exception(Common::kReadError);
+
+	std::vector<byte> rle(rleSize);
+	if (tga.read(&rle[0], rleSize) != rleSize)
+		throw Common::Exception(Common::kReadError);
+
+	const byte *src    = &rle[0];
+	const byte *srcEnd = src + rleSize;
+
+	byte *data    = _mipMaps[0]->data;
+	byte *dataEnd = data + _mipMaps[0]->width * _mipMaps[0]->height * bpp;
+
+	while (data < dataEnd) {
+		if (src >= srcEnd)
+			throw Common::Exception(Common::kReadError);
+
+		const byte code = *src++;
 
-	while (count > 0) {
-		byte code = tga.readByte();
-		byte length = (code & 0x7F) + 1;
-		count -= length;
+		const uint32 length = MIN<uint32>((code & 0x7F) + 1, (dataEnd - data) / bpp);
+		const uint32 size   = length * bpp;
 
 		if (code & 0x80) {
-			if (pixelDepth == 32) {
-				uint32 color = tga.readUint32BE();
+			// Run of one repeated pixel
 
-				while (length--) {
-					WRITE_BE_UINT32(data, color);
-					data += 4;
-				}
-			} else if (pixelDepth == 24) {
-				byte b = tga.readByte();
-				byte g = tga.readByte();
-				byte r = tga.readByte();
-
-				while (length--) {
-					*data++ = b;
-					*data++ = g;
-					*data++ = r;
-				}
+			if ((uint32)(srcEnd - src) < bpp)
+				throw Common::Exception(Common::kReadError);
+
+			memcpy(data, src, bpp);
+			src += bpp;
+
+			// Expand the run by doubling the already written part
+			for (uint32 written = bpp; written < size; ) {
+				const uint32 n = MIN(written, size - written);
+
+				memcpy(data + written, data, n);
+				written += n;
 			}
+
 		} else {
-			if (pixelDepth == 32) {
-				while (length--) {
-					WRITE_BE_UINT32(data, tga.readUint32BE());
-					data += 4;
-				}
-			} else if (pixelDepth == 24) {
-				while (length--) {
-					*data++ = tga.readByte();
-					*data++ = tga.readByte();
-					*data++ = tga.readByte();
-				}
-			}
+			// Run of raw pixels
+
+			if ((uint32)(srcEnd - src) < size)
+				throw Common::Exception(Common::kReadError);
+
+			memcpy(data, src, size);
+			src += size;
 		}
+
+		data += size;
 	}
 }
 
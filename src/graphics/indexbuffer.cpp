@@ -31,18 +31,21 @@
 #include <cstring>
 
 #include "graphics/indexbuffer.h"
+#include "graphics/graphics.h"
 
 namespace Graphics {
 
-IndexBuffer::IndexBuffer() : _count(0), _size(0), _type(GL_UNSIGNED_INT), _data(0) {
+IndexBuffer::IndexBuffer() : _count(0), _size(0), _type(GL_UNSIGNED_INT), _data(0), _ibo(0) {
 	//ctor
 }
 
-IndexBuffer::IndexBuffer(const IndexBuffer &other) : _data(0) {
+IndexBuffer::IndexBuffer(const IndexBuffer &other) : _data(0), _ibo(0) {
 	*this = other;
 }
 
 IndexBuffer::~IndexBuffer() {
+	abandonGL();
+
 	if (_data)
 		std::free(_data);
 }
@@ -56,6 +59,8 @@ IndexBuffer &IndexBuffer::operator=(const IndexBuffer &other) {
 }
 
 void IndexBuffer::setSize(uint32 indexCount, uint32 indexSize, GLenum indexType) {
+	abandonGL();
+
 	_count = indexCount;
 	_size = indexSize;
 	_type = indexType;
@@ -85,4 +90,46 @@ GLenum IndexBuffer::getType() const {
 	return _type;
 }
 
+void IndexBuffer::initGL() {
+	if (_ibo || !_data || !GfxMan.supportVertexBuffers())
+		return;
+
+	glGenBuffers(1, &_ibo);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, _count * _size, _data, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void IndexBuffer::destroyGL() {
+	if (!_ibo)
+		return;
+
+	glDeleteBuffers(1, &_ibo);
+	_ibo = 0;
+}
+
+void IndexBuffer::abandonGL() {
+	if (!_ibo)
+		return;
+
+	GfxMan.abandonBuffers(&_ibo, 1);
+	_ibo = 0;
+}
+
+void IndexBuffer::bind() const {
+	if (_ibo)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+}
+
+void IndexBuffer::unbind() const {
+	if (_ibo)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+const GLvoid *IndexBuffer::getPointer() const {
+	// With a bound buffer object, the pointer is an offset into the buffer
+	return _ibo ? 0 : _data;
+}
+
 }
@@ -60,11 +60,32 @@ public:
 	/** Get element type */
 	GLenum getType() const;
 
+	/** Upload the data into an index buffer object, if supported.
+	 *
+	 *  Changes to the data after the upload are not seen by OpenGL,
+	 *  until the buffer object is destroyed and uploaded again.
+	 */
+	void initGL();
+	/** Destroy the index buffer object. */
+	void destroyGL();
+
+	/** Bind the index buffer object, if we have one. */
+	void bind() const;
+	/** Unbind the index buffer object. */
+	void unbind() const;
+
+	/** Get the pointer to pass to glDrawElements() while the buffer is bound. */
+	const GLvoid *getPointer() const;
+
 private:
 	uint32 _count; ///< Number of elements in buffer
 	uint32 _size;  ///< Size of a buffer element in bytes
 	GLenum _type;  ///< Element type (GL_UNSIGNED_SHORT, GL_UNSIGNED_INT, ...)
 	GLvoid *_data; ///< Buffer data
+	BufferID _ibo; ///< OpenGL index buffer object, or 0 if not uploaded
+
+	/** Abandon the index buffer object, because the data changed or went away. */
+	void abandonGL();
 };
 
 }
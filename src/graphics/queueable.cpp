@@ -41,15 +41,15 @@ Queueable::~Queueable() {
 	removeFromAll();
 }
 
-bool Queueable::operator<(const Queueable &q) const {
-	return false;
+double Queueable::getSortKey() const {
+	return 0.0;
 }
 
 void Queueable::addToQueue(QueueType queue) {
 	QueueMan.lockQueue(queue);
 
 	if (!_isInQueue[queue]) {
-		_queueRef[queue] = QueueMan.addToQueue(queue, *this);
+		_queueIndex[queue] = QueueMan.addToQueue(queue, *this);
 		_isInQueue[queue] = true;
 	}
 
@@ -60,7 +60,7 @@ void Queueable::removeFromQueue(QueueType queue) {
 	QueueMan.lockQueue(queue);
 
 	if (_isInQueue[queue]) {
-		QueueMan.removeFromQueue(queue, _queueRef[queue]);
+		QueueMan.removeFromQueue(queue, _queueIndex[queue]);
 		_isInQueue[queue] = false;
 	}
 
@@ -30,8 +30,6 @@
 #ifndef GRAPHICS_QUEUEABLE_H
 #define GRAPHICS_QUEUEABLE_H
 
-#include <list>
-
 #include "graphics/types.h"
 
 namespace Graphics {
@@ -41,7 +39,8 @@ public:
 	Queueable();
 	virtual ~Queueable();
 
-	virtual bool operator<(const Queueable &q) const;
+	/** The key the queue is sorted by, in ascending order. */
+	virtual double getSortKey() const;
 
 protected:
 	void addToQueue(QueueType queue);
@@ -54,7 +53,7 @@ protected:
 
 private:
 	bool _isInQueue[kQueueMAX];
-	std::list<Queueable *>::iterator _queueRef[kQueueMAX];
+	uint32 _queueIndex[kQueueMAX];
 
 	void removeFromAll();
 	void kickedOut(QueueType queue);
@@ -27,6 +27,8 @@
  *  The graphics queue manager.
  */
 
+#include <algorithm>
+
 #include "graphics/queueman.h"
 #include "graphics/queueable.h"
 
@@ -34,12 +36,19 @@ DECLARE_SINGLETON(Graphics::QueueManager)
 
 namespace Graphics {
 
-static bool queueComp(Queueable *a, Queueable *b) {
-	return *a < *b;
+/** How many element moves per element an insertion sort may do before we give up. */
+static const uint32 kMaxInsertionMoves = 8;
+
+static bool sortEntryComp(const std::pair<double, Queueable *> &a,
+                          const std::pair<double, Queueable *> &b) {
+
+	return a.first < b.first;
 }
 
 
 QueueManager::QueueManager() {
+	for (int i = 0; i < kQueueMAX; i++)
+		_needSort[i] = false;
 }
 
 QueueManager::~QueueManager() {
@@ -60,35 +69,115 @@ bool QueueManager::isQueueEmpty(QueueType queue) {
 	return _queue[queue].empty();
 }
 
-const std::list<Queueable *> &QueueManager::getQueue(QueueType queue) {
+const std::vector<Queueable *> &QueueManager::getQueue(QueueType queue) {
+	Common::StackLock lock(_queueMutex[queue]);
+
+	if (_needSort[queue])
+		sort(queue);
+
 	return _queue[queue];
 }
 
 void QueueManager::sortQueue(QueueType queue) {
 	lockQueue(queue);
 
-	_queue[queue].sort(queueComp);
+	_needSort[queue] = true;
 
 	unlockQueue(queue);
 }
 
-std::list<Queueable *>::iterator QueueManager::addToQueue(QueueType queue, Queueable &q) {
+void QueueManager::sort(QueueType queue) {
+	_needSort[queue] = false;
+
+	std::vector<Queueable *> &objects = _queue[queue];
+	std::vector<double>      &keys    = _keys [queue];
+
+	// Refresh the cached keys in one linear pass
+	for (uint32 i = 0; i < objects.size(); i++)
+		keys[i] = objects[i]->getSortKey();
+
+	// The order usually only changes slightly between sorts, so an insertion
+	// sort is fastest. If it isn't, fall back to a full sort.
+	if (!insertionSort(queue))
+		fullSort(queue);
+
+	for (uint32 i = 0; i < objects.size(); i++)
+		objects[i]->_queueIndex[queue] = i;
+}
+
+bool QueueManager::insertionSort(QueueType queue) {
+	std::vector<Queueable *> &objects = _queue[queue];
+	std::vector<double>      &keys    = _keys [queue];
+
+	uint32 moves = 0;
+	uint32 maxMoves = kMaxInsertionMoves * objects.size();
+
+	for (uint32 i = 1; i < objects.size(); i++) {
+		if (!(keys[i] < keys[i - 1]))
+			continue;
+
+		double     key    = keys[i];
+		Queueable *object = objects[i];
+
+		uint32 j = i;
+		do {
+			keys   [j] = keys   [j - 1];
+			objects[j] = objects[j - 1];
+			j--;
+		} while ((j > 0) && (key < keys[j - 1]));
+
+		keys   [j] = key;
+		objects[j] = object;
+
+		moves += i - j;
+		if (moves > maxMoves)
+			return false;
+	}
+
+	return true;
+}
+
+void QueueManager::fullSort(QueueType queue) {
+	std::vector<Queueable *> &objects = _queue[queue];
+	std::vector<double>      &keys    = _keys [queue];
+	std::vector<SortEntry>   &buffer  = _sortBuffer[queue];
+
+	buffer.resize(objects.size());
+	for (uint32 i = 0; i < objects.size(); i++)
+		buffer[i] = std::make_pair(keys[i], objects[i]);
+
+	std::stable_sort(buffer.begin(), buffer.end(), sortEntryComp);
+
+	for (uint32 i = 0; i < objects.size(); i++) {
+		keys   [i] = buffer[i].first;
+		objects[i] = buffer[i].second;
+	}
+}
+
+uint32 QueueManager::addToQueue(QueueType queue, Queueable &q) {
 	lockQueue(queue);
 
 	_queue[queue].push_back(&q);
-	std::list<Queueable *>::iterator ref = --_queue[queue].end();
+	_keys [queue].push_back(0.0);
+
+	uint32 index = _queue[queue].size() - 1;
 
 	unlockQueue(queue);
 
-	return ref;
+	return index;
 }
 
-void QueueManager::removeFromQueue(QueueType queue,
-		const std::list<Queueable *>::iterator &ref) {
-
+void QueueManager::removeFromQueue(QueueType queue, uint32 index) {
 	lockQueue(queue);
 
-	_queue[queue].erase(ref);
+	std::vector<Queueable *> &objects = _queue[queue];
+
+	objects.erase(objects.begin() + index);
+	_keys[queue].erase(_keys[queue].begin() + index);
+
+	// Keep the order intact, and move the indices of the following objects along
+	for (uint32 i = index; i < objects.size(); i++)
+		objects[i]->_queueIndex[queue] = i;
 
 	unlockQueue(queue);
 }
@@ -96,11 +185,14 @@ void QueueManager::removeFromQueue(QueueType queue,
 void QueueManager::clearQueue(QueueType queue) {
 	lockQueue(queue);
 
-	for (std::list<Queueable *>::iterator q = _queue[queue].begin();
+	for (std::vector<Queueable *>::iterator q = _queue[queue].begin();
 	     q != _queue[queue].end(); ++q)
 		(*q)->kickedOut(queue);
 
 	_queue[queue].clear();
+	_keys [queue].clear();
+
+	_needSort[queue] = false;
 
 	unlockQueue(queue);
 }
@@ -30,7 +30,8 @@
 #ifndef GRAPHICS_QUEUEMAN_H
 #define GRAPHICS_QUEUEMAN_H
 
-#include <list>
+#include <vector>
+#include <utility>
 
 #include "common/types.h"
 #include "common/singleton.h"
@@ -53,19 +54,45 @@ public:
 	void lockQueue(QueueType queue);
 	void unlockQueue(QueueType queue);
 
-	const std::list<Queueable *> &getQueue(QueueType queue);
-
+	/** Return the objects in the queue, sorting them first if they need it.
+	 *
+	 *  The queue has to stay locked for as long as the returned objects are used.
+	 */
+	const std::vector<Queueable *> &getQueue(QueueType queue);
+
+	/** Mark the queue as needing a sort.
+	 *
+	 *  The actual sort is deferred to the next getQueue() call, so that
+	 *  many objects moving within one frame only lead to one sort.
+	 */
 	void sortQueue(QueueType queue);
 	void clearQueue(QueueType queue);
 
 	void clearAllQueues();
 
 private:
+	typedef std::pair<double, Queueable *> SortEntry;
+
 	Common::Mutex _queueMutex[kQueueMAX];
-	std::list<Queueable *> _queue[kQueueMAX];
 
-	std::list<Queueable *>::iterator addToQueue(QueueType queue, Queueable &q);
-	void removeFromQueue(QueueType queue, const std::list<Queueable *>::iterator &ref);
+	std::vector<Queueable *> _queue[kQueueMAX]; ///< The objects in each queue.
+	std::vector<double>      _keys [kQueueMAX]; ///< The cached sort keys of the objects.
+
+	bool _needSort[kQueueMAX]; ///< Does the queue need to be sorted?
+
+	/** Scratch space for full sorts.
+	 *
+	 *  Queues are sorted by whichever thread asks for them, under that
+	 *  queue's lock only, so each queue needs its own.
+	 */
+	std::vector<SortEntry> _sortBuffer[kQueueMAX];
+
+	uint32 addToQueue(QueueType queue, Queueable &q);
+	void removeFromQueue(QueueType queue, uint32 index);
+
+	void sort(QueueType queue);
+	bool insertionSort(QueueType queue);
+	void fullSort(QueueType queue);
 
 	friend class Queueable;
 };
@@ -59,8 +59,8 @@ Renderable::~Renderable() {
 	removeFromQueue(_queueExists);
 }
 
-bool Renderable::operator<(const Queueable &q) const {
-	return _distance < static_cast<const Renderable &>(q)._distance;
+double Renderable::getSortKey() const {
+	return _distance;
 }
 
 double Renderable::getDistance() const {
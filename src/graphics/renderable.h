@@ -43,7 +43,7 @@ public:
 	Renderable(RenderableType type);
 	~Renderable();
 
-	bool operator<(const Queueable &q) const;
+	double getSortKey() const;
 
 	/** Calculate the object's distance. */
 	virtual void calculateDistance() = 0;
@@ -41,6 +41,9 @@ class Texture : public GLContainer {
 public:
 	Texture();
 	~Texture();
+
+	/** Return the OpenGL texture ID. */
+	virtual TextureID getID() const = 0;
 };
 
 } // End of namespace Graphics
@@ -42,6 +42,7 @@ namespace Graphics {
 
 typedef GLuint TextureID;
 typedef GLuint ListID;
+typedef GLuint BufferID;
 
 enum PixelFormat {
 	kPixelFormatRGB  = GL_RGB ,
@@ -76,6 +77,7 @@ enum QueueType {
 	kQueueVideo                    , ///< A video.
 	kQueueVisibleVideo             , ///< A currently playing video.
 	kQueueGLContainer              , ///< An object containing OpenGL structures.
+	kQueueNewGLContainer           , ///< An object whose OpenGL structures still need to be built.
 	kQueueMAX                        ///< For range checks.
 };
 
@@ -30,6 +30,9 @@
 #ifndef GRAPHICS_UTIL_H
 #define GRAPHICS_UTIL_H
 
+#include <cstring>
+#include <vector>
+
 #include "common/types.h"
 #include "common/util.h"
 #include "common/maths.h"
@@ -115,6 +118,35 @@ static inline uint32 deSwizzleOffset(uint32 x, uint32 y, uint32 width, uint32 he
 	return offset;
 }
 
+/** De-"swizzle" a whole image.
+ *
+ *  The bits of the x and y coordinates are interleaved independently of
+ *  each other, so the swizzled offset of a pixel is the sum of one part only
+ *  depending on x and one only depending on y. Both are looked up in tables
+ *  computed once per image, instead of re-interleaving the bits per pixel.
+ *
+ *  The parts are scaled to bytes, so they have to be added: for a bpp that
+ *  isn't a power of two, their bits overlap.
+ */
+static inline void deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height, uint32 bpp) {
+	if ((width == 0) || (height == 0))
+		return;
+
+	std::vector<uint32> offsetX(width), offsetY(height);
+
+	for (uint32 x = 0; x < width; x++)
+		offsetX[x] = deSwizzleOffset(x, 0, width, height) * bpp;
+	for (uint32 y = 0; y < height; y++)
+		offsetY[y] = deSwizzleOffset(0, y, width, height) * bpp;
+
+	for (uint32 y = 0; y < height; y++) {
+		const uint32 rowOffset = offsetY[y];
+
+		for (uint32 x = 0; x < width; x++, dst += bpp)
+			memcpy(dst, src + offsetX[x] + rowOffset, bpp);
+	}
+}
+
 } // End of namespace Graphics
 
 #endif // GRAPHICS_UTIL_H
@@ -31,18 +31,21 @@
 #include <cstring>
 
 #include "graphics/vertexbuffer.h"
+#include "graphics/graphics.h"
 
 namespace Graphics {
 
-VertexBuffer::VertexBuffer() : _count(0), _size(0), _data(0) {
+VertexBuffer::VertexBuffer() : _count(0), _size(0), _data(0), _vbo(0) {
 	//ctor
 }
 
-VertexBuffer::VertexBuffer(const VertexBuffer &other) : _data(0) {
+VertexBuffer::VertexBuffer(const VertexBuffer &other) : _data(0), _vbo(0) {
 	*this = other;
 }
 
 VertexBuffer::~VertexBuffer() {
+	abandonGL();
+
 	if (_data)
 		std::free(_data);
 }
@@ -52,11 +55,18 @@ VertexBuffer &VertexBuffer::operator=(const VertexBuffer &other) {
 		setVertexDecl(other._decl);
 		setSize(other._count, other._size);
 		memcpy(_data, other._data, other._count * other._size);
+
+		// Point the attributes to our own copy of the data
+		for (VertexDecl::iterator d = _decl.begin(); d != _decl.end(); ++d)
+			if (other._data && d->pointer)
+				d->pointer = (const byte *) _data + ((const byte *) d->pointer - (const byte *) other._data);
 	}
 	return *this;
 }
 
 void VertexBuffer::setSize(uint32 vertCount, uint32 vertSize) {
+	abandonGL();
+
 	_count = vertCount;
 	_size = vertSize;
 
@@ -93,4 +103,62 @@ uint32 VertexBuffer::getSize() const {
 	return _size;
 }
 
+void VertexBuffer::initGL() {
+	if (_vbo || !_data || !GfxMan.supportVertexBuffers())
+		return;
+
+	glGenBuffers(1, &_vbo);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+	glBufferData(GL_ARRAY_BUFFER, _count * _size, _data, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBuffer::updateGL() {
+	if (!_data || !GfxMan.supportVertexBuffers())
+		return;
+
+	if (!_vbo)
+		glGenBuffers(1, &_vbo);
+
+	// Specify the whole buffer anew, so that OpenGL doesn't need to wait for the old data
+	glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+	glBufferData(GL_ARRAY_BUFFER, _count * _size, _data, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBuffer::destroyGL() {
+	if (!_vbo)
+		return;
+
+	glDeleteBuffers(1, &_vbo);
+	_vbo = 0;
+}
+
+void VertexBuffer::abandonGL() {
+	if (!_vbo)
+		return;
+
+	GfxMan.abandonBuffers(&_vbo, 1);
+	_vbo = 0;
+}
+
+void VertexBuffer::bind() const {
+	if (_vbo)
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+}
+
+void VertexBuffer::unbind() const {
+	if (_vbo)
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+const GLvoid *VertexBuffer::getAttribPointer(const VertexAttrib &attrib) const {
+	if (!_vbo)
+		return attrib.pointer;
+
+	// With a bound buffer object, the pointer is an offset into the buffer
+	return (const GLvoid *) ((const byte *) attrib.pointer - (const byte *) _data);
+}
+
 }
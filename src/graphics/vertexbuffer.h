@@ -88,11 +88,37 @@ public:
 	/** Get vertex element size in bytes */
 	uint32 getSize() const;
 
+	/** Upload the data into a vertex buffer object, if supported.
+	 *
+	 *  Changes to the data after the upload are not seen by OpenGL,
+	 *  until the buffer object is destroyed and uploaded again.
+	 */
+	void initGL();
+	/** Upload the current data into the vertex buffer object, creating it if necessary.
+	 *
+	 *  Meant for data that changes often, like meshes deformed on the CPU.
+	 */
+	void updateGL();
+	/** Destroy the vertex buffer object. */
+	void destroyGL();
+
+	/** Bind the vertex buffer object, if we have one. */
+	void bind() const;
+	/** Unbind the vertex buffer object. */
+	void unbind() const;
+
+	/** Get the pointer to use for this attribute while the buffer is bound. */
+	const GLvoid *getAttribPointer(const VertexAttrib &attrib) const;
+
 private:
 	VertexDecl _decl; ///< Vertex declaration
 	uint32 _count;    ///< Number of elements in buffer
 	uint32 _size;     ///< Size of a buffer element in bytes (vertex attributes size sum)
 	GLvoid *_data;    ///< Buffer data
+	BufferID _vbo;    ///< OpenGL vertex buffer object, or 0 if not uploaded
+
+	/** Abandon the vertex buffer object, because the data changed or went away. */
+	void abandonGL();
 };
 
 }
@@ -91,6 +91,14 @@
 // BASIS, AND BROWN UNIVERSITY HAS NO OBLIGATION TO PROVIDE MAINTENANCE,
 // SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 
+#include <SDL_cpuinfo.h>
+
+#include "common/system.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
 #include "common/error.h"
 #include "common/singleton.h"
 #include "common/util.h"
@@ -183,9 +191,13 @@ YUVToRGBManager::YUVToRGBManager() {
 		Cb_g_tab[i] = (int16) (-(0.114 / 0.331) * CB);
 		Cb_b_tab[i] = (int16) ( (0.587 / 0.331) * CB) + 2 * 768 + 256;
 	}
+
+	_threads.init(CLIP(SDL_GetCPUCount() - 1, 0, 3));
 }
 
 YUVToRGBManager::~YUVToRGBManager() {
+	_threads.deinit();
+
 	delete _lookup;
 }
 
@@ -205,79 +217,218 @@ const YUVToRGBLookup *YUVToRGBManager::getLookup(LuminanceScale scale) {
 	*((d) + 2) = L[cr_r]; \
 	*((d) + 3) = (a)
 
-void YUVToRGBManager::convert420(LuminanceScale scale, byte *dst, int dstPitch, const byte *ySrc, const byte *uSrc, const byte *vSrc, const byte *aSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
-	const YUVToRGBLookup *lookup = YUVToRGBMan.getLookup(scale);
-	const byte *rgbToPix = lookup->getRGBToPix();
-
-	int halfHeight = yHeight >> 1;
-	int halfWidth = yWidth >> 1;
-
-	dst += dstPitch * (yHeight - 2);
-
-	for (int h = 0; h < halfHeight; h++) {
-		for (int w = 0; w < halfWidth; w++) {
-			register const byte *L;
-
-			int16 cr_r  = _colorTab[*vSrc + 0 * 256];
-			int16 crb_g = _colorTab[*vSrc + 1 * 256] + _colorTab[*uSrc + 2 * 256];
-			int16 cb_b  = _colorTab[*uSrc + 3 * 256];
-			uSrc++;
-			vSrc++;
-
-			PUT_PIXEL(*ySrc, *aSrc, dst + dstPitch);
-			PUT_PIXEL(*(ySrc + yPitch), *(aSrc + yPitch), dst);
-			ySrc++;
-			aSrc++;
-			dst += 4;
-			PUT_PIXEL(*ySrc, *aSrc, dst + dstPitch);
-			PUT_PIXEL(*(ySrc + yPitch), *(aSrc + yPitch), dst);
-			ySrc++;
-			aSrc++;
-			dst += 4;
-		}
+/** Convert two lines of a YUV420 image, using the lookup tables.
+ *
+ *  dst0 receives the upper source line, dst1 the lower one.
+ */
+static void convertLinesLookup(const int16 *colorTab, const byte *rgbToPix,
+                               byte *dst0, byte *dst1, const byte *ySrc0, const byte *ySrc1,
+                               const byte *aSrc0, const byte *aSrc1,
+                               const byte *uSrc, const byte *vSrc, int x, int yWidth) {
+
+	for (; x < yWidth; x += 2) {
+		register const byte *L;
+
+		int16 cr_r  = colorTab[*vSrc + 0 * 256];
+		int16 crb_g = colorTab[*vSrc + 1 * 256] + colorTab[*uSrc + 2 * 256];
+		int16 cb_b  = colorTab[*uSrc + 3 * 256];
+		uSrc++;
+		vSrc++;
+
+		PUT_PIXEL(ySrc0[x    ], aSrc0 ? aSrc0[x    ] : 0xFF, dst0 + x * 4);
+		PUT_PIXEL(ySrc1[x    ], aSrc1 ? aSrc1[x    ] : 0xFF, dst1 + x * 4);
+		PUT_PIXEL(ySrc0[x + 1], aSrc0 ? aSrc0[x + 1] : 0xFF, dst0 + x * 4 + 4);
+		PUT_PIXEL(ySrc1[x + 1], aSrc1 ? aSrc1[x + 1] : 0xFF, dst1 + x * 4 + 4);
+	}
+}
+
+#ifdef XOREOS_SSE2
+/** Convert 8 pixels of one line into BGRA, using SSE2. */
+static inline void convertPixelsSSE2(YUVToRGBManager::LuminanceScale scale, byte *dst,
+                                     const byte *ySrc, const byte *aSrc,
+                                     __m128i rOff, __m128i gOff, __m128i bOff) {
+
+	const __m128i zero = _mm_setzero_si128();
+
+	const __m128i y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) ySrc), zero);
+
+	__m128i r = _mm_add_epi16(y, rOff);
+	__m128i g = _mm_add_epi16(y, gOff);
+	__m128i b = _mm_add_epi16(y, bOff);
+
+	if (scale == YUVToRGBManager::kScaleITU) {
+		// Clip to [16, 235] and scale to [0, 255], rounding down like the lookup does
+		const __m128i min = _mm_set1_epi16(16);
+		const __m128i max = _mm_set1_epi16(235);
+		const __m128i mul = _mm_set1_epi16(10774); // x * 255 / 219 == x + ((x * 10774) >> 16)
 
-		dst -= yWidth * 4 + dstPitch * 2;
-		ySrc += (yPitch << 1) - yWidth;
-		aSrc += (yPitch << 1) - yWidth;
-		uSrc += uvPitch - halfWidth;
-		vSrc += uvPitch - halfWidth;
+		r = _mm_sub_epi16(_mm_min_epi16(_mm_max_epi16(r, min), max), min);
+		g = _mm_sub_epi16(_mm_min_epi16(_mm_max_epi16(g, min), max), min);
+		b = _mm_sub_epi16(_mm_min_epi16(_mm_max_epi16(b, min), max), min);
+
+		r = _mm_add_epi16(r, _mm_mulhi_epu16(r, mul));
+		g = _mm_add_epi16(g, _mm_mulhi_epu16(g, mul));
+		b = _mm_add_epi16(b, _mm_mulhi_epu16(b, mul));
 	}
+
+	// Packing saturates to [0, 255]
+	const __m128i a = aSrc ? _mm_loadl_epi64((const __m128i *) aSrc) : _mm_set1_epi8((char) 0xFF);
+
+	const __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+	const __m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), a);
+
+	_mm_storeu_si128((__m128i *)  dst,       _mm_unpacklo_epi16(bg, ra));
+	_mm_storeu_si128((__m128i *) (dst + 16), _mm_unpackhi_epi16(bg, ra));
 }
 
-void YUVToRGBManager::convert420(LuminanceScale scale, byte *dst, int dstPitch, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
-	const YUVToRGBLookup *lookup = YUVToRGBMan.getLookup(scale);
-	const byte *rgbToPix = lookup->getRGBToPix();
-
-	int halfHeight = yHeight >> 1;
-	int halfWidth = yWidth >> 1;
-
-	dst += dstPitch * (yHeight - 2);
-
-	for (int h = 0; h < halfHeight; h++) {
-		for (int w = 0; w < halfWidth; w++) {
-			register const byte *L;
-
-			int16 cr_r  = _colorTab[*vSrc + 0 * 256];
-			int16 crb_g = _colorTab[*vSrc + 1 * 256] + _colorTab[*uSrc + 2 * 256];
-			int16 cb_b  = _colorTab[*uSrc + 3 * 256];
-			uSrc++;
-			vSrc++;
-
-			PUT_PIXEL(*ySrc, 0xFF, dst + dstPitch);
-			PUT_PIXEL(*(ySrc + yPitch), 0xFF, dst);
-			ySrc++;
-			dst += 4;
-			PUT_PIXEL(*ySrc, 0xFF, dst + dstPitch);
-			PUT_PIXEL(*(ySrc + yPitch), 0xFF, dst);
-			ySrc++;
-			dst += 4;
-		}
+/** Multiply chroma values by a constant, truncating towards zero like the color table.
+ *
+ *  The constant is given as an integer part (0 or 1) and a 16-bit fraction,
+ *  chosen so that the result is exact for all chroma values in [-128, 127].
+ */
+static inline __m128i mulChromaSSE2(__m128i absC, __m128i signC, bool intPart, uint16 frac) {
+	__m128i p = _mm_mulhi_epu16(absC, _mm_set1_epi16((int16) frac));
+	if (intPart)
+		p = _mm_add_epi16(p, absC);
+
+	return _mm_sub_epi16(_mm_xor_si128(p, signC), signC);
+}
+
+/** Convert two lines of a YUV420 image, using SSE2.
+ *
+ *  The result is identical to convertLinesLookup().
+ */
+static void convertLinesSSE2(YUVToRGBManager::LuminanceScale scale, const int16 *colorTab,
+                             const byte *rgbToPix, byte *dst0, byte *dst1,
+                             const byte *ySrc0, const byte *ySrc1, const byte *aSrc0, const byte *aSrc1,
+                             const byte *uSrc, const byte *vSrc, int yWidth) {
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c128 = _mm_set1_epi16(128);
+
+	int x = 0;
+	for (; (x + 16) <= yWidth; x += 16) {
+		// 8 chroma values, for 16 pixels on each line
+		const __m128i u = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (uSrc + (x >> 1))), zero), c128);
+		const __m128i v = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (vSrc + (x >> 1))), zero), c128);
+
+		const __m128i uSign = _mm_srai_epi16(u, 15);
+		const __m128i vSign = _mm_srai_epi16(v, 15);
+		const __m128i uAbs  = _mm_sub_epi16(_mm_xor_si128(u, uSign), uSign);
+		const __m128i vAbs  = _mm_sub_epi16(_mm_xor_si128(v, vSign), vSign);
+
+		// (0.419 / 0.299), (0.299 / 0.419), (0.114 / 0.331) and (0.587 / 0.331)
+		const __m128i r = mulChromaSSE2(vAbs, vSign, true , 26215);
+		const __m128i g = _mm_sub_epi16(zero, _mm_add_epi16(mulChromaSSE2(vAbs, vSign, false, 46735),
+		                                                    mulChromaSSE2(uAbs, uSign, false, 22562)));
+		const __m128i b = mulChromaSSE2(uAbs, uSign, true , 50682);
+
+		// Two pixels on each line share the same chroma values
+		const __m128i rLo = _mm_unpacklo_epi16(r, r), rHi = _mm_unpackhi_epi16(r, r);
+		const __m128i gLo = _mm_unpacklo_epi16(g, g), gHi = _mm_unpackhi_epi16(g, g);
+		const __m128i bLo = _mm_unpacklo_epi16(b, b), bHi = _mm_unpackhi_epi16(b, b);
+
+		convertPixelsSSE2(scale, dst0 + x * 4     , ySrc0 + x    , aSrc0 ? (aSrc0 + x    ) : 0, rLo, gLo, bLo);
+		convertPixelsSSE2(scale, dst0 + x * 4 + 32, ySrc0 + x + 8, aSrc0 ? (aSrc0 + x + 8) : 0, rHi, gHi, bHi);
+		convertPixelsSSE2(scale, dst1 + x * 4     , ySrc1 + x    , aSrc1 ? (aSrc1 + x    ) : 0, rLo, gLo, bLo);
+		convertPixelsSSE2(scale, dst1 + x * 4 + 32, ySrc1 + x + 8, aSrc1 ? (aSrc1 + x + 8) : 0, rHi, gHi, bHi);
+	}
+
+	// Left-over pixels
+	convertLinesLookup(colorTab, rgbToPix, dst0, dst1, ySrc0, ySrc1, aSrc0, aSrc1,
+	                   uSrc + (x >> 1), vSrc + (x >> 1), x, yWidth);
+}
+#endif
+
+/** Converting a YUV420 image in slices of lines, one slice per job. */
+class Convert420Jobs : public Common::ThreadPool::Jobs {
+public:
+	Convert420Jobs(YUVToRGBManager::LuminanceScale scale, const int16 *colorTab, const byte *rgbToPix,
+	               byte *dst, int dstPitch, const byte *ySrc, const byte *uSrc, const byte *vSrc,
+	               const byte *aSrc, int yWidth, int yHeight, int yPitch, int uvPitch, uint sliceCount) :
+		_scale(scale), _colorTab(colorTab), _rgbToPix(rgbToPix), _dst(dst), _dstPitch(dstPitch),
+		_ySrc(ySrc), _uSrc(uSrc), _vSrc(vSrc), _aSrc(aSrc), _yWidth(yWidth), _yHeight(yHeight),
+		_yPitch(yPitch), _uvPitch(uvPitch) {
+
+		// Slices of whole line pairs
+		_slicePairs = ((yHeight >> 1) + sliceCount - 1) / sliceCount;
+	}
+
+	uint getCount() const {
+		if (_slicePairs == 0)
+			return 0;
+
+		return ((_yHeight >> 1) + _slicePairs - 1) / _slicePairs;
+	}
+
+	void runJob(uint n) {
+		int start = n * _slicePairs;
+		int end   = MIN<int>(start + _slicePairs, _yHeight >> 1);
 
-		dst -= yWidth * 4 + dstPitch * 2;
-		ySrc += (yPitch << 1) - yWidth;
-		uSrc += uvPitch - halfWidth;
-		vSrc += uvPitch - halfWidth;
+		for (int h = start; h < end; h++) {
+			// The image is stored upside down
+			byte *dst1 = _dst + _dstPitch * (_yHeight - 2 - 2 * h);
+			byte *dst0 = dst1 + _dstPitch;
+
+			const byte *ySrc0 = _ySrc + _yPitch * 2 * h;
+			const byte *ySrc1 = ySrc0 + _yPitch;
+
+			const byte *aSrc0 = _aSrc ? (_aSrc + _yPitch * 2 * h) : 0;
+			const byte *aSrc1 = _aSrc ? (aSrc0 + _yPitch) : 0;
+
+			const byte *uSrc = _uSrc + _uvPitch * h;
+			const byte *vSrc = _vSrc + _uvPitch * h;
+
+#ifdef XOREOS_SSE2
+			convertLinesSSE2(_scale, _colorTab, _rgbToPix, dst0, dst1,
+			                 ySrc0, ySrc1, aSrc0, aSrc1, uSrc, vSrc, _yWidth);
+#else
+			convertLinesLookup(_colorTab, _rgbToPix, dst0, dst1,
+			                   ySrc0, ySrc1, aSrc0, aSrc1, uSrc, vSrc, 0, _yWidth);
+#endif
+		}
 	}
+
+private:
+	YUVToRGBManager::LuminanceScale _scale;
+
+	const int16 *_colorTab;
+	const byte  *_rgbToPix;
+
+	byte *_dst;
+	int   _dstPitch;
+
+	const byte *_ySrc;
+	const byte *_uSrc;
+	const byte *_vSrc;
+	const byte *_aSrc;
+
+	int _yWidth;
+	int _yHeight;
+	int _yPitch;
+	int _uvPitch;
+
+	int _slicePairs;
+};
+
+void YUVToRGBManager::convert420(LuminanceScale scale, byte *dst, int dstPitch, const byte *ySrc, const byte *uSrc, const byte *vSrc, const byte *aSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+	Common::StackLock lock(_mutex);
+
+	const YUVToRGBLookup *lookup = getLookup(scale);
+
+	// Only split up images big enough to make waking up the threads worthwhile
+	uint sliceCount = 1;
+	if ((yWidth * yHeight) >= kMinSlicedSize)
+		sliceCount = _threads.getThreadCount() + 1;
+
+	Convert420Jobs jobs(scale, _colorTab, lookup->getRGBToPix(), dst, dstPitch,
+	                    ySrc, uSrc, vSrc, aSrc, yWidth, yHeight, yPitch, uvPitch, sliceCount);
+
+	_threads.run(jobs, jobs.getCount());
+}
+
+void YUVToRGBManager::convert420(LuminanceScale scale, byte *dst, int dstPitch, const byte *ySrc, const byte *uSrc, const byte *vSrc, int yWidth, int yHeight, int yPitch, int uvPitch) {
+	convert420(scale, dst, dstPitch, ySrc, uSrc, vSrc, 0, yWidth, yHeight, yPitch, uvPitch);
 }
 
 } // End of namespace Graphics
@@ -31,6 +31,9 @@
 #define GRAPHICS_YUV_TO_RGB_H
 
 #include "common/singleton.h"
+#include "common/mutex.h"
+#include "common/threadpool.h"
+
 #include "graphics/types.h"
 
 namespace Graphics {
@@ -79,6 +82,9 @@ public:
 	void convert420(LuminanceScale scale, byte *dst, int dstPitch, const byte *ySrc, const byte *uSrc, const byte *vSrc, const byte *aSrc, int yWidth, int yHeight, int yPitch, int uvPitch);
 
 private:
+	/** Images with at least that many pixels are converted in parallel slices. */
+	static const int kMinSlicedSize = 320 * 240;
+
 	friend class Common::Singleton<SingletonBaseType>;
 	YUVToRGBManager();
 	~YUVToRGBManager();
@@ -87,6 +93,9 @@ private:
 
 	YUVToRGBLookup *_lookup;
 	int16 _colorTab[4 * 256]; // 2048 bytes
+
+	Common::Mutex      _mutex;   ///< Only one conversion at a time.
+	Common::ThreadPool _threads; ///< Converts slices of big images.
 };
 
 } // End of namespace Graphics
@@ -31,8 +31,13 @@
 #define SOUND_DECODERS_UTIL_H
 
 #include "common/types.h"
+#include "common/system.h"
 #include "common/util.h"
 
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
 namespace Sound {
 
 // Convert one float sample into a int16 sample
@@ -40,18 +45,63 @@ static inline int16 floatToInt16(float src) {
 	return (int16) CLIP<int>((int) floor(src + 0.5), -32768, 32767);
 }
 
+#ifdef XOREOS_SSE2
+// Clamp 4 float samples and round them like floatToInt16() does, halves away from -inf
+static inline __m128i floatToInt32x4(__m128 src) {
+	const __m128 min  = _mm_set1_ps(-32768.0f);
+	const __m128 max  = _mm_set1_ps( 32767.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	src = _mm_min_ps(_mm_max_ps(src, min), max);
+
+	// cvtps rounds halves to even. Where that rounded a half down, bump it up
+	// (the compare mask is -1). The remainder is exact within the clamped range.
+	const __m128i rounded   = _mm_cvtps_epi32(src);
+	const __m128  remainder = _mm_sub_ps(src, _mm_cvtepi32_ps(rounded));
+
+	return _mm_sub_epi32(rounded, _mm_castps_si128(_mm_cmpeq_ps(remainder, half)));
+}
+
+// Convert 8 float samples into int16 samples, exactly like floatToInt16()
+static inline __m128i floatToInt16x8(const float *src) {
+	return _mm_packs_epi32(floatToInt32x4(_mm_loadu_ps(src)), floatToInt32x4(_mm_loadu_ps(src + 4)));
+}
+#endif
+
 // Convert planar float samples into interleaved int16 samples
 static inline void floatToInt16Interleave(int16 *dst, const float **src,
                                           uint32 length, uint8 channels) {
-	if (channels == 2) {
-		for (uint32 i = 0; i < length; i++) {
+	uint32 i = 0;
+
+	if (channels == 1) {
+#ifdef XOREOS_SSE2
+		for (; (i + 8) <= length; i += 8)
+			_mm_storeu_si128((__m128i *) (dst + i), floatToInt16x8(src[0] + i));
+#endif
+
+		for (; i < length; i++)
+			dst[i] = floatToInt16(src[0][i]);
+
+	} else if (channels == 2) {
+#ifdef XOREOS_SSE2
+		for (; (i + 8) <= length; i += 8) {
+			const __m128i left  = floatToInt16x8(src[0] + i);
+			const __m128i right = floatToInt16x8(src[1] + i);
+
+			_mm_storeu_si128((__m128i *) (dst + 2 * i    ), _mm_unpacklo_epi16(left, right));
+			_mm_storeu_si128((__m128i *) (dst + 2 * i + 8), _mm_unpackhi_epi16(left, right));
+		}
+#endif
+
+		for (; i < length; i++) {
 			dst[2 * i    ] = floatToInt16(src[0][i]);
 			dst[2 * i + 1] = floatToInt16(src[1][i]);
 		}
+
 	} else {
 		for (uint8 c = 0; c < channels; c++)
-			for (uint32 i = 0, j = c; i < length; i++, j += channels)
-				dst[j] = floatToInt16(src[c][i]);
+			for (uint32 n = 0, j = c; n < length; n++, j += channels)
+				dst[j] = floatToInt16(src[c][n]);
 	}
 }
 
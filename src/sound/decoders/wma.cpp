@@ -31,13 +31,19 @@
 
 #include <vector>
 
+#include "common/system.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
 #include "common/util.h"
 #include "common/maths.h"
 #include "common/sinewindows.h"
 #include "common/error.h"
 #include "common/stream.h"
 #include "common/mdct.h"
-#include "common/bitstream.h"
+#include "common/bitreader.h"
 #include "common/huffman.h"
 
 #include "sound/audiostream.h"
@@ -50,6 +56,16 @@
 namespace Sound {
 
 static inline void butterflyFloats(float *v1, float *v2, int len) {
+#ifdef XOREOS_SSE2
+	for (; len >= 4; len -= 4, v1 += 4, v2 += 4) {
+		const __m128 a = _mm_loadu_ps(v1);
+		const __m128 b = _mm_loadu_ps(v2);
+
+		_mm_storeu_ps(v1, _mm_add_ps(a, b));
+		_mm_storeu_ps(v2, _mm_sub_ps(a, b));
+	}
+#endif
+
 	while (len-- > 0) {
 		float t = *v1 - *v2;
 
@@ -60,6 +76,11 @@ static inline void butterflyFloats(float *v1, float *v2, int len) {
 
 static inline void vectorFMulAdd(float *dst, const float *src0,
                           const float *src1, const float *src2, int len) {
+#ifdef XOREOS_SSE2
+	for (; len >= 4; len -= 4, dst += 4, src0 += 4, src1 += 4, src2 += 4)
+		_mm_storeu_ps(dst, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src0), _mm_loadu_ps(src1)), _mm_loadu_ps(src2)));
+#endif
+
 	while (len-- > 0)
 		*dst++ = *src0++ * *src1++ + *src2++;
 }
@@ -68,6 +89,15 @@ static inline void vectorFMulReverse(float *dst, const float *src0,
                                      const float *src1, int len) {
 	src1 += len - 1;
 
+#ifdef XOREOS_SSE2
+	for (; len >= 4; len -= 4, dst += 4, src0 += 4, src1 -= 4) {
+		// Load src1[-3..0] and reverse them
+		const __m128 reverse = _mm_shuffle_ps(_mm_loadu_ps(src1 - 3), _mm_loadu_ps(src1 - 3), _MM_SHUFFLE(0, 1, 2, 3));
+
+		_mm_storeu_ps(dst, _mm_mul_ps(_mm_loadu_ps(src0), reverse));
+	}
+#endif
+
 	while (len-- > 0)
 		*dst++ = *src0++ * *src1--;
 }
@@ -564,7 +594,7 @@ Common::SeekableReadStream *WMACodec::decodeSuperFrame(Common::SeekableReadStrea
 	if (_blockAlign)
 		size = _blockAlign;
 
-	Common::BitStream8MSB bits(data);
+	Common::BitReader8MSB bits(data, data.size() - data.pos());
 
 	int    outputDataSize = 0;
 	int16 *outputData     = 0;
@@ -614,8 +644,7 @@ Common::SeekableReadStream *WMACodec::decodeSuperFrame(Common::SeekableReadStrea
 				_lastSuperframeLen += 1;
 			}
 
-			Common::MemoryReadStream lastSuperframe(_lastSuperframe, _lastSuperframeLen);
-			Common::BitStream8MSB lastBits(lastSuperframe);
+			Common::BitReader8MSB lastBits(_lastSuperframe, _lastSuperframeLen);
 
 			lastBits.skip(_lastBitoffset);
 
@@ -679,7 +708,7 @@ Common::SeekableReadStream *WMACodec::decodeSuperFrame(Common::SeekableReadStrea
 	return new Common::MemoryReadStream((byte *) outputData, outputDataSize * 2, true);
 }
 
-bool WMACodec::decodeFrame(Common::BitStream &bits, int16 *outputData) {
+bool WMACodec::decodeFrame(Common::BitReader8MSB &bits, int16 *outputData) {
 	_framePos = 0;
 	_curBlock = 0;
 
@@ -709,7 +738,7 @@ bool WMACodec::decodeFrame(Common::BitStream &bits, int16 *outputData) {
 	return true;
 }
 
-int WMACodec::decodeBlock(Common::BitStream &bits) {
+int WMACodec::decodeBlock(Common::BitReader8MSB &bits) {
 	// Computer new block length
 	if (!evalBlockLength(bits))
 		return -1;
@@ -762,7 +791,7 @@ int WMACodec::decodeBlock(Common::BitStream &bits) {
 	return 0;
 }
 
-bool WMACodec::decodeChannels(Common::BitStream &bits, int bSize,
+bool WMACodec::decodeChannels(Common::BitReader8MSB &bits, int bSize,
                               bool msStereo, bool *hasChannel) {
 
 	int totalGain    = readTotalGain(bits);
@@ -818,7 +847,7 @@ bool WMACodec::calculateIMDCT(int bSize, bool msStereo, bool *hasChannel) {
 	return true;
 }
 
-bool WMACodec::evalBlockLength(Common::BitStream &bits) {
+bool WMACodec::evalBlockLength(Common::BitReader8MSB &bits) {
 	if (_useVariableBlockLen) {
 		// Variable block lengths
 
@@ -894,7 +923,7 @@ void WMACodec::calculateCoefCount(int *coefCount, int bSize) const {
 		coefCount[i] = coefN;
 }
 
-bool WMACodec::decodeNoise(Common::BitStream &bits, int bSize,
+bool WMACodec::decodeNoise(Common::BitReader8MSB &bits, int bSize,
                            bool *hasChannel, int *coefCount) {
 	if (!_useNoiseCoding)
 		return true;
@@ -945,7 +974,7 @@ bool WMACodec::decodeNoise(Common::BitStream &bits, int bSize,
 	return true;
 }
 
-bool WMACodec::decodeExponents(Common::BitStream &bits, int bSize, bool *hasChannel) {
+bool WMACodec::decodeExponents(Common::BitReader8MSB &bits, int bSize, bool *hasChannel) {
 	// Exponents can be reused in short blocks
 	if (!((_blockLenBits == _frameLenBits) || bits.getBit()))
 		return true;
@@ -968,7 +997,7 @@ bool WMACodec::decodeExponents(Common::BitStream &bits, int bSize, bool *hasChan
 	return true;
 }
 
-bool WMACodec::decodeSpectralCoef(Common::BitStream &bits, bool msStereo, bool *hasChannel,
+bool WMACodec::decodeSpectralCoef(Common::BitReader8MSB &bits, bool msStereo, bool *hasChannel,
                                   int *coefCount, int coefBitCount) {
 	// Simple RLE encoding
 
@@ -1208,7 +1237,7 @@ static const float powTab[] = {
     7.4989420933246e+05, 8.6596432336007e+05,
 };
 
-bool WMACodec::decodeExpHuffman(Common::BitStream &bits, int ch) {
+bool WMACodec::decodeExpHuffman(Common::BitReader8MSB &bits, int ch) {
 	const float  *ptab  = powTab + 60;
 	const uint32 *iptab = (const uint32 *) ptab;
 
@@ -1306,7 +1335,7 @@ void WMACodec::lspToCurve(float *out, float *val_max_ptr, int n, float *lsp) {
 }
 
 // Decode exponents coded with LSP coefficients (same idea as Vorbis)
-bool WMACodec::decodeExpLSP(Common::BitStream &bits, int ch) {
+bool WMACodec::decodeExpLSP(Common::BitReader8MSB &bits, int ch) {
 	float lspCoefs[kLSPCoefCount];
 
 	for (int i = 0; i < kLSPCoefCount; i++) {
@@ -1324,7 +1353,7 @@ bool WMACodec::decodeExpLSP(Common::BitStream &bits, int ch) {
 	return true;
 }
 
-bool WMACodec::decodeRunLevel(Common::BitStream &bits, const Common::Huffman &huffman,
+bool WMACodec::decodeRunLevel(Common::BitReader8MSB &bits, const Common::Huffman &huffman,
 	const float *levelTable, const uint16 *runTable, int version, float *ptr,
 	int offset, int numCoefs, int blockLen, int frameLenBits, int coefNbBits) {
 
@@ -1466,7 +1495,7 @@ float WMACodec::pow_m1_4(float x) const {
 	return _lspPowETable[e] * (a + b * t.f);
 }
 
-int WMACodec::readTotalGain(Common::BitStream &bits) {
+int WMACodec::readTotalGain(Common::BitReader8MSB &bits) {
 	int totalGain = 1;
 
 	int v = 127;
@@ -1487,7 +1516,7 @@ int WMACodec::totalGainToBits(int totalGain) {
 	else                     return  9;
 }
 
-uint32 WMACodec::getLargeVal(Common::BitStream &bits) {
+uint32 WMACodec::getLargeVal(Common::BitReader8MSB &bits) {
 	// Consumes up to 34 bits
 
 	int count = 8;
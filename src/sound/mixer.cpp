@@ -0,0 +1,418 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file sound/mixer.cpp
+ *  Audio output through a software mixer.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include <SDL_timer.h>
+
+#include "common/util.h"
+#include "common/endianness.h"
+#include "common/error.h"
+#include "common/file.h"
+
+#include "sound/mixer.h"
+
+namespace Sound {
+
+/** The sample rate of the mixed sound. */
+static const int kMixRate = 44100;
+
+/** Number of sample frames mixed at once. */
+static const uint32 kBlockSize = 1024;
+
+/** Maximum number of blocks mixed in one update, about 1.5 seconds. */
+static const uint32 kMaxBlocks = 64;
+
+
+MixerOutput::Buffer::Buffer() : channels(0), rate(0) {
+}
+
+uint32 MixerOutput::Buffer::getFrames() const {
+	return (channels > 0) ? (data.size() / channels) : 0;
+}
+
+
+MixerOutput::Source::Source() : processed(0), position(0.0), playing(false), gain(1.0f), pitch(1.0f) {
+	coords[0] = coords[1] = coords[2] = 0.0f;
+}
+
+
+MixerOutput::MixerOutput(const Common::UString &file, bool realTime) : _file(file), _realTime(realTime),
+	_listenerGain(1.0f), _lastID(0), _wav(0), _wavDataSize(0), _startTime(0), _mixedFrames(0), _mixTime(0) {
+
+	_mix.resize(kBlockSize * 2);
+
+	if (!_file.empty())
+		openWAV();
+}
+
+MixerOutput::~MixerOutput() {
+	const double mixed   = (double) _mixedFrames / kMixRate;
+	const double mixTime = (double) _mixTime / SDL_GetPerformanceFrequency();
+
+	status("Mixer: Mixed %.2f seconds of sound in %.3f seconds (%.1fx real time)",
+	       mixed, mixTime, (mixTime > 0.0) ? (mixed / mixTime) : 0.0);
+
+	closeWAV();
+}
+
+bool MixerOutput::supportsChannels(int channels) const {
+	return (channels == 1) || (channels == 2) || (channels == 6);
+}
+
+void MixerOutput::setListenerGain(float gain) {
+	_listenerGain = gain;
+}
+
+MixerOutput::Source &MixerOutput::getSource(uint32 source) {
+	SourceMap::iterator s = _sources.find(source);
+	if (s == _sources.end())
+		throw Common::Exception("MixerOutput: No such source %u", source);
+
+	return s->second;
+}
+
+uint32 MixerOutput::createSource() {
+	_sources.insert(std::make_pair(++_lastID, Source()));
+
+	return _lastID;
+}
+
+void MixerOutput::deleteSource(uint32 source) {
+	_sources.erase(source);
+}
+
+void MixerOutput::play(uint32 source) {
+	Source &s = getSource(source);
+
+	// Nothing to play
+	if (s.processed >= s.queue.size())
+		return;
+
+	s.playing = true;
+
+	if (_startTime == 0)
+		_startTime = SDL_GetTicks();
+}
+
+void MixerOutput::pause(uint32 source) {
+	getSource(source).playing = false;
+}
+
+bool MixerOutput::isPlaying(uint32 source) {
+	return getSource(source).playing;
+}
+
+bool MixerOutput::isDone(uint32 source) {
+	const Source &s = getSource(source);
+
+	return s.processed >= s.queue.size();
+}
+
+void MixerOutput::setGain(uint32 source, float gain) {
+	getSource(source).gain = gain;
+}
+
+void MixerOutput::setPitch(uint32 source, float pitch) {
+	// Like OpenAL, we only allow positive pitches
+	getSource(source).pitch = MAX(pitch, 0.01f);
+}
+
+void MixerOutput::setPosition(uint32 source, float x, float y, float z) {
+	Source &s = getSource(source);
+
+	s.coords[0] = x;
+	s.coords[1] = y;
+	s.coords[2] = z;
+}
+
+void MixerOutput::getPosition(uint32 source, float &x, float &y, float &z) {
+	const Source &s = getSource(source);
+
+	x = s.coords[0];
+	y = s.coords[1];
+	z = s.coords[2];
+}
+
+uint32 MixerOutput::createBuffer() {
+	_buffers.insert(std::make_pair(++_lastID, Buffer()));
+
+	return _lastID;
+}
+
+void MixerOutput::deleteBuffer(uint32 buffer) {
+	_buffers.erase(buffer);
+}
+
+bool MixerOutput::fillBuffer(uint32 buffer, const int16 *data, uint32 size, int channels, int rate) {
+	BufferMap::iterator b = _buffers.find(buffer);
+	if ((b == _buffers.end()) || !supportsChannels(channels) || (rate <= 0))
+		return false;
+
+	b->second.data.assign(data, data + size / 2);
+	b->second.channels = channels;
+	b->second.rate     = rate;
+
+	return true;
+}
+
+void MixerOutput::queueBuffer(uint32 source, uint32 buffer) {
+	getSource(source).queue.push_back(buffer);
+}
+
+bool MixerOutput::unqueueBuffer(uint32 source, uint32 &buffer) {
+	Source &s = getSource(source);
+	if (s.processed == 0)
+		return false;
+
+	buffer = s.queue.front();
+
+	s.queue.pop_front();
+	s.processed--;
+
+	return true;
+}
+
+double MixerOutput::getFramesLeft(const Source &source) const {
+	double frames = -source.position;
+
+	for (uint32 i = source.processed; i < source.queue.size(); i++) {
+		BufferMap::const_iterator b = _buffers.find(source.queue[i]);
+		if ((b == _buffers.end()) || (b->second.rate <= 0))
+			continue;
+
+		frames += b->second.getFrames() / ((b->second.rate * source.pitch) / kMixRate);
+	}
+
+	return frames;
+}
+
+bool MixerOutput::update() {
+	const uint64 start = SDL_GetPerformanceCounter();
+
+	uint32 blocks = 0;
+
+	if (_realTime) {
+		// Mix as much as the clock says has been played since the last update
+		if (_startTime != 0) {
+			const uint64 due = ((uint64) (SDL_GetTicks() - _startTime) * kMixRate) / 1000;
+
+			while ((_mixedFrames + kBlockSize <= due) && (blocks < kMaxBlocks)) {
+				mixBlock();
+				blocks++;
+			}
+
+			// Don't try to catch up after a long stall
+			if (_mixedFrames + kBlockSize <= due)
+				_mixedFrames = due;
+		}
+
+	} else {
+		// Mix as long as all playing sources have enough data. Once that's no longer
+		// the case, the sound manager has already given us all the data it has, so
+		// mix one block anyway, to let sounds play out.
+		while (blocks < kMaxBlocks) {
+			bool playing = false, starving = false;
+
+			for (SourceMap::const_iterator s = _sources.begin(); s != _sources.end(); ++s) {
+				if (!s->second.playing)
+					continue;
+
+				playing = true;
+				if (getFramesLeft(s->second) < kBlockSize)
+					starving = true;
+			}
+
+			if (!playing || (starving && (blocks > 0)))
+				break;
+
+			mixBlock();
+			blocks++;
+
+			if (starving)
+				break;
+		}
+	}
+
+	_mixTime += SDL_GetPerformanceCounter() - start;
+
+	return !_realTime && (blocks > 0);
+}
+
+void MixerOutput::mixBlock() {
+	std::fill(_mix.begin(), _mix.end(), 0.0f);
+
+	for (SourceMap::iterator s = _sources.begin(); s != _sources.end(); ++s)
+		if (s->second.playing)
+			mixSource(s->second);
+
+	if (_wav)
+		writeWAVBlock();
+
+	_mixedFrames += kBlockSize;
+}
+
+void MixerOutput::mixSource(Source &source) {
+	float gainLeft  = source.gain * _listenerGain;
+	float gainRight = source.gain * _listenerGain;
+
+	// Mono sources are positioned: inverse distance attenuation and panning
+	const float distance = sqrtf(source.coords[0] * source.coords[0] +
+	                             source.coords[1] * source.coords[1] +
+	                             source.coords[2] * source.coords[2]);
+
+	const float attenuation = 1.0f / MAX(distance, 1.0f);
+	const float pan         = (distance > 0.0f) ? (source.coords[0] / distance) : 0.0f;
+
+	const float monoLeft  = gainLeft  * attenuation * MIN(1.0f, 1.0f - pan);
+	const float monoRight = gainRight * attenuation * MIN(1.0f, 1.0f + pan);
+
+	// Downmixing 5.1: front left, front right, center, LFE, rear left, rear right
+	static const float kSide = 0.7071f;
+
+	uint32 frame = 0;
+	while (frame < kBlockSize) {
+		if (source.processed >= source.queue.size()) {
+			// Ran out of data
+			source.playing  = false;
+			source.position = 0.0;
+			return;
+		}
+
+		BufferMap::const_iterator b = _buffers.find(source.queue[source.processed]);
+
+		const uint32 frames = (b != _buffers.end()) ? b->second.getFrames() : 0;
+		if (source.position >= frames) {
+			// Done with this buffer, on to the next
+			source.position -= frames;
+			source.processed++;
+			continue;
+		}
+
+		const Buffer &buffer = b->second;
+		const int16 *data = &buffer.data[0];
+
+		const int    channels = buffer.channels;
+		const double step     = (buffer.rate * source.pitch) / kMixRate;
+
+		float *mix = &_mix[frame * 2];
+
+		// Linear interpolation between neighbouring frames
+		for (; (frame < kBlockSize) && (source.position < frames); frame++, mix += 2, source.position += step) {
+			const uint32 pos0 = (uint32) source.position;
+			const uint32 pos1 = MIN(pos0 + 1, frames - 1);
+			const float  f    = (float) (source.position - pos0);
+
+			const int16 *s0 = data + pos0 * channels;
+			const int16 *s1 = data + pos1 * channels;
+
+			if (channels == 1) {
+				const float sample = s0[0] + f * (s1[0] - s0[0]);
+
+				mix[0] += sample * monoLeft;
+				mix[1] += sample * monoRight;
+
+			} else if (channels == 2) {
+				mix[0] += (s0[0] + f * (s1[0] - s0[0])) * gainLeft;
+				mix[1] += (s0[1] + f * (s1[1] - s0[1])) * gainRight;
+
+			} else if (channels == 6) {
+				float c[6];
+				for (int i = 0; i < 6; i++)
+					c[i] = s0[i] + f * (s1[i] - s0[i]);
+
+				mix[0] += (c[0] + kSide * (c[2] + c[4])) * gainLeft;
+				mix[1] += (c[1] + kSide * (c[2] + c[5])) * gainRight;
+			}
+		}
+	}
+}
+
+void MixerOutput::openWAV() {
+	_wav = new Common::DumpFile;
+	if (!_wav->open(_file)) {
+		warning("Mixer: Can't open WAV file \"%s\"", _file.c_str());
+
+		delete _wav;
+		_wav = 0;
+		return;
+	}
+
+	_block.resize(_mix.size() * 2);
+
+	// The sizes are still unknown, we'll fill them in when we're done
+	writeWAVHeader();
+}
+
+void MixerOutput::writeWAVBlock() {
+	byte *block = &_block[0];
+	for (size_t i = 0; i < _mix.size(); i++, block += 2)
+		WRITE_LE_UINT16(block, (uint16) (int16) CLIP(_mix[i], -32768.0f, 32767.0f));
+
+	_wav->write(&_block[0], _block.size());
+
+	_wavDataSize += _block.size();
+}
+
+void MixerOutput::closeWAV() {
+	if (!_wav)
+		return;
+
+	if (!_wav->seek(0))
+		warning("Mixer: Can't seek in WAV file \"%s\"", _file.c_str());
+	else
+		writeWAVHeader();
+
+	if (!_wav->flush() || _wav->err())
+		warning("Mixer: Failed writing WAV file \"%s\"", _file.c_str());
+
+	delete _wav;
+	_wav = 0;
+}
+
+void MixerOutput::writeWAVHeader() {
+	_wav->writeUint32BE(MKTAG('R', 'I', 'F', 'F'));
+	_wav->writeUint32LE(36 + _wavDataSize);
+	_wav->writeUint32BE(MKTAG('W', 'A', 'V', 'E'));
+
+	_wav->writeUint32BE(MKTAG('f', 'm', 't', ' '));
+	_wav->writeUint32LE(16);
+	_wav->writeUint16LE(1);            // PCM
+	_wav->writeUint16LE(2);            // Channels
+	_wav->writeUint32LE(kMixRate);     // Sample rate
+	_wav->writeUint32LE(kMixRate * 4); // Bytes per second
+	_wav->writeUint16LE(4);            // Bytes per frame
+	_wav->writeUint16LE(16);           // Bits per sample
+
+	_wav->writeUint32BE(MKTAG('d', 'a', 't', 'a'));
+	_wav->writeUint32LE(_wavDataSize);
+}
+
+} // End of namespace Sound
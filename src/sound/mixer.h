@@ -0,0 +1,174 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file sound/mixer.h
+ *  Audio output through a software mixer.
+ */
+
+#ifndef SOUND_MIXER_H
+#define SOUND_MIXER_H
+
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "common/types.h"
+#include "common/ustring.h"
+
+namespace Common {
+	class DumpFile;
+}
+
+#include "sound/output.h"
+
+namespace Sound {
+
+/** Audio output through a software mixer.
+ *
+ *  All sources are resampled, attenuated and mixed into one 16-bit stereo
+ *  stream, which is written into a WAV file block by block, or just
+ *  discarded. This lets
+ *  us measure the cost of sound without any audio device.
+ *
+ *  In real-time mode, the mixer follows the clock, like a sound card would.
+ *  Otherwise, it mixes as fast as the sources are fed, so that every run
+ *  mixes the same data, regardless of the speed of the machine.
+ *
+ *  Like OpenAL with its default listener, the listener sits at the origin,
+ *  looking along the negative z axis. Mono sources are attenuated by
+ *  distance with the inverse distance model and panned left or right.
+ */
+class MixerOutput : public Output {
+public:
+	/** Create a mixer, writing the mixed sound into this WAV file, if not empty. */
+	MixerOutput(const Common::UString &file, bool realTime);
+	~MixerOutput();
+
+	bool supportsChannels(int channels) const;
+
+	void setListenerGain(float gain);
+
+	uint32 createSource();
+	void deleteSource(uint32 source);
+
+	void play(uint32 source);
+	void pause(uint32 source);
+
+	bool isPlaying(uint32 source);
+	bool isDone(uint32 source);
+
+	void setGain(uint32 source, float gain);
+	void setPitch(uint32 source, float pitch);
+
+	void setPosition(uint32 source, float x, float y, float z);
+	void getPosition(uint32 source, float &x, float &y, float &z);
+
+	uint32 createBuffer();
+	void deleteBuffer(uint32 buffer);
+
+	bool fillBuffer(uint32 buffer, const int16 *data, uint32 size, int channels, int rate);
+
+	void queueBuffer(uint32 source, uint32 buffer);
+	bool unqueueBuffer(uint32 source, uint32 &buffer);
+
+	bool update();
+
+private:
+	/** A buffer of sound data. */
+	struct Buffer {
+		std::vector<int16> data; ///< The interleaved samples.
+
+		int channels; ///< Number of channels.
+		int rate;     ///< Sample rate.
+
+		Buffer();
+
+		/** Return the number of sample frames. */
+		uint32 getFrames() const;
+	};
+
+	/** A sound source. */
+	struct Source {
+		std::deque<uint32> queue; ///< The queued buffers.
+		uint32 processed;         ///< Number of played buffers at the front of the queue.
+
+		double position; ///< Position within the current buffer, in sample frames.
+
+		bool playing; ///< Is the source currently playing?
+
+		float gain;  ///< The source's gain.
+		float pitch; ///< The source's pitch.
+
+		float coords[3]; ///< The source's position in space.
+
+		Source();
+	};
+
+	typedef std::map<uint32, Source> SourceMap;
+	typedef std::map<uint32, Buffer> BufferMap;
+
+	Common::UString _file; ///< The WAV file to write.
+	bool _realTime;        ///< Mix in real time?
+
+	float _listenerGain; ///< The listener's gain.
+
+	SourceMap _sources; ///< All sources.
+	BufferMap _buffers; ///< All buffers.
+
+	uint32 _lastID; ///< The last ID given to a source or buffer.
+
+	std::vector<float> _mix;   ///< The block currently being mixed.
+	std::vector<byte>  _block; ///< The last mixed block, as 16-bit little-endian samples.
+
+	Common::DumpFile *_wav; ///< The WAV file we're writing, if any.
+	uint32 _wavDataSize;    ///< Number of sample bytes written into the WAV file.
+
+	uint32 _startTime;   ///< The time we started mixing.
+	uint64 _mixedFrames; ///< Number of frames mixed so far.
+	uint64 _mixTime;     ///< Performance counter ticks spent mixing.
+
+	Source &getSource(uint32 source);
+
+	/** Return the number of output frames the source can still play with its queued buffers. */
+	double getFramesLeft(const Source &source) const;
+
+	/** Mix one block of sound from all playing sources. */
+	void mixBlock();
+	/** Mix the source into the current block. */
+	void mixSource(Source &source);
+
+	/** Open the WAV file and write a header without any sample data. */
+	void openWAV();
+	/** Write the current block into the WAV file. */
+	void writeWAVBlock();
+	/** Patch the final sizes into the WAV header and close the file. */
+	void closeWAV();
+
+	void writeWAVHeader();
+};
+
+} // End of namespace Sound
+
+#endif // SOUND_MIXER_H
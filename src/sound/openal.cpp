@@ -0,0 +1,199 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file sound/openal.cpp
+ *  Audio output through OpenAL.
+ */
+
+#include "common/util.h"
+#include "common/error.h"
+
+#include "sound/openal.h"
+
+namespace Sound {
+
+OpenALOutput::OpenALOutput() : _dev(0), _ctx(0), _hasMultiChannel(false), _format51(0) {
+	_dev = alcOpenDevice(0);
+	if (!_dev)
+		throw Common::Exception("Failed to open OpenAL device");
+
+	_ctx = alcCreateContext(_dev, 0);
+	alcMakeContextCurrent(_ctx);
+	if (!_ctx) {
+		alcCloseDevice(_dev);
+		throw Common::Exception("Could not create OpenAL context");
+	}
+
+	_hasMultiChannel = alIsExtensionPresent("AL_EXT_MCFORMATS");
+	_format51        = alGetEnumValue("AL_FORMAT_51CHN16");
+}
+
+OpenALOutput::~OpenALOutput() {
+	alcMakeContextCurrent(0);
+	alcDestroyContext(_ctx);
+	alcCloseDevice(_dev);
+}
+
+bool OpenALOutput::supportsChannels(int channels) const {
+	if ((channels == 1) || (channels == 2))
+		return true;
+
+	if (channels == 6) {
+		if (!_hasMultiChannel) {
+			warning("OpenALOutput::supportsChannels(): TODO: !_hasMultiChannel");
+			return false;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void OpenALOutput::setListenerGain(float gain) {
+	alListenerf(AL_GAIN, gain);
+}
+
+uint32 OpenALOutput::createSource() {
+	ALuint source;
+
+	alGenSources(1, &source);
+
+	ALenum error = alGetError();
+	if (error != AL_NO_ERROR)
+		throw Common::Exception("OpenAL error while generating sources: %X", error);
+
+	return source;
+}
+
+void OpenALOutput::deleteSource(uint32 source) {
+	ALuint alSource = source;
+
+	alDeleteSources(1, &alSource);
+}
+
+void OpenALOutput::play(uint32 source) {
+	alSourcePlay(source);
+}
+
+void OpenALOutput::pause(uint32 source) {
+	alSourcePause(source);
+
+	ALenum error = alGetError();
+	if (error != AL_NO_ERROR)
+		warning("OpenAL error while attempting to pause: %X", error);
+}
+
+bool OpenALOutput::isPlaying(uint32 source) {
+	ALint state;
+	alGetSourcei(source, AL_SOURCE_STATE, &state);
+
+	return state == AL_PLAYING;
+}
+
+bool OpenALOutput::isDone(uint32 source) {
+	ALint buffersQueued, buffersProcessed;
+	alGetSourcei(source, AL_BUFFERS_QUEUED,    &buffersQueued);
+	alGetSourcei(source, AL_BUFFERS_PROCESSED, &buffersProcessed);
+
+	return buffersQueued == buffersProcessed;
+}
+
+void OpenALOutput::setGain(uint32 source, float gain) {
+	alSourcef(source, AL_GAIN, gain);
+}
+
+void OpenALOutput::setPitch(uint32 source, float pitch) {
+	alSourcef(source, AL_PITCH, pitch);
+}
+
+void OpenALOutput::setPosition(uint32 source, float x, float y, float z) {
+	alSource3f(source, AL_POSITION, x, y, z);
+}
+
+void OpenALOutput::getPosition(uint32 source, float &x, float &y, float &z) {
+	alGetSource3f(source, AL_POSITION, &x, &y, &z);
+}
+
+uint32 OpenALOutput::createBuffer() {
+	ALuint buffer;
+
+	alGenBuffers(1, &buffer);
+
+	ALenum error = alGetError();
+	if (error != AL_NO_ERROR)
+		throw Common::Exception("OpenAL error while generating buffers: %X", error);
+
+	return buffer;
+}
+
+void OpenALOutput::deleteBuffer(uint32 buffer) {
+	ALuint alBuffer = buffer;
+
+	alDeleteBuffers(1, &alBuffer);
+}
+
+bool OpenALOutput::fillBuffer(uint32 buffer, const int16 *data, uint32 size, int channels, int rate) {
+	ALenum format;
+	if      (channels == 1)
+		format = AL_FORMAT_MONO16;
+	else if (channels == 2)
+		format = AL_FORMAT_STEREO16;
+	else if ((channels == 6) && _hasMultiChannel)
+		format = _format51;
+	else
+		return false;
+
+	alBufferData(buffer, format, data, size, rate);
+
+	ALenum error = alGetError();
+	if (error != AL_NO_ERROR) {
+		warning("OpenAL error while filling buffer: 0x%X", error);
+		return false;
+	}
+
+	return true;
+}
+
+void OpenALOutput::queueBuffer(uint32 source, uint32 buffer) {
+	ALuint alBuffer = buffer;
+
+	alSourceQueueBuffers(source, 1, &alBuffer);
+}
+
+bool OpenALOutput::unqueueBuffer(uint32 source, uint32 &buffer) {
+	ALint buffersProcessed;
+	alGetSourcei(source, AL_BUFFERS_PROCESSED, &buffersProcessed);
+	if (buffersProcessed <= 0)
+		return false;
+
+	ALuint alBuffer;
+	alSourceUnqueueBuffers(source, 1, &alBuffer);
+
+	buffer = alBuffer;
+	return true;
+}
+
+} // End of namespace Sound
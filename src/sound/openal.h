@@ -0,0 +1,91 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file sound/openal.h
+ *  Audio output through OpenAL.
+ */
+
+#ifndef SOUND_OPENAL_H
+#define SOUND_OPENAL_H
+
+// Mac OS X has to have this set up separately because of the include
+// path for the OpenAL framework.
+#ifdef MACOSX
+	#include <OpenAL/al.h>
+	#include <OpenAL/alc.h>
+#else
+	#include <AL/al.h>
+	#include <AL/alc.h>
+#endif
+
+#include "sound/output.h"
+
+namespace Sound {
+
+/** Audio output through OpenAL. */
+class OpenALOutput : public Output {
+public:
+	/** Open the default OpenAL device. Throws if that fails. */
+	OpenALOutput();
+	~OpenALOutput();
+
+	bool supportsChannels(int channels) const;
+
+	void setListenerGain(float gain);
+
+	uint32 createSource();
+	void deleteSource(uint32 source);
+
+	void play(uint32 source);
+	void pause(uint32 source);
+
+	bool isPlaying(uint32 source);
+	bool isDone(uint32 source);
+
+	void setGain(uint32 source, float gain);
+	void setPitch(uint32 source, float pitch);
+
+	void setPosition(uint32 source, float x, float y, float z);
+	void getPosition(uint32 source, float &x, float &y, float &z);
+
+	uint32 createBuffer();
+	void deleteBuffer(uint32 buffer);
+
+	bool fillBuffer(uint32 buffer, const int16 *data, uint32 size, int channels, int rate);
+
+	void queueBuffer(uint32 source, uint32 buffer);
+	bool unqueueBuffer(uint32 source, uint32 &buffer);
+
+private:
+	ALCdevice  *_dev;
+	ALCcontext *_ctx;
+
+	bool _hasMultiChannel; ///< Do we have the multi-channel extension?
+	ALenum _format51;      ///< The value for the 5.1 multi-channel format.
+};
+
+} // End of namespace Sound
+
+#endif // SOUND_OPENAL_H
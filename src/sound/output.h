@@ -0,0 +1,110 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file sound/output.h
+ *  An audio output backend.
+ */
+
+#ifndef SOUND_OUTPUT_H
+#define SOUND_OUTPUT_H
+
+#include "common/types.h"
+#include "common/noncopyable.h"
+
+namespace Sound {
+
+/** An audio output backend.
+ *
+ *  Modelled after OpenAL: sounds are played by sources, each playing a
+ *  queue of buffers filled with 16-bit PCM data. Buffers that have been
+ *  played can be taken out of the queue again, to be refilled.
+ *
+ *  The SoundManager only ever calls the output from one thread at a time.
+ */
+class Output : Common::NonCopyable {
+public:
+	virtual ~Output() {}
+
+	/** Can we play sounds with that many channels? */
+	virtual bool supportsChannels(int channels) const = 0;
+
+	/** Set the gain of the listener (= the global master volume). */
+	virtual void setListenerGain(float gain) = 0;
+
+
+	// Sources
+
+	/** Create a new source. */
+	virtual uint32 createSource() = 0;
+	/** Delete a source. */
+	virtual void deleteSource(uint32 source) = 0;
+
+	/** Start or continue playing the source's buffer queue. */
+	virtual void play(uint32 source) = 0;
+	/** Pause the source. */
+	virtual void pause(uint32 source) = 0;
+
+	/** Is the source currently playing? */
+	virtual bool isPlaying(uint32 source) = 0;
+	/** Has the source played all buffers in its queue? */
+	virtual bool isDone(uint32 source) = 0;
+
+	/** Set the source's gain. */
+	virtual void setGain(uint32 source, float gain) = 0;
+	/** Set the source's pitch. */
+	virtual void setPitch(uint32 source, float pitch) = 0;
+
+	/** Set the source's position. */
+	virtual void setPosition(uint32 source, float x, float y, float z) = 0;
+	/** Get the source's position. */
+	virtual void getPosition(uint32 source, float &x, float &y, float &z) = 0;
+
+
+	// Buffers
+
+	/** Create a new buffer. */
+	virtual uint32 createBuffer() = 0;
+	/** Delete a buffer. */
+	virtual void deleteBuffer(uint32 buffer) = 0;
+
+	/** Fill the buffer with data, size bytes of interleaved 16-bit samples. */
+	virtual bool fillBuffer(uint32 buffer, const int16 *data, uint32 size, int channels, int rate) = 0;
+
+	/** Add the buffer to the end of the source's queue. */
+	virtual void queueBuffer(uint32 source, uint32 buffer) = 0;
+	/** Take the first buffer out of the source's queue, if it has been played. */
+	virtual bool unqueueBuffer(uint32 source, uint32 &buffer) = 0;
+
+
+	/** Called regularily from the sound thread.
+	 *
+	 *  @return true if the output wants to be called again right away.
+	 */
+	virtual bool update() { return false; }
+};
+
+} // End of namespace Sound
+
+#endif // SOUND_OUTPUT_H
@@ -0,0 +1,266 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file sound/pcmcache.cpp
+ *  A cache of short sounds, fully decoded into PCM.
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "common/util.h"
+
+#include "sound/audiostream.h"
+#include "sound/pcmcache.h"
+
+namespace Sound {
+
+/** Playing a sound from the cache. */
+class CachedPCMStream : public RewindableAudioStream {
+public:
+	CachedPCMStream(PCMCache &cache, PCMCache::CachedSound &sound) : _cache(&cache), _sound(&sound), _pos(0) {
+	}
+
+	~CachedPCMStream() {
+		_cache->release(*_sound);
+	}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		const int samples = MIN<int>(numSamples, _sound->data.size() - _pos);
+		if (samples <= 0)
+			return 0;
+
+		memcpy(buffer, &_sound->data[_pos], samples * sizeof(int16));
+		_pos += samples;
+
+		return samples;
+	}
+
+	int getChannels() const {
+		return _sound->channels;
+	}
+
+	int getRate() const {
+		return _sound->rate;
+	}
+
+	bool endOfData() const {
+		return _pos >= _sound->data.size();
+	}
+
+	bool rewind() {
+		_pos = 0;
+		return true;
+	}
+
+private:
+	PCMCache *_cache;
+	PCMCache::CachedSound *_sound;
+
+	size_t _pos;
+};
+
+/** Playing a stream, recording its data for the cache along the way. */
+class RecordingPCMStream : public RewindableAudioStream {
+public:
+	RecordingPCMStream(PCMCache &cache, const Common::UString &name, RewindableAudioStream *stream) :
+		_cache(&cache), _name(name), _stream(stream), _recording(true) {
+
+		assert(_stream);
+	}
+
+	~RecordingPCMStream() {
+		delete _stream;
+	}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		const int samples = _stream->readBuffer(buffer, numSamples);
+
+		if (_recording && (samples > 0)) {
+			if (((_data.size() + samples) * sizeof(int16)) > _cache->getMaxSoundSize()) {
+				// Too large for the cache
+				_recording = false;
+				std::vector<int16>().swap(_data);
+			} else
+				_data.insert(_data.end(), buffer, buffer + samples);
+		}
+
+		if (_recording && _stream->endOfStream()) {
+			_cache->add(_name, _data, _stream->getChannels(), _stream->getRate());
+			_recording = false;
+		}
+
+		return samples;
+	}
+
+	int getChannels() const {
+		return _stream->getChannels();
+	}
+
+	int getRate() const {
+		return _stream->getRate();
+	}
+
+	bool endOfData() const {
+		return _stream->endOfData();
+	}
+
+	bool endOfStream() const {
+		return _stream->endOfStream();
+	}
+
+	bool rewind() {
+		// Rewinding before the end would leave a gap in the recording
+		if (_recording) {
+			_recording = false;
+			std::vector<int16>().swap(_data);
+		}
+
+		return _stream->rewind();
+	}
+
+private:
+	PCMCache *_cache;
+	Common::UString _name;
+
+	RewindableAudioStream *_stream;
+
+	bool _recording;
+	std::vector<int16> _data;
+};
+
+
+PCMCache::PCMCache(uint32 maxSize, uint32 maxSoundSize) :
+	_maxSize(maxSize), _maxSoundSize(maxSoundSize), _size(0) {
+
+}
+
+PCMCache::~PCMCache() {
+	// Nobody should be playing anything anymore
+	while (!_sounds.empty())
+		deleteSound(_sounds.begin());
+}
+
+uint32 PCMCache::getMaxSoundSize() const {
+	return _maxSoundSize;
+}
+
+RewindableAudioStream *PCMCache::get(const Common::UString &name) {
+	Common::StackLock lock(_mutex);
+
+	SoundMap::iterator s = _sounds.find(name);
+	if (s == _sounds.end())
+		return 0;
+
+	CachedSound &sound = *s->second;
+
+	// Move the sound to the front of the recently used sounds
+	_lastUse.splice(_lastUse.begin(), _lastUse, sound.lastUse);
+
+	sound.refCount++;
+
+	return new CachedPCMStream(*this, sound);
+}
+
+RewindableAudioStream *PCMCache::record(const Common::UString &name, RewindableAudioStream *stream) {
+	return new RecordingPCMStream(*this, name, stream);
+}
+
+void PCMCache::clear() {
+	Common::StackLock lock(_mutex);
+
+	for (SoundMap::iterator s = _sounds.begin(); s != _sounds.end(); ) {
+		SoundMap::iterator sound = s++;
+
+		if (sound->second->refCount == 0)
+			deleteSound(sound);
+	}
+}
+
+void PCMCache::add(const Common::UString &name, std::vector<int16> &data, int channels, int rate) {
+	Common::StackLock lock(_mutex);
+
+	// Several streams might have recorded the same sound at the same time
+	if (data.empty() || (_sounds.find(name) != _sounds.end()))
+		return;
+
+	CachedSound *sound = new CachedSound;
+
+	sound->name     = name;
+	sound->channels = channels;
+	sound->rate     = rate;
+	sound->refCount = 0;
+
+	sound->data.swap(data);
+
+	_sounds.insert(std::make_pair(name, sound));
+
+	_lastUse.push_front(sound);
+	sound->lastUse = _lastUse.begin();
+
+	_size += sound->data.size() * sizeof(int16);
+
+	evict();
+}
+
+void PCMCache::release(CachedSound &sound) {
+	Common::StackLock lock(_mutex);
+
+	assert(sound.refCount > 0);
+	sound.refCount--;
+
+	evict();
+}
+
+void PCMCache::evict() {
+	// Go through the sounds from least recently used on
+	SoundList::iterator s = _lastUse.end();
+	while ((_size > _maxSize) && (s != _lastUse.begin())) {
+		CachedSound &sound = **--s;
+
+		if (sound.refCount > 0)
+			continue;
+
+		SoundMap::iterator evicted = _sounds.find(sound.name);
+		assert(evicted != _sounds.end());
+
+		// Step past the sound before it's removed from the list
+		++s;
+		deleteSound(evicted);
+	}
+}
+
+void PCMCache::deleteSound(SoundMap::iterator sound) {
+	CachedSound *s = sound->second;
+
+	_size -= s->data.size() * sizeof(int16);
+
+	_lastUse.erase(s->lastUse);
+	_sounds.erase(sound);
+
+	delete s;
+}
+
+} // End of namespace Sound
@@ -0,0 +1,125 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names can be
+ * found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * The Infinity, Aurora, Odyssey, Eclipse and Lycium engines, Copyright (c) BioWare corp.
+ * The Electron engine, Copyright (c) Obsidian Entertainment and BioWare corp.
+ */
+
+/** @file sound/pcmcache.h
+ *  A cache of short sounds, fully decoded into PCM.
+ */
+
+#ifndef SOUND_PCMCACHE_H
+#define SOUND_PCMCACHE_H
+
+#include <vector>
+#include <list>
+#include <map>
+
+#include "common/types.h"
+#include "common/noncopyable.h"
+#include "common/ustring.h"
+#include "common/mutex.h"
+
+namespace Sound {
+
+class RewindableAudioStream;
+
+/** A cache of short sounds, fully decoded into PCM.
+ *
+ *  A sound gets into the cache the first time it is played through
+ *  completely, by recording the samples the decoder produces anyway.
+ *  Playing a cached sound again needs neither the resource nor a
+ *  decoder, just a copy of the samples.
+ *
+ *  Sounds are shared between all streams playing them. The least
+ *  recently played sounds that are not currently playing are evicted
+ *  once the cache grows too large.
+ */
+class PCMCache : Common::NonCopyable {
+public:
+	/** Create a cache holding up to maxSize bytes, of sounds up to maxSoundSize bytes each. */
+	PCMCache(uint32 maxSize, uint32 maxSoundSize);
+	~PCMCache();
+
+	/** Return the maximum size of a single cached sound, in bytes. */
+	uint32 getMaxSoundSize() const;
+
+	/** Return a new stream playing the cached sound, or 0 if the sound is not cached. */
+	RewindableAudioStream *get(const Common::UString &name);
+
+	/** Return a new stream playing this stream, adding its data to the cache once it has been played through.
+	 *
+	 *  The stream will be taken over.
+	 */
+	RewindableAudioStream *record(const Common::UString &name, RewindableAudioStream *stream);
+
+	/** Remove all sounds that are not currently playing. */
+	void clear();
+
+private:
+	struct CachedSound;
+
+	typedef std::list<CachedSound *> SoundList;
+	typedef std::map<Common::UString, CachedSound *> SoundMap;
+
+	/** A decoded sound. */
+	struct CachedSound {
+		Common::UString name; ///< The name the sound is cached under.
+
+		std::vector<int16> data; ///< The decoded samples.
+
+		int channels; ///< Number of channels.
+		int rate;     ///< Sample rate.
+
+		uint32 refCount; ///< Number of streams currently playing the sound.
+
+		SoundList::iterator lastUse; ///< Our place in the list of recently used sounds.
+	};
+
+	uint32 _maxSize;      ///< The maximum size of all cached sounds, in bytes.
+	uint32 _maxSoundSize; ///< The maximum size of a single cached sound, in bytes.
+
+	uint32 _size; ///< The current size of all cached sounds, in bytes.
+
+	SoundMap  _sounds;  ///< All cached sounds, by name.
+	SoundList _lastUse; ///< All cached sounds, most recently used first.
+
+	Common::Mutex _mutex;
+
+	/** Add a fully decoded sound, swapping out the data. */
+	void add(const Common::UString &name, std::vector<int16> &data, int channels, int rate);
+
+	/** A stream stopped playing the sound. */
+	void release(CachedSound &sound);
+
+	/** Evict unused sounds until we're within our size limit again. */
+	void evict();
+
+	void deleteSound(SoundMap::iterator sound);
+
+	friend class CachedPCMStream;
+	friend class RecordingPCMStream;
+};
+
+} // End of namespace Sound
+
+#endif // SOUND_PCMCACHE_H
@@ -29,6 +29,8 @@
 
 #include "sound/sound.h"
 #include "sound/audiostream.h"
+#include "sound/openal.h"
+#include "sound/mixer.h"
 #include "sound/decoders/asf.h"
 #include "sound/decoders/mp3.h"
 #include "sound/decoders/vorbis.h"
@@ -43,22 +45,82 @@
 
 DECLARE_SINGLETON(Sound::SoundManager)
 
-/** Control how many buffers per sound OpenAL will create.
+/** Control how many output buffers per sound we will create.
  *
  *  @note clone2727 says: 5 is just a safe number. Mine only reached a max of 2.
  */
-static const int kOpenALBufferCount = 5;
+static const int kOutputBufferCount = 5;
 
-/** Number of bytes per OpenAL buffer.
+/** Maximum size of all sounds in the decoded sound cache, in bytes. */
+static const uint32 kPCMCacheSize = 32 * 1024 * 1024;
+/** Maximum size of a single sound in the decoded sound cache, in bytes.
  *
- *  @note Needs to be high enough to prevent stuttering, but low enough to
- *        prevent a noticable lag. 32768 seems to work just fine.
+ *  About 6 seconds of 44.1kHz stereo sound, plenty for sound effects.
  */
-static const int kOpenALBufferSize = 32768;
+static const uint32 kPCMCacheSoundSize = 1024 * 1024;
 
 namespace Sound {
 
-SoundManager::SoundManager() : _ready(false), _hasSound(false), _hasMultiChannel(false), _format51(0) {
+/** Decoding the audio streams of several channels, one channel per job. */
+class DecodeJobs : public Common::ThreadPool::Jobs {
+public:
+	DecodeJobs(const std::vector<SoundManager::Channel *> &channels) : _channels(channels) {
+	}
+
+	void runJob(uint n) {
+		SoundManager::Channel &channel = *_channels[n];
+
+		// Decode chunk by chunk, so that stopping the channel never waits long
+		while (!channel.pcm.isFull()) {
+			Common::StackLock lock(channel.decodeMutex);
+
+			if (!channel.stream || !channel.pcm.decode(*channel.stream))
+				break;
+		}
+	}
+
+private:
+	const std::vector<SoundManager::Channel *> &_channels;
+};
+
+
+SoundManager::DecodeAhead::DecodeAhead() : read(0), count(0), endOfData(false), endOfStream(false) {
+	data = new int16[kDecodeAheadCount * (kDecodeAheadSize / 2)];
+}
+
+SoundManager::DecodeAhead::~DecodeAhead() {
+	delete[] data;
+}
+
+bool SoundManager::DecodeAhead::isFull() const {
+	return count >= kDecodeAheadCount;
+}
+
+bool SoundManager::DecodeAhead::decode(AudioStream &stream) {
+	endOfData   = stream.endOfData();
+	endOfStream = stream.endOfStream();
+	if (endOfData || isFull())
+		return false;
+
+	const uint32 chunk = (read + count) % kDecodeAheadCount;
+
+	const int samples = stream.readBuffer(data + chunk * (kDecodeAheadSize / 2), kDecodeAheadSize / 2);
+
+	endOfData   = stream.endOfData();
+	endOfStream = stream.endOfStream();
+	if (samples <= 0)
+		return false;
+
+	size[chunk] = samples * 2;
+	count++;
+
+	return true;
+}
+
+
+SoundManager::SoundManager() : _ready(false), _hasSound(false), _output(0),
+	_pcmCache(kPCMCacheSize, kPCMCacheSoundSize) {
+
 }
 
 void SoundManager::init() {
@@ -71,26 +133,12 @@ void SoundManager::init() {
 	_curChannel = 1;
 	_curID      = 1;
 
-	_dev = alcOpenDevice(0);
-
-	_hasSound = _dev != 0;
-	if (!_hasSound)
-		warning("Failed to open OpenAL device. Disabling sound output");
-
-	_ctx = 0;
-
-	_hasMultiChannel = false;
-	_format51        = 0;
+	createOutput();
 
-	if (_hasSound) {
-		_ctx = alcCreateContext(_dev, 0);
-		alcMakeContextCurrent(_ctx);
-		if (!_ctx)
-			throw Common::Exception("Could not create OpenAL context");
+	_hasSound = _output != 0;
 
-		_hasMultiChannel = alIsExtensionPresent("AL_EXT_MCFORMATS");
-		_format51        = alGetEnumValue("AL_FORMAT_51CHN16");
-	}
+	// One decoder thread per additional core. The sound thread helps out as well
+	_decoders.init(CLIP(SDL_GetCPUCount() - 1, 0, 3));
 
 	if (!createThread())
 		throw Common::Exception("Failed to create sound thread: %s", SDL_GetError());
@@ -113,18 +161,46 @@ void SoundManager::deinit() {
 		return;
 
 	if (!destroyThread())
-		warning("SoundManager::deinit(): Sound thread had to be killed");
+		warning("SoundManager::deinit(): Sound thread took too long to stop");
+
+	_decoders.deinit();
 
 	for (uint16 i = 1; i < kChannelCount; i++)
 		freeChannel(i);
 
-	if (_hasSound) {
-		alcMakeContextCurrent(0);
-		alcDestroyContext(_ctx);
-		alcCloseDevice(_dev);
+	for (std::list<Channel *>::iterator c = _freedChannels.begin(); c != _freedChannels.end(); ++c)
+		delete *c;
+	_freedChannels.clear();
+
+	_pcmCache.clear();
+
+	delete _output;
+	_output = 0;
+
+	_hasSound = false;
+	_ready    = false;
+}
+
+void SoundManager::createOutput() {
+	_output = 0;
+
+	const Common::UString driver = ConfigMan.getString("sounddriver", "openal");
+
+	if (driver.equalsIgnoreCase("mixer")) {
+		// Mix in software, for measuring without an audio device
+		_output = new MixerOutput(ConfigMan.getString("soundfile"), ConfigMan.getBool("soundrealtime", true));
+		return;
 	}
 
-	_ready = false;
+	if (!driver.equalsIgnoreCase("openal"))
+		warning("Unknown sound driver \"%s\", using OpenAL", driver.c_str());
+
+	try {
+		_output = new OpenALOutput;
+	} catch (Common::Exception &e) {
+		e.add("Disabling sound output");
+		Common::printException(e, "WARNING: ");
+	}
 }
 
 bool SoundManager::ready() const {
@@ -170,23 +246,15 @@ bool SoundManager::isPlaying(uint16 channel) const {
 	if (!_hasSound)
 		return true;
 
-	ALint val;
-	alGetSourcei(_channels[channel]->source, AL_SOURCE_STATE, &val);
-
-	if (val != AL_PLAYING) {
-		if (!_channels[channel]->stream || _channels[channel]->stream->endOfStream()) {
-			ALint buffersQueued, buffersProcessed;
-			alGetSourcei(_channels[channel]->source, AL_BUFFERS_QUEUED,    &buffersQueued);
-			alGetSourcei(_channels[channel]->source, AL_BUFFERS_PROCESSED, &buffersProcessed);
-
-			if (buffersQueued == buffersProcessed)
+	if (!_output->isPlaying(_channels[channel]->source)) {
+		if (!_channels[channel]->stream || _channels[channel]->drained)
+			if (_output->isDone(_channels[channel]->source))
 				return false;
-		}
 
-		if (_channels[channel]->state != AL_PLAYING)
+		if (!_channels[channel]->playing)
 			return true;
 
-		alSourcePlay(_channels[channel]->source);
+		_output->play(_channels[channel]->source);
 	}
 
 	return true;
@@ -284,51 +352,45 @@ ChannelHandle SoundManager::playAudioStream(AudioStream *audStream, SoundType ty
 	Channel &channel = *_channels[handle.channel];
 
 	channel.id              = handle.id;
-	channel.state           = AL_PAUSED;
+	channel.playing         = false;
 	channel.stream          = audStream;
 	channel.source          = 0;
 	channel.disposeAfterUse = disposeAfterUse;
 	channel.type            = type;
 	channel.typeIt          = _types[channel.type].list.end();
 	channel.gain            = 1.0;
+	channel.channels        = 0;
+	channel.rate            = 0;
+	channel.decoding        = false;
+	channel.drained         = false;
 
 	try {
 
 		if (!channel.stream)
 			throw Common::Exception("Could not detect stream type");
 
-		ALenum error = AL_NO_ERROR;
-
 		if (_hasSound) {
 			// Create the source
-			alGenSources(1, &channel.source);
-			if ((error = alGetError()) != AL_NO_ERROR)
-				throw Common::Exception("OpenAL error while generating sources: %X", error);
-
-			// Create all needed buffers
-			for (int i = 0; i < kOpenALBufferCount; i++) {
-				ALuint buffer;
+			channel.source = _output->createSource();
 
-				alGenBuffers(1, &buffer);
-				if ((error = alGetError()) != AL_NO_ERROR)
-					throw Common::Exception("OpenAL error while generating buffers: %X", error);
+			// Create all needed buffers. The sound thread will fill them once data is decoded
+			for (int i = 0; i < kOutputBufferCount; i++) {
+				const uint32 buffer = _output->createBuffer();
 
-				if (fillBuffer(channel.source, buffer, channel.stream)) {
-					// If we could fill the buffer with data, queue it
-
-					alSourceQueueBuffers(channel.source, 1, &buffer);
-					if ((error = alGetError()) != AL_NO_ERROR)
-						throw Common::Exception("OpenAL error while queueing buffers: %X", error);
+				channel.freeBuffers.push_back(buffer);
+				channel.buffers.push_back(buffer);
+			}
 
-				} else
-					// If not, put it into our free list
-					channel.freeBuffers.push_back(buffer);
+			channel.channels = channel.stream->getChannels();
+			channel.rate     = channel.stream->getRate();
 
-				channel.buffers.push_back(buffer);
+			if (!_output->supportsChannels(channel.channels)) {
+				warning("SoundManager::playAudioStream(): Unsupported channel count %d", channel.channels);
+				channel.channels = 0;
 			}
 
 			// Set the gain to the current sound type gain
-			alSourcef(channel.source, AL_GAIN, _types[channel.type].gain);
+			_output->setGain(channel.source, _types[channel.type].gain);
 		}
 
 		// Add the channel to the correct type list
@@ -343,14 +405,25 @@ ChannelHandle SoundManager::playAudioStream(AudioStream *audStream, SoundType ty
 	return handle;
 }
 
-ChannelHandle SoundManager::playSoundFile(Common::SeekableReadStream *wavStream, SoundType type, bool loop) {
+ChannelHandle SoundManager::playSoundFile(Common::SeekableReadStream *wavStream, SoundType type,
+                                          bool loop, const Common::UString &cacheName) {
 	checkReady();
 
 	if (!wavStream)
 		throw Common::Exception("No stream");
 
+	// The decoded sound won't get smaller than the encoded one
+	const bool cache = !cacheName.empty() && ((uint32) wavStream->size() <= _pcmCache.getMaxSoundSize());
+
 	AudioStream *audioStream = makeAudioStream(wavStream);
 
+	if (cache) {
+		// Record the decoded data along the way for next time
+		RewindableAudioStream *reAudStream = dynamic_cast<RewindableAudioStream *>(audioStream);
+		if (reAudStream)
+			audioStream = _pcmCache.record(cacheName, reAudStream);
+	}
+
 	if (loop) {
 		RewindableAudioStream *reAudStream = dynamic_cast<RewindableAudioStream *>(audioStream);
 		if (!reAudStream)
@@ -362,6 +435,22 @@ ChannelHandle SoundManager::playSoundFile(Common::SeekableReadStream *wavStream,
 	return playAudioStream(audioStream, type);
 }
 
+ChannelHandle SoundManager::playCachedSound(const Common::UString &name, SoundType type, bool loop) {
+	checkReady();
+
+	RewindableAudioStream *cached = _pcmCache.get(name);
+	if (!cached)
+		return ChannelHandle();
+
+	AudioStream *audioStream = loop ? makeLoopingAudioStream(cached, 0) : cached;
+
+	return playAudioStream(audioStream, type);
+}
+
+void SoundManager::clearSoundCache() {
+	_pcmCache.clear();
+}
+
 SoundManager::Channel *SoundManager::getChannel(const ChannelHandle &handle) {
 	if ((handle.channel == 0) || (handle.id == 0))
 		return 0;
@@ -382,7 +471,7 @@ void SoundManager::startChannel(ChannelHandle &handle) {
 	if (!channel || !channel->stream)
 		throw Common::Exception("Invalid channel");
 
-	channel->state = AL_PLAYING;
+	channel->playing = true;
 
 	triggerUpdate();
 }
@@ -423,7 +512,7 @@ void SoundManager::setListenerGain(float gain) {
 	Common::StackLock lock(_mutex);
 
 	if (_hasSound)
-		alListenerf(AL_GAIN, gain);
+		_output->setListenerGain(gain);
 }
 
 void SoundManager::setChannelPosition(const ChannelHandle &handle, float x, float y, float z) {
@@ -437,7 +526,7 @@ void SoundManager::setChannelPosition(const ChannelHandle &handle, float x, floa
 		throw Common::Exception("Cannot set position of a non-mono sound.");
 
 	if (_hasSound)
-		alSource3f(channel->source, AL_POSITION, x, y, z);
+		_output->setPosition(channel->source, x, y, z);
 }
 
 void SoundManager::getChannelPosition(const ChannelHandle &handle, float &x, float &y, float &z) {
@@ -451,7 +540,7 @@ void SoundManager::getChannelPosition(const ChannelHandle &handle, float &x, flo
 		throw Common::Exception("Cannot get position of a non-mono sound.");
 
 	if (_hasSound)
-		alGetSource3f(channel->source, AL_POSITION, &x, &y, &z);
+		_output->getPosition(channel->source, x, y, z);
 }
 
 void SoundManager::setChannelGain(const ChannelHandle &handle, float gain) {
@@ -464,7 +553,7 @@ void SoundManager::setChannelGain(const ChannelHandle &handle, float gain) {
 	channel->gain = gain;
 
 	if (_hasSound)
-		alSourcef(channel->source, AL_GAIN, _types[channel->type].gain * gain);
+		_output->setGain(channel->source, _types[channel->type].gain * gain);
 }
 
 void SoundManager::setChannelPitch(const ChannelHandle &handle, float pitch) {
@@ -475,7 +564,7 @@ void SoundManager::setChannelPitch(const ChannelHandle &handle, float pitch) {
 		throw Common::Exception("Invalid channel");
 
 	if (_hasSound)
-		alSourcef(channel->source, AL_PITCH, pitch);
+		_output->setPitch(channel->source, pitch);
 }
 
 void SoundManager::setTypeGain(SoundType type, float gain) {
@@ -491,60 +580,23 @@ void SoundManager::setTypeGain(SoundType type, float gain) {
 		assert(*t);
 
 		if (_hasSound)
-			alSourcef((*t)->source, AL_GAIN, (*t)->gain * gain);
+			_output->setGain((*t)->source, (*t)->gain * gain);
 	}
 }
 
-bool SoundManager::fillBuffer(ALuint source, ALuint alBuffer, AudioStream *stream) const {
-	if (!stream)
-		throw Common::Exception("No stream");
-
-	if (!_hasSound)
-		return true;
-
-	if (stream->endOfData())
+bool SoundManager::fillBuffer(Channel &channel, uint32 buffer) {
+	DecodeAhead &pcm = channel.pcm;
+	if (pcm.count == 0)
 		return false;
 
-	ALenum format;
-
-	const int channelCount = stream->getChannels();
-	if        (channelCount == 1) {
-		format = AL_FORMAT_MONO16;
-	} else if (channelCount == 2) {
-		format = AL_FORMAT_STEREO16;
-	} else if (channelCount == 6) {
-		if (!_hasMultiChannel) {
-			warning("SoundManager::fillBuffer(): TODO: !_hasMultiChannel");
-			return false;
-		}
-
-		format = _format51;
-
-	} else {
-		warning("SoundManager::fillBuffer(): Unsupported channel count %d", channelCount);
-		return false;
-	}
+	// The data has already been decoded, the output only needs to copy it
+	const bool filled = _output->fillBuffer(buffer, pcm.data + pcm.read * (kDecodeAheadSize / 2),
+	                                        pcm.size[pcm.read], channel.channels, channel.rate);
 
-	// Read in the required amount of samples
-	uint32 numSamples = kOpenALBufferSize / 2;
+	pcm.read = (pcm.read + 1) % kDecodeAheadCount;
+	pcm.count--;
 
-	byte *buffer = new byte[kOpenALBufferSize];
-	memset(buffer, 0, kOpenALBufferSize);
-	numSamples = stream->readBuffer((int16 *)buffer, numSamples);
-
-	uint32 bufferSize = numSamples * 2;
-
-	alBufferData(alBuffer, format, buffer, bufferSize, stream->getRate());
-
-	delete[] buffer;
-
-	ALenum error = alGetError();
-	if (error != AL_NO_ERROR) {
-		warning("OpenAL error while filling buffer: 0x%X", error);
-		return false;
-	}
-
-	return true;
+	return filled;
 }
 
 void SoundManager::bufferData(uint16 channel) {
@@ -555,35 +607,73 @@ void SoundManager::bufferData(uint16 channel) {
 }
 
 void SoundManager::bufferData(Channel &channel) {
-	if (!channel.stream || channel.stream->endOfData())
+	if (!channel.stream || channel.drained)
 		return;
 
 	if (!_hasSound)
 		return;
 
-	// Get the number of buffers that have been processed
-	ALint buffersProcessed;
-	alGetSourcei(channel.source, AL_BUFFERS_PROCESSED, &buffersProcessed);
+	// Nothing we could play
+	if (channel.channels == 0) {
+		channel.drained = true;
+		return;
+	}
 
 	// Pull all processed buffers from the queue and put them into our free list
-	while (buffersProcessed--) {
-		ALuint alBuffer;
+	uint32 processed;
+	while (_output->unqueueBuffer(channel.source, processed))
+		channel.freeBuffers.push_back(processed);
 
-		alSourceUnqueueBuffers(channel.source, 1, &alBuffer);
-
-		channel.freeBuffers.push_back(alBuffer);
-	}
-
-	// Buffer as long as we still have data and free buffers
-	std::list<ALuint>::iterator buffer = channel.freeBuffers.begin();
+	// Buffer as long as we still have decoded data and free buffers
+	std::list<uint32>::iterator buffer = channel.freeBuffers.begin();
 	while (buffer != channel.freeBuffers.end()) {
-		if (!fillBuffer(channel.source, *buffer, channel.stream))
+		if (!fillBuffer(channel, *buffer))
 			break;
 
-		alSourceQueueBuffers(channel.source, 1, &*buffer);
+		_output->queueBuffer(channel.source, *buffer);
 
 		buffer = channel.freeBuffers.erase(buffer);
 	}
+
+	// Everything the stream will ever give us is now in the output's hands
+	if ((channel.pcm.count == 0) && channel.pcm.endOfStream)
+		channel.drained = true;
+}
+
+void SoundManager::decodeData() {
+	// Collect all channels that have room for more decoded data
+	{
+		Common::StackLock lock(_mutex);
+
+		if (!_hasSound)
+			return;
+
+		_decodeChannels.clear();
+		for (int i = 1; i < kChannelCount; i++) {
+			Channel *channel = _channels[i];
+			if (!channel || !channel->stream || (channel->channels == 0) || channel->drained || channel->pcm.isFull())
+				continue;
+
+			channel->decoding = true;
+			_decodeChannels.push_back(channel);
+		}
+	}
+
+	// Decode without holding the manager mutex, so that nobody has to wait for us
+	DecodeJobs decode(_decodeChannels);
+	_decoders.run(decode, _decodeChannels.size());
+
+	Common::StackLock lock(_mutex);
+
+	for (std::vector<Channel *>::iterator c = _decodeChannels.begin(); c != _decodeChannels.end(); ++c)
+		(*c)->decoding = false;
+
+	_decodeChannels.clear();
+
+	// Now we can safely delete channels that were freed while decoding
+	for (std::list<Channel *>::iterator c = _freedChannels.begin(); c != _freedChannels.end(); ++c)
+		delete *c;
+	_freedChannels.clear();
 }
 
 void SoundManager::checkReady() {
@@ -591,22 +681,24 @@ void SoundManager::checkReady() {
 		throw Common::Exception("SoundManager not ready");
 }
 
-void SoundManager::update() {
+bool SoundManager::update() {
+	decodeData();
+
 	Common::StackLock lock(_mutex);
 
 	for (int i = 1; i < kChannelCount; i++) {
 		if (!_channels[i])
 			continue;
 
-		// Free the channel if it is no longer playing
-		if (!isPlaying(i)) {
-			freeChannel(i);
-			continue;
-		}
-
 		// Try to buffer some more data
 		bufferData(i);
+
+		// Free the channel if it is no longer playing
+		if (!isPlaying(i))
+			freeChannel(i);
 	}
+
+	return _hasSound && _output->update();
 }
 
 ChannelHandle SoundManager::newChannel() {
@@ -639,17 +731,13 @@ void SoundManager::pauseChannel(Channel *channel, bool pause) {
 	if (!channel || channel->id == 0)
 		return;
 
-	ALenum error = AL_NO_ERROR;
 	if (pause) {
-		if (_hasSound) {
-			alSourcePause(channel->source);
-			if ((error = alGetError()) != AL_NO_ERROR)
-				warning("OpenAL error while attempting to pause: %X", error);
-		}
+		if (_hasSound)
+			_output->pause(channel->source);
 
-		channel->state = AL_PAUSED;
+		channel->playing = false;
 	} else
-		channel->state = AL_PLAYING;
+		channel->playing = true;
 
 	triggerUpdate();
 }
@@ -674,34 +762,46 @@ void SoundManager::freeChannel(uint16 channel) {
 		// Nothing to do
 		return;
 
+	// Take the stream away from the decoder. This waits for a chunk currently being decoded
+	AudioStream *stream = 0;
+	{
+		Common::StackLock lock(c->decodeMutex);
+
+		stream    = c->stream;
+		c->stream = 0;
+	}
+
 	// Discard the stream, if requested
 	if (c->disposeAfterUse)
-		delete c->stream;
+		delete stream;
 
 	if (_hasSound) {
-		// Delete the channel's OpenAL source
+		// Delete the channel's output source
 		if (c->source)
-			alDeleteSources(1, &c->source);
+			_output->deleteSource(c->source);
 
-		// Delete the OpenAL buffers
-		for (std::list<ALuint>::iterator buffer = c->buffers.begin(); buffer != c->buffers.end(); ++buffer)
-			alDeleteBuffers(1, &*buffer);
+		// Delete the output buffers
+		for (std::list<uint32>::iterator buffer = c->buffers.begin(); buffer != c->buffers.end(); ++buffer)
+			_output->deleteBuffer(*buffer);
 	}
 
 	// Remove the channel from the type list
 	if (c->typeIt != _types[c->type].list.end())
 		_types[c->type].list.erase(c->typeIt);
 
-	// And finally delete the channel itself
-	delete c;
 	_channels[channel] = 0;
+
+	// And finally delete the channel itself, unless a decoder job still holds on to it
+	if (c->decoding)
+		_freedChannels.push_back(c);
+	else
+		delete c;
 }
 
 void SoundManager::threadMethod() {
-	while (!_killThread) {
-		update();
-		_needUpdate.wait(100);
-	}
+	while (!_killThread)
+		if (!update())
+			_needUpdate.wait(100);
 }
 
 } // End of namespace Sound
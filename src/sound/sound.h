@@ -30,16 +30,6 @@
 #ifndef SOUND_SOUND_H
 #define SOUND_SOUND_H
 
-// Mac OS X has to have this set up separately because of the include
-// path for the OpenAL framework.
-#ifdef MACOSX
-	#include <OpenAL/al.h>
-	#include <OpenAL/alc.h>
-#else
-	#include <AL/al.h>
-	#include <AL/alc.h>
-#endif
-
 #include <vector>
 #include <list>
 
@@ -47,8 +37,10 @@
 #include "common/singleton.h"
 #include "common/thread.h"
 #include "common/mutex.h"
+#include "common/threadpool.h"
 
 #include "sound/types.h"
+#include "sound/pcmcache.h"
 
 namespace Common {
 	class SeekableReadStream;
@@ -57,6 +49,8 @@ namespace Common {
 namespace Sound {
 
 class AudioStream;
+class DecodeJobs;
+class Output;
 
 /** The sound manager. */
 class SoundManager : public Common::Singleton<SoundManager>, public Common::Thread {
@@ -90,13 +84,34 @@ public:
 	 *  This only allocate a channel for the sound, to actually start playing it,
 	 *  call startChannel().
 	 *
+	 *  If a cache name is given and the sound is short enough, its decoded
+	 *  data will be kept in memory, to be played with playCachedSound().
+	 *
 	 *  @param  wavStream The stream to play. Will be taken over.
 	 *  @param  type The type of the sound.
 	 *  @param  loop Should the sound loop?
+	 *  @param  cacheName The name to cache the decoded sound under.
 	 *  @return The channel the sound has been assigned to, or -1 on error.
 	 */
 	ChannelHandle playSoundFile(Common::SeekableReadStream *wavStream,
-	                            SoundType type, bool loop = false);
+	                            SoundType type, bool loop = false,
+	                            const Common::UString &cacheName = "");
+
+	/** Play a sound from the decoded sound cache.
+	 *
+	 *  This only allocate a channel for the sound, to actually start playing it,
+	 *  call startChannel().
+	 *
+	 *  @param  name The name the sound was cached under.
+	 *  @param  type The type of the sound.
+	 *  @param  loop Should the sound loop?
+	 *  @return The channel the sound has been assigned to, or an invalid
+	 *          channel if the sound is not in the cache.
+	 */
+	ChannelHandle playCachedSound(const Common::UString &name, SoundType type, bool loop = false);
+
+	/** Drop all decoded sounds from the cache that are not currently playing. */
+	void clearSoundCache();
 
 	/** Play an audio stream.
 	 *
@@ -162,6 +177,16 @@ public:
 private:
 	static const int kChannelCount = 65535; ///< Maximal number of channels.
 
+	/** Number of PCM chunks decoded ahead per channel. */
+	static const int kDecodeAheadCount = 5;
+
+	/** Number of bytes per decoded PCM chunk, and therefore per output buffer.
+	 *
+	 *  @note Needs to be high enough to prevent stuttering, but low enough to
+	 *        prevent a noticable lag. 32768 seems to work just fine.
+	 */
+	static const int kDecodeAheadSize = 32768;
+
 	struct Channel;
 	typedef std::list<Channel *> TypeList;
 
@@ -171,19 +196,53 @@ private:
 		TypeList list; ///< The list of channels for that type.
 	};
 
+	/** A ring of PCM chunks decoded ahead of time.
+	 *
+	 *  Only a decoder job fills the ring, and only the sound thread empties
+	 *  it, never at the same time. The ring therefore needs no locking.
+	 */
+	struct DecodeAhead {
+		int16 *data; ///< kDecodeAheadCount chunks of kDecodeAheadSize bytes each.
+
+		uint32 size[kDecodeAheadCount]; ///< Number of bytes in each chunk.
+
+		uint32 read;  ///< The next chunk to hand to the output.
+		uint32 count; ///< Number of decoded chunks in the ring.
+
+		bool endOfData;   ///< Did the stream run out of data while decoding?
+		bool endOfStream; ///< Did the stream end while decoding?
+
+		DecodeAhead();
+		~DecodeAhead();
+
+		bool isFull() const;
+
+		/** Decode one chunk from the stream into the ring. */
+		bool decode(AudioStream &stream);
+	};
+
 	/** A sound channel. */
 	struct Channel {
 		uint32 id; ///< The channel's ID.
 
-		ALint state; ///< The sound's state.
+		bool playing; ///< Should the sound be playing?
 
 		AudioStream *stream;  ///< The actual audio stream.
 		bool disposeAfterUse; ///< Delete the audio stream when done playing?
 
-		ALuint source; ///< OpenAL source for this channel.
+		uint32 source; ///< Output source for this channel.
+
+		std::list<uint32> buffers;     ///< List of buffers for that channel.
+		std::list<uint32> freeBuffers; ///< List of free buffers not filled with data.
+
+		int channels; ///< Number of channels of the decoded data, 0 if unsupported.
+		int rate;     ///< The sample rate of the decoded data.
+
+		DecodeAhead pcm;            ///< The data decoded ahead of time.
+		Common::Mutex decodeMutex;  ///< Protects the stream while it's being decoded.
 
-		std::list<ALuint> buffers;     ///< List of buffers for that channel.
-		std::list<ALuint> freeBuffers; ///< List of free buffers not filled with data.
+		bool decoding; ///< Is the channel part of the current decoding batch?
+		bool drained;  ///< Has all the stream's data been handed to the output?
 
 		SoundType type;            ///< The channel's sound type.
 		TypeList::iterator typeIt; ///< Iterator into the type list.
@@ -195,8 +254,7 @@ private:
 
 	bool _hasSound; //< Do we have working sound output?
 
-	bool _hasMultiChannel; ///< Do we have the multi-channel extension?
-	ALenum _format51; ///< The value for the 5.1 multi-channel format.
+	Output *_output; ///< The audio output backend.
 
 	Channel *_channels[kChannelCount]; ///< The sound channels.
 	Type     _types   [kSoundTypeMAX]; ///< The sound types.
@@ -206,26 +264,39 @@ private:
 
 	Common::Mutex _mutex;
 
+	Common::ThreadPool _decoders;  ///< Decodes the audio streams of the channels.
+
+	PCMCache _pcmCache; ///< Short sounds, already decoded.
+
+	std::vector<Channel *> _decodeChannels; ///< The channels in the current decoding batch.
+	std::list<Channel *>   _freedChannels;  ///< Freed channels still in the decoding batch.
+
 	/** Condition to signal that an update is needed. */
 	Common::Condition _needUpdate;
 
-	ALCdevice *_dev;
-	ALCcontext *_ctx;
-
 	/** Check that the SoundManager was properly initialized. */
 	void checkReady();
 
-	/** Update the sound information. Called regularily from within the thread method. */
-	void update();
+	/** Update the sound information. Called regularily from within the thread method.
+	 *
+	 *  @return true if the update should be repeated right away.
+	 */
+	bool update();
+
+	/** Create the output backend the config asks for. */
+	void createOutput();
 
 	/** Look for a free place in the channel vector. */
 	ChannelHandle newChannel();
 
-	/** Buffer more sound from the channel to the OpenAL buffers. */
+	/** Hand the data decoded ahead of time to the channel's output buffers. */
 	void bufferData(Channel &channel);
-	/** Buffer more sound from the channel to the OpenAL buffers. */
+	/** Hand the data decoded ahead of time to the channel's output buffers. */
 	void bufferData(uint16 channel);
 
+	/** Decode more data for all channels that need it, without holding the manager mutex. */
+	void decodeData();
+
 	/** Is that channel currently playing a sound? */
 	bool isPlaying(uint16 channel) const;
 
@@ -244,8 +315,10 @@ private:
 
 	static AudioStream *makeAudioStream(Common::SeekableReadStream *stream);
 
-	/** Fill the buffer with data from the audio stream. */
-	bool fillBuffer(ALuint source, ALuint alBuffer, AudioStream *stream) const;
+	friend class DecodeJobs;
+
+	/** Fill the buffer with the next chunk of decoded data. */
+	bool fillBuffer(Channel &channel, uint32 buffer);
 };
 
 } // End of namespace Sound
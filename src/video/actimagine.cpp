@@ -46,7 +46,7 @@ ActimagineDecoder::~ActimagineDecoder() {
 	delete _vx;
 }
 
-uint32 ActimagineDecoder::getTimeToNextFrame() const {
+uint32 ActimagineDecoder::getNextFrameTime() const {
 	return 0;
 }
 
@@ -44,9 +44,9 @@ public:
 	ActimagineDecoder(Common::SeekableReadStream *vx);
 	~ActimagineDecoder();
 
-	uint32 getTimeToNextFrame() const;
-
 protected:
+	uint32 getNextFrameTime() const;
+
 	void startVideo();
 	void processData();
 
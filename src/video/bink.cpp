@@ -32,13 +32,19 @@
 
 #include <cmath>
 
+#include "common/system.h"
+
+#ifdef XOREOS_SSE2
+	#include <emmintrin.h>
+#endif
+
 #include "common/util.h"
 #include "common/error.h"
 #include "common/maths.h"
 #include "common/stream.h"
 #include "common/file.h"
 #include "common/ustring.h"
-#include "common/bitstream.h"
+#include "common/bitreader.h"
 #include "common/huffman.h"
 #include "common/rdft.h"
 #include "common/dct.h"
@@ -53,8 +59,6 @@
 #include "video/bink.h"
 #include "video/binkdata.h"
 
-#include "events/events.h"
-
 static const uint32 kBIKfID = MKTAG('B', 'I', 'K', 'f');
 static const uint32 kBIKgID = MKTAG('B', 'I', 'K', 'g');
 static const uint32 kBIKhID = MKTAG('B', 'I', 'K', 'h');
@@ -142,33 +146,14 @@ Bink::~Bink() {
 	delete _bink;
 }
 
-uint32 Bink::getTimeToNextFrame() const {
-	if (!_started)
-		return 0;
-
-	uint32 curTime   = EventMan.getTimestamp() - _startTime;
-	uint32 frameTime = ((uint64) (_curFrame * 1000 * ((uint64) _fpsDen))) / _fpsNum;
-
-	// We need the next frame now
-	if (frameTime <= curTime)
-		return 0;
-
-	// We need the next frame later
-	return frameTime - curTime;
+uint32 Bink::getNextFrameTime() const {
+	return ((uint64) (_curFrame * 1000 * ((uint64) _fpsDen))) / _fpsNum;
 }
 
 void Bink::startVideo() {
-	uint32 curTime = EventMan.getTimestamp();
-
-	_startTime     = curTime;
-	_lastFrameTime = curTime;
-	_started       = true;
 }
 
 void Bink::processData() {
-	if (getTimeToNextFrame() > 0)
-		return;
-
 	if (_curFrame >= _frames.size()) {
 		finish();
 		return;
@@ -192,8 +177,7 @@ void Bink::processData() {
 			throw Common::Exception("Audio packet too big for the frame");
 
 		if (audioPacketLength >= 4) {
-			uint32 audioPacketStart = _bink->pos();
-			uint32 audioPacketEnd   = _bink->pos() + audioPacketLength;
+			uint32 audioPacketEnd = _bink->pos() + audioPacketLength;
 
 			if (i == _audioTrack) {
 				// Only play one audio track
@@ -201,9 +185,7 @@ void Bink::processData() {
 				//                  Number of samples in bytes
 				audio.sampleCount = _bink->readUint32LE() / (2 * audio.channels);
 
-				audio.bits =
-					new Common::BitStream32LELSB(new Common::SeekableSubReadStream(_bink,
-					    audioPacketStart + 4, audioPacketEnd), true);
+				audio.bits = new Common::BitReader32LELSB(*_bink, audioPacketLength - 4);
 
 				audioPacket(audio);
 
@@ -217,12 +199,7 @@ void Bink::processData() {
 		}
 	}
 
-	uint32 videoPacketStart = _bink->pos();
-	uint32 videoPacketEnd   = _bink->pos() + frameSize;
-
-	frame.bits =
-		new Common::BitStream32LELSB(new Common::SeekableSubReadStream(_bink,
-		    videoPacketStart, videoPacketEnd), true);
+	frame.bits = new Common::BitReader32LELSB(*_bink, frameSize);
 
 	videoPacket(frame);
 
@@ -929,11 +906,7 @@ void Bink::blockResidue(DecodeContext &ctx) {
 
 	readResidue(*ctx.video, block, v);
 
-	byte  *dst = ctx.dest;
-	int16 *src = block;
-	for (int i = 0; i < 8; i++, dst += ctx.pitch, src += 8)
-		for (int j = 0; j < 8; j++)
-			dst[j] += src[j];
+	addBlock(ctx, block);
 }
 
 void Bink::blockIntra(DecodeContext &ctx) {
@@ -1586,7 +1559,143 @@ static inline void IDCTCol(int16 *dest, const int16 *src)
 	}
 }
 
+#ifdef XOREOS_SSE2
+/** A vector of pairs of 16-bit constants, to multiply interleaved pairs with. */
+static inline __m128i pairSSE2(int16 a, int16 b) {
+	return _mm_set1_epi32((int32) (((uint32) (uint16) b << 16) | (uint16) a));
+}
+
+/** IDCT_TRANSFORM, on 4 columns at once.
+ *
+ *  Every multiplication in the transform is of a sum or difference of two
+ *  inputs, so pmaddwd on interleaved input pairs yields exact 32-bit results.
+ */
+static FORCEINLINE void IDCTTransformSSE2(__m128i p04, __m128i p26, __m128i p53, __m128i p17, __m128i *d) {
+	const __m128i add = pairSSE2(1,  1);
+	const __m128i sub = pairSSE2(1, -1);
+
+	const __m128i a0 = _mm_madd_epi16(p04, add);
+	const __m128i a1 = _mm_madd_epi16(p04, sub);
+	const __m128i a2 = _mm_madd_epi16(p26, add);
+	const __m128i a3 = _mm_srai_epi32(_mm_madd_epi16(p26, pairSSE2(A1, -A1)), 11);
+	const __m128i a4 = _mm_madd_epi16(p53, add);
+	const __m128i a6 = _mm_madd_epi16(p17, add);
+
+	const __m128i b0 = _mm_add_epi32(a4, a6);
+	const __m128i b1 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p53, pairSSE2( A3, -A3)),
+	                                                _mm_madd_epi16(p17, pairSSE2( A3, -A3))), 11);
+	const __m128i b2 = _mm_add_epi32(_mm_sub_epi32(_mm_srai_epi32(_mm_madd_epi16(p53, pairSSE2(A4, -A4)), 11), b0), b1);
+	const __m128i b3 = _mm_sub_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p17, pairSSE2( A1,  A1)),
+	                                                              _mm_madd_epi16(p53, pairSSE2(-A1, -A1))), 11), b2);
+	const __m128i b4 = _mm_sub_epi32(_mm_add_epi32(_mm_srai_epi32(_mm_madd_epi16(p17, pairSSE2(A2, -A2)), 11), b3), b1);
+
+	const __m128i a0a2 = _mm_add_epi32(a0, a2);
+	const __m128i a0s2 = _mm_sub_epi32(a0, a2);
+	const __m128i a1a3 = _mm_sub_epi32(_mm_add_epi32(a1, a3), a2);
+	const __m128i a1s3 = _mm_add_epi32(_mm_sub_epi32(a1, a3), a2);
+
+	d[0] = _mm_add_epi32(a0a2, b0);
+	d[1] = _mm_add_epi32(a1a3, b2);
+	d[2] = _mm_add_epi32(a1s3, b3);
+	d[3] = _mm_sub_epi32(a0s2, b4);
+	d[4] = _mm_add_epi32(a0s2, b4);
+	d[5] = _mm_sub_epi32(a1s3, b3);
+	d[6] = _mm_sub_epi32(a1a3, b2);
+	d[7] = _mm_sub_epi32(a0a2, b0);
+}
+
+/** Wrap 32-bit values around to 16 bits, like a cast, and pack them. */
+static inline __m128i wrap16SSE2(__m128i left, __m128i right) {
+	left  = _mm_srai_epi32(_mm_slli_epi32(left , 16), 16);
+	right = _mm_srai_epi32(_mm_slli_epi32(right, 16), 16);
+
+	return _mm_packs_epi32(left, right);
+}
+
+/** Wrap 16-bit values around to 8 bits, like a cast, and pack them. */
+static inline __m128i wrap8SSE2(__m128i x) {
+	x = _mm_and_si128(x, _mm_set1_epi16(0xFF));
+
+	return _mm_packus_epi16(x, x);
+}
+
+/** IDCT_TRANSFORM, on 8 columns of 16-bit values, with 16-bit results. */
+static FORCEINLINE void IDCTTransformSSE2(__m128i *v, bool mungeRow) {
+	__m128i left[8], right[8];
+
+	IDCTTransformSSE2(_mm_unpacklo_epi16(v[0], v[4]), _mm_unpacklo_epi16(v[2], v[6]),
+	                  _mm_unpacklo_epi16(v[5], v[3]), _mm_unpacklo_epi16(v[1], v[7]), left);
+	IDCTTransformSSE2(_mm_unpackhi_epi16(v[0], v[4]), _mm_unpackhi_epi16(v[2], v[6]),
+	                  _mm_unpackhi_epi16(v[5], v[3]), _mm_unpackhi_epi16(v[1], v[7]), right);
+
+	const __m128i round = _mm_set1_epi32(0x7F);
+
+	for (int i = 0; i < 8; i++) {
+		if (mungeRow) {
+			left [i] = _mm_srai_epi32(_mm_add_epi32(left [i], round), 8);
+			right[i] = _mm_srai_epi32(_mm_add_epi32(right[i], round), 8);
+		}
+
+		v[i] = wrap16SSE2(left[i], right[i]);
+	}
+}
+
+/** Transpose an 8x8 matrix of 16-bit values. */
+static inline void transposeSSE2(__m128i *v) {
+	const __m128i a0 = _mm_unpacklo_epi16(v[0], v[1]);
+	const __m128i a1 = _mm_unpackhi_epi16(v[0], v[1]);
+	const __m128i a2 = _mm_unpacklo_epi16(v[2], v[3]);
+	const __m128i a3 = _mm_unpackhi_epi16(v[2], v[3]);
+	const __m128i a4 = _mm_unpacklo_epi16(v[4], v[5]);
+	const __m128i a5 = _mm_unpackhi_epi16(v[4], v[5]);
+	const __m128i a6 = _mm_unpacklo_epi16(v[6], v[7]);
+	const __m128i a7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+	const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+	const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+	const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+	const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+	v[0] = _mm_unpacklo_epi64(b0, b4);
+	v[1] = _mm_unpackhi_epi64(b0, b4);
+	v[2] = _mm_unpacklo_epi64(b1, b5);
+	v[3] = _mm_unpackhi_epi64(b1, b5);
+	v[4] = _mm_unpacklo_epi64(b2, b6);
+	v[5] = _mm_unpackhi_epi64(b2, b6);
+	v[6] = _mm_unpacklo_epi64(b3, b7);
+	v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/** The whole IDCT of a block, into 8 rows of 16-bit values.
+ *
+ *  Like the scalar IDCT, the intermediate values are wrapped to 16 bits.
+ */
+static void IDCTSSE2(const int16 *block, __m128i *rows) {
+	for (int i = 0; i < 8; i++)
+		rows[i] = _mm_loadu_si128((const __m128i *) (block + 8 * i));
+
+	// The columns are transformed across the rows, 8 at a time
+	IDCTTransformSSE2(rows, false);
+
+	// The rows are transformed after turning them into columns
+	transposeSSE2(rows);
+	IDCTTransformSSE2(rows, true);
+	transposeSSE2(rows);
+}
+#endif
+
 void Bink::IDCT(int16 *block) {
+#ifdef XOREOS_SSE2
+	__m128i rows[8];
+	IDCTSSE2(block, rows);
+
+	for (int i = 0; i < 8; i++)
+		_mm_storeu_si128((__m128i *) (block + 8 * i), rows[i]);
+#else
 	int i;
 	int16 temp[64];
 
@@ -1595,19 +1704,41 @@ void Bink::IDCT(int16 *block) {
 	for (i = 0; i < 8; i++) {
 		IDCT_ROW( (&block[8*i]), (&temp[8*i]) );
 	}
+#endif
 }
 
-void Bink::IDCTAdd(DecodeContext &ctx, int16 *block) {
-	int i, j;
-
-	IDCT(block);
+void Bink::addBlock(DecodeContext &ctx, const int16 *block) {
 	byte *dest = ctx.dest;
-	for (i = 0; i < 8; i++, dest += ctx.pitch, block += 8)
-		for (j = 0; j < 8; j++)
+
+#ifdef XOREOS_SSE2
+	const __m128i zero = _mm_setzero_si128();
+
+	for (int i = 0; i < 8; i++, dest += ctx.pitch, block += 8) {
+		const __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) dest), zero);
+		const __m128i b = _mm_loadu_si128((const __m128i *) block);
+
+		_mm_storel_epi64((__m128i *) dest, wrap8SSE2(_mm_add_epi16(d, b)));
+	}
+#else
+	for (int i = 0; i < 8; i++, dest += ctx.pitch, block += 8)
+		for (int j = 0; j < 8; j++)
 			 dest[j] += block[j];
+#endif
+}
+
+void Bink::IDCTAdd(DecodeContext &ctx, int16 *block) {
+	IDCT(block);
+	addBlock(ctx, block);
 }
 
 void Bink::IDCTPut(DecodeContext &ctx, int16 *block) {
+#ifdef XOREOS_SSE2
+	__m128i rows[8];
+	IDCTSSE2(block, rows);
+
+	for (int i = 0; i < 8; i++)
+		_mm_storel_epi64((__m128i *) (ctx.dest + i * ctx.pitch), wrap8SSE2(rows[i]));
+#else
 	int i;
 	int16 temp[64];
 	for (i = 0; i < 8; i++)
@@ -1615,6 +1746,7 @@ void Bink::IDCTPut(DecodeContext &ctx, int16 *block) {
 	for (i = 0; i < 8; i++) {
 		IDCT_ROW( (&ctx.dest[i*ctx.pitch]), (&temp[8*i]) );
 	}
+#endif
 }
 
 } // End of namespace Video
@@ -36,12 +36,12 @@
 #include <vector>
 
 #include "common/types.h"
+#include "common/bitreader.h"
 
 #include "video/decoder.h"
 
 namespace Common {
 	class SeekableReadStream;
-	class BitStream;
 	class Huffman;
 
 	class RDFT;
@@ -56,9 +56,9 @@ public:
 	Bink(Common::SeekableReadStream *bink);
 	~Bink();
 
-	uint32 getTimeToNextFrame() const;
-
 protected:
+	uint32 getNextFrameTime() const;
+
 	void startVideo();
 	void processData();
 
@@ -134,7 +134,7 @@ private:
 
 		uint32 sampleCount;
 
-		Common::BitStream *bits;
+		Common::BitReader32LELSB *bits;
 
 		bool first;
 
@@ -167,7 +167,7 @@ private:
 		uint32 offset;
 		uint32 size;
 
-		Common::BitStream *bits;
+		Common::BitReader32LELSB *bits;
 
 		VideoFrame();
 		~VideoFrame();
@@ -214,9 +214,6 @@ private:
 	uint32 _curFrame; ///< Current Frame.
 	uint32 _audioFrame;
 
-	uint32 _startTime;     ///< Timestamp of when the video was started.
-	uint32 _lastFrameTime; ///< Timestamp of when the last frame was decoded.
-
 	std::vector<AudioTrack> _audioTracks; ///< All audio tracks.
 	std::vector<VideoFrame> _frames;      ///< All video frames.
 
@@ -310,12 +307,13 @@ private:
 
 	void readAudioCoeffs(AudioTrack &audio, float *coeffs);
 
-	void floatToInt16Interleave(int16 *dst, const float **src, uint32 length, uint8 channels);
-
 	// Bink video IDCT
 	void IDCT(int16 *block);
 	void IDCTPut(DecodeContext &ctx, int16 *block);
 	void IDCTAdd(DecodeContext &ctx, int16 *block);
+
+	/** Add the residue in block to the destination block. */
+	void addBlock(DecodeContext &ctx, const int16 *block);
 };
 
 } // End of namespace Video
@@ -35,7 +35,7 @@
 #include "common/util.h"
 #include "common/error.h"
 #include "common/stream.h"
-#include "common/bitstream.h"
+#include "common/bitreader.h"
 #include "common/huffman.h"
 
 #include "graphics/yuv_to_rgb.h"
@@ -96,7 +96,7 @@ void XMVWMV2Codec::CBP::decode(uint32 cbp, const CBP &topLeft, const CBP &top,
 }
 
 
-XMVWMV2Codec::DecodeContext::DecodeContext(Common::BitStream &b) : bits(b),
+XMVWMV2Codec::DecodeContext::DecodeContext(Common::BitReader32LEMSB &b) : bits(b),
 	hasACPerMacroBlock(false), hasACPrediction(false),
 	acRLERunLength(0), acRLELevelLength(0) {
 
@@ -319,7 +319,7 @@ void XMVWMV2Codec::init() {
 void XMVWMV2Codec::decodeFrame(Graphics::Surface &surface,
                                Common::SeekableReadStream &dataStream) {
 
-	Common::BitStream32LEMSB bits(dataStream);
+	Common::BitReader32LEMSB bits(dataStream, dataStream.size() - dataStream.pos());
 	DecodeContext            ctx(bits);
 
 	initDecodeContext(ctx);
@@ -809,7 +809,7 @@ void XMVWMV2Codec::IDCTCol(int32 *b) {
 	b[8 * 7] = (a0 + a2 - a1 - a5 + (1 << 13)) >> 14;
 }
 
-uint8 XMVWMV2Codec::getTrit(Common::BitStream &bits) {
+uint8 XMVWMV2Codec::getTrit(Common::BitReader32LEMSB &bits) {
 	// 0 -> 0;  10 -> 1;  11 -> 2
 
 	uint8 n = bits.getBit();
@@ -31,11 +31,11 @@
 #define VIDEO_CODECS_XMVWMV2_H
 
 #include "common/types.h"
+#include "common/bitreader.h"
 
 #include "video/codecs/codec.h"
 
 namespace Common {
-	class BitStream;
 	class Huffman;
 }
 
@@ -109,7 +109,7 @@ private:
 
 	/** Context for decoding a frame. */
 	struct DecodeContext {
-		Common::BitStream &bits;
+		Common::BitReader32LEMSB &bits;
 
 		int32 qScale;
 		int32 dcStepSize;
@@ -138,7 +138,7 @@ private:
 		BlockContext block[6];
 
 
-		DecodeContext(Common::BitStream &b);
+		DecodeContext(Common::BitReader32LEMSB &b);
 
 		/** Set the quantizer scale and calculate the DC step size and default predictor. */
 		void setQScale(int32 qS);
@@ -232,7 +232,7 @@ private:
 	void decodeIBlock(DecodeContext &ctx, BlockContext &block);
 
 	/** Decode a "tri-state". */
-	static uint8 getTrit(Common::BitStream &bits);
+	static uint8 getTrit(Common::BitReader32LEMSB &bits);
 
 	// IDCT
 
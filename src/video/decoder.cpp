@@ -32,6 +32,7 @@
 #include "common/error.h"
 #include "common/stream.h"
 #include "common/threads.h"
+#include "common/util.h"
 
 #include "graphics/graphics.h"
 
@@ -43,11 +44,18 @@
 #include "sound/audiostream.h"
 #include "sound/decoders/pcm.h"
 
+#include "events/events.h"
+
 namespace Video {
 
+VideoDecoder::Frame::Frame(Graphics::Surface *s, uint32 t) : surface(s), time(t) {
+}
+
+
 VideoDecoder::VideoDecoder() : Renderable(Graphics::kRenderableTypeVideo),
 	_started(false), _finished(false), _needCopy(false),
-	_width(0), _height(0), _surface(0), _texture(0),
+	_width(0), _height(0), _surface(0), _startTime(0), _shownFrame(0),
+	_frameCondition(_frameMutex), _texture(0),
 	_textureWidth(0.0), _textureHeight(0.0), _scale(kScaleNone),
 	_sound(0), _soundRate(0), _soundFlags(0) {
 
@@ -59,17 +67,33 @@ VideoDecoder::~VideoDecoder() {
 	if (_texture != 0)
 		GfxMan.abandon(&_texture, 1);
 
-	delete _surface;
+	deleteFrameBuffers();
 
 	deinitSound();
 }
 
 void VideoDecoder::deinit() {
+	// The decoding thread calls into the concrete decoder, so it has to
+	// stop before the concrete decoder is destroyed
+	stopDecoding();
+
 	hide();
 
 	GLContainer::removeFromQueue(Graphics::kQueueGLContainer);
 }
 
+void VideoDecoder::deleteFrameBuffers() {
+	for (std::vector<Graphics::Surface *>::iterator f = _frameBuffers.begin(); f != _frameBuffers.end(); ++f)
+		delete *f;
+
+	_frameBuffers.clear();
+	_freeFrames.clear();
+	_readyFrames.clear();
+
+	_surface    = 0;
+	_shownFrame = 0;
+}
+
 void VideoDecoder::initVideo(uint32 width, uint32 height) {
 	_width  = width;
 	_height = height;
@@ -82,10 +106,18 @@ void VideoDecoder::initVideo(uint32 width, uint32 height) {
 	_textureWidth  = ((float) _width ) / ((float) realWidth );
 	_textureHeight = ((float) _height) / ((float) realHeight);
 
-	delete _surface;
-	_surface = new Graphics::Surface(realWidth, realHeight);
+	deleteFrameBuffers();
+
+	_frameBuffers.resize(kFrameBufferCount);
+	for (uint32 i = 0; i < kFrameBufferCount; i++) {
+		_frameBuffers[i] = new Graphics::Surface(realWidth, realHeight);
+
+		_frameBuffers[i]->fill(0, 0, 0, 0);
+	}
 
-	_surface->fill(0, 0, 0, 0);
+	// The first surface starts out as the shown, empty frame
+	_shownFrame = _frameBuffers[0];
+	_freeFrames.assign(_frameBuffers.begin() + 1, _frameBuffers.end());
 
 	rebuild();
 }
@@ -156,7 +188,7 @@ uint32 VideoDecoder::getNumQueuedStreams() const {
 }
 
 void VideoDecoder::doRebuild() {
-	if (!_surface)
+	if (!_shownFrame)
 		return;
 
 	// Generate the texture ID
@@ -172,8 +204,8 @@ void VideoDecoder::doRebuild() {
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _surface->getWidth(), _surface->getHeight(),
-	             0, GL_BGRA, GL_UNSIGNED_BYTE, _surface->getData());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _shownFrame->getWidth(), _shownFrame->getHeight(),
+	             0, GL_BGRA, GL_UNSIGNED_BYTE, _shownFrame->getData());
 }
 
 void VideoDecoder::doDestroy() {
@@ -185,20 +217,13 @@ void VideoDecoder::doDestroy() {
 	_texture = 0;
 }
 
-void VideoDecoder::copyData() {
-	if (!_needCopy)
-		return;
-
-	if (!_surface)
-		throw Common::Exception("No video data while trying to copy");
+void VideoDecoder::copyData(const Graphics::Surface &surface) {
 	if (_texture == 0)
 		throw Common::Exception("No texture while trying to copy");
 
 	glBindTexture(GL_TEXTURE_2D, _texture);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _surface->getWidth(), _surface->getHeight(),
-	                GL_BGRA, GL_UNSIGNED_BYTE, _surface->getData());
-
-	_needCopy = false;
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface.getWidth(), surface.getHeight(),
+	                GL_BGRA, GL_UNSIGNED_BYTE, surface.getData());
 }
 
 void VideoDecoder::setScale(Scale scale) {
@@ -206,15 +231,128 @@ void VideoDecoder::setScale(Scale scale) {
 }
 
 bool VideoDecoder::isPlaying() const {
-	return !_finished || SoundMan.isPlaying(_soundHandle);
+	{
+		Common::StackLock lock(_frameMutex);
+
+		if (!_finished || !_readyFrames.empty())
+			return true;
+	}
+
+	return SoundMan.isPlaying(_soundHandle);
+}
+
+uint32 VideoDecoder::getElapsedTime() const {
+	if (!_started)
+		return 0;
+
+	return EventMan.getTimestamp() - _startTime;
+}
+
+uint32 VideoDecoder::getTimeToNextFrame() {
+	Common::StackLock lock(_frameMutex);
+
+	if (_readyFrames.empty())
+		return 0;
+
+	uint32 curTime = getElapsedTime();
+	if (_readyFrames.front().time <= curTime)
+		return 0;
+
+	return _readyFrames.front().time - curTime;
 }
 
 void VideoDecoder::update() {
-	if (getTimeToNextFrame() > 0)
+	Graphics::Surface *frame = 0;
+
+	_frameMutex.lock();
+
+	// Take the latest frame that's due, dropping the ones we're too late for
+	uint32 curTime = getElapsedTime();
+	while (!_readyFrames.empty() && (_readyFrames.front().time <= curTime)) {
+		if (frame)
+			_freeFrames.push_back(frame);
+
+		frame = _readyFrames.front().surface;
+		_readyFrames.pop_front();
+	}
+
+	_frameMutex.unlock();
+
+	if (!frame)
 		return;
 
-	processData();
-	copyData();
+	// The decoding thread doesn't touch this surface while we upload it
+	copyData(*frame);
+
+	Common::StackLock lock(_frameMutex);
+
+	_freeFrames.push_back(_shownFrame);
+	_shownFrame = frame;
+
+	_frameCondition.signal();
+}
+
+void VideoDecoder::threadMethod() {
+	for (;;) {
+		{
+			Common::StackLock lock(_frameMutex);
+
+			if (_killThread || _finished)
+				break;
+
+			if (_freeFrames.empty()) {
+				// All surfaces are in use, wait until one has been shown
+				_frameCondition.wait(100);
+				continue;
+			}
+
+			_surface = _freeFrames.front();
+			_freeFrames.pop_front();
+		}
+
+		uint32 time = getNextFrameTime();
+
+		_needCopy = false;
+
+		try {
+			processData();
+		} catch (Common::Exception &e) {
+			e.add("Failed decoding video frame");
+
+			Common::printException(e, "WARNING: ");
+			finish();
+
+			_needCopy = false;
+		}
+
+		Common::StackLock lock(_frameMutex);
+
+		if (_needCopy)
+			_readyFrames.push_back(Frame(_surface, time));
+		else
+			_freeFrames.push_front(_surface);
+
+		_surface = 0;
+	}
+}
+
+void VideoDecoder::stopDecoding() {
+	// Wake up the decoding thread, in case it's waiting for a free surface
+	_frameMutex.lock();
+	_killThread = true;
+	_frameCondition.signal();
+	_frameMutex.unlock();
+
+	destroyThread();
+
+	_killThread = false;
+
+	Common::StackLock lock(_frameMutex);
+
+	for (std::list<Frame>::iterator f = _readyFrames.begin(); f != _readyFrames.end(); ++f)
+		_freeFrames.push_back(f->surface);
+
+	_readyFrames.clear();
 }
 
 void VideoDecoder::getQuadDimensions(float &width, float &height) const {
@@ -257,7 +395,7 @@ void VideoDecoder::render(Graphics::RenderPass pass) {
 	if (!isPlaying() || !_started || (_texture == 0))
 		return;
 
-	// Process and copy the next frame data, if necessary
+	// Copy the next decoded frame, if it's due
 	update();
 
 	// Get the dimensions of the video surface we want, depending on the scaling requested
@@ -285,18 +423,27 @@ void VideoDecoder::render(Graphics::RenderPass pass) {
 void VideoDecoder::finish() {
 	finishSound();
 
+	Common::StackLock lock(_frameMutex);
+
 	_finished = true;
 }
 
 void VideoDecoder::start() {
 	startVideo();
 
+	_startTime = EventMan.getTimestamp();
+	_started   = true;
+
+	if (!createThread())
+		throw Common::Exception("Failed to create the video decoding thread");
+
 	show();
 }
 
 void VideoDecoder::abort() {
 	hide();
 
+	stopDecoding();
 	finish();
 }
 
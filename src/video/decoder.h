@@ -30,7 +30,12 @@
 #ifndef VIDEO_DECODER_H
 #define VIDEO_DECODER_H
 
+#include <vector>
+#include <list>
+
 #include "common/types.h"
+#include "common/thread.h"
+#include "common/mutex.h"
 
 #include "graphics/types.h"
 #include "graphics/glcontainer.h"
@@ -49,8 +54,13 @@ namespace Sound {
 
 namespace Video {
 
-/** A generic interface for video decoders. */
-class VideoDecoder : public Graphics::GLContainer, public Graphics::Renderable {
+/** A generic interface for video decoders.
+ *
+ *  Frames are decoded ahead in a separate thread, into a small pool of
+ *  surfaces. The render thread only uploads the frames that are due.
+ */
+class VideoDecoder : public Graphics::GLContainer, public Graphics::Renderable,
+                     public Common::Thread {
 public:
 	enum Scale {
 		kScaleNone,  ///< Don't scale the video.
@@ -73,8 +83,8 @@ public:
 	/** Abort the playing of the video. */
 	void abort();
 
-	/** Return the time, in milliseconds, to the next frame. */
-	virtual uint32 getTimeToNextFrame() const = 0;
+	/** Return the time, in milliseconds, to the next decoded frame. */
+	uint32 getTimeToNextFrame();
 
 	// Renderable
 	void calculateDistance();
@@ -82,23 +92,23 @@ public:
 
 protected:
 	bool _started;  ///< Has playback started?
-	bool _finished; ///< Has playback finished?
+	bool _finished; ///< Has decoding finished? Guarded by _frameMutex.
 	bool _needCopy; ///< Is new frame content available that needs to by copied?
 
 	uint32 _width;  ///< The video's width.
 	uint32 _height; ///< The video's height.
 
-	Graphics::Surface *_surface; ///< The video's surface.
+	Graphics::Surface *_surface; ///< The surface the current frame is decoded into.
 
-	/** Create a surface for video of these dimensions.
+	/** Create the surfaces for video of these dimensions.
 	 *
-	 *  Since the data will be copied into the graphics card memory, the surface's
+	 *  Since the data will be copied into the graphics card memory, the surfaces'
 	 *  actual dimensions will be rounded up to the next power of two values.
 	 *
-	 *  The surface's width and height will reflects that, while the video's
+	 *  The surfaces' width and height will reflects that, while the video's
 	 *  width and height will be stored in _width and _height.
 	 *
-	 *  The surface's pixel format is always BGRA8888.
+	 *  The surfaces' pixel format is always BGRA8888.
 	 */
 	void initVideo(uint32 width, uint32 height);
 
@@ -112,11 +122,20 @@ protected:
 
 	uint32 getNumQueuedStreams() const;
 
+	/** Return the time, in milliseconds since the start, the next frame is due. */
+	virtual uint32 getNextFrameTime() const = 0;
+
 	/** Start the video processing. */
 	virtual void startVideo() = 0;
-	/** Process the video's image and sound data further. */
+	/** Decode the next frame into _surface, together with its sound data.
+	 *
+	 *  Called from the decoding thread. Sets _needCopy if a frame was decoded.
+	 */
 	virtual void processData() = 0;
 
+	/** Return the time, in milliseconds, since the video was started. */
+	uint32 getElapsedTime() const;
+
 	void finish();
 
 	void deinit();
@@ -126,6 +145,29 @@ protected:
 	void doDestroy();
 
 private:
+	/** Number of surfaces to decode into, including the one currently shown. */
+	static const uint32 kFrameBufferCount = 4;
+
+	/** A decoded frame, waiting to be shown. */
+	struct Frame {
+		Graphics::Surface *surface; ///< The frame's image.
+		uint32 time;                ///< When the frame is due, in ms since the start.
+
+		Frame(Graphics::Surface *s = 0, uint32 t = 0);
+	};
+
+	uint32 _startTime; ///< Timestamp of when the video was started.
+
+	std::vector<Graphics::Surface *> _frameBuffers; ///< All frame surfaces.
+
+	std::list<Graphics::Surface *> _freeFrames;  ///< Surfaces ready to be decoded into.
+	std::list<Frame>               _readyFrames; ///< Decoded frames, in order.
+
+	Graphics::Surface *_shownFrame; ///< The surface currently in the texture.
+
+	mutable Common::Mutex _frameMutex;     ///< Mutex protecting the frame lists.
+	Common::Condition     _frameCondition; ///< Signals a freed surface.
+
 	Graphics::TextureID _texture;
 
 	float _textureWidth;
@@ -143,7 +185,15 @@ private:
 	void update();
 
 	/** Copy the video image data to the texture. */
-	void copyData();
+	void copyData(const Graphics::Surface &surface);
+
+	/** Stop the decoding thread and drop all decoded frames. */
+	void stopDecoding();
+
+	void deleteFrameBuffers();
+
+	// Thread
+	void threadMethod();
 
 	/** Get the dimensions of the quad to draw the texture on. */
 	void getQuadDimensions(float &width, float &height) const;
@@ -33,41 +33,26 @@
 
 #include "video/fader.h"
 
-#include "events/events.h"
-
 namespace Video {
 
-Fader::Fader(uint32 width, uint32 height, int n) : _c(0), _n(n), _lastUpdate(0) {
+Fader::Fader(uint32 width, uint32 height, int n) : _c(0), _n(n), _frame(0) {
 	initVideo(width, height);
 }
 
 Fader::~Fader() {
+	VideoDecoder::deinit();
 }
 
-bool Fader::hasTime() const {
-	if (!_started)
-		return true;
-
-	if ((EventMan.getTimestamp() - _lastUpdate) < 20)
-		return true;
+uint32 Fader::getNextFrameTime() const {
+	// One frame every 20ms
+	return _frame * 20;
+}
 
-	return false;
+void Fader::startVideo() {
 }
 
 void Fader::processData() {
-	uint32 curTime  = EventMan.getTimestamp();
-	uint32 diffTime = curTime - _lastUpdate;
-	if (_started && (diffTime < 20))
-		return;
-
-	if (!_started) {
-		diffTime = 0;
-
-		_lastUpdate = curTime;
-		_started    = true;
-
-		_c = 0;
-	} else
+	if (_frame > 0)
 		_c += 2;
 
 	// Fade from black to green
@@ -99,7 +84,7 @@ void Fader::processData() {
 		dPos += _surface->getWidth() * 4;
 	}
 
-	_lastUpdate = curTime;
+	_frame++;
 
 	if (_c == 0)
 		if (_n-- <= 0)
@@ -40,16 +40,17 @@ public:
 	Fader(uint32 width, uint32 height, int n);
 	~Fader();
 
-	bool hasTime() const;
-
 protected:
+	uint32 getNextFrameTime() const;
+
+	void startVideo();
 	void processData();
 
 private:
 	byte _c;
 	int _n;
 
-	uint32 _lastUpdate;
+	uint32 _frame;
 };
 
 } // End of namespace Video
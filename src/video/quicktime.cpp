@@ -44,8 +44,6 @@
 #include "sound/audiostream.h"
 #include "sound/decoders/codec.h"
 
-#include "events/events.h"
-
 // Audio codecs
 #include "sound/decoders/aac.h"
 #include "sound/decoders/adpcm.h"
@@ -75,7 +73,7 @@ QuickTimeDecoder::QuickTimeDecoder(Common::SeekableReadStream *stream) : VideoDe
 	_fd = stream;
 	_foundMOOV = false;
 	_videoTrackIndex = _audioTrackIndex = -1;
-	_startTime = _nextFrameStartTime = 0;
+	_nextFrameStartTime = 0;
 	_curFrame = -1;
 
 	Atom atom = { 0, 0, 0xffffffff };
@@ -264,8 +262,6 @@ Codec *QuickTimeDecoder::findDefaultVideoCodec() const {
 }
 
 void QuickTimeDecoder::startVideo() {
-	_startTime = EventMan.getTimestamp();
-	_started   = true;
 }
 
 void QuickTimeDecoder::processData() {
@@ -274,9 +270,6 @@ void QuickTimeDecoder::processData() {
 		return;
 	}
 
-	if (getTimeToNextFrame() > 0)
-		return;
-
 	_curFrame++;
 	_nextFrameStartTime += getFrameDuration();
 
@@ -305,25 +298,9 @@ void QuickTimeDecoder::processData() {
 	delete frameData;
 }
 
-uint32 QuickTimeDecoder::getElapsedTime() const {
-	// TODO: Extend decoder to get the elapsed time of the sound
-	//	return g_system->getMixer()->getSoundElapsedTime(_audHandle);
-
-	return EventMan.getTimestamp() - _startTime;
-}
-
-uint32 QuickTimeDecoder::getTimeToNextFrame() const {
-	if (!_started || _curFrame < 0)
-		return 0;
-
+uint32 QuickTimeDecoder::getNextFrameTime() const {
 	// Convert from the QuickTime rate base to 1000
-	uint32 nextFrameStartTime = _nextFrameStartTime * 1000 / _tracks[_videoTrackIndex]->timeScale;
-	uint32 elapsedTime = getElapsedTime();
-
-	if (nextFrameStartTime <= elapsedTime)
-		return 0;
-
-	return nextFrameStartTime - elapsedTime;
+	return _nextFrameStartTime * 1000 / _tracks[_videoTrackIndex]->timeScale;
 }
 
 void QuickTimeDecoder::initParseTable() {
@@ -879,7 +856,9 @@ void QuickTimeDecoder::updateAudioBuffer() {
 		AudioSampleDesc *entry = (AudioSampleDesc *)_tracks[_audioTrackIndex]->sampleDescs[0];
 
 		// Calculate the amount of chunks we need in memory until the next frame
-		uint32 timeToNextFrame = getTimeToNextFrame();
+		uint32 nextFrameTime   = getNextFrameTime();
+		uint32 elapsedTime     = getElapsedTime();
+		uint32 timeToNextFrame = (nextFrameTime > elapsedTime) ? (nextFrameTime - elapsedTime) : 0;
 		uint32 timeFilled = 0;
 		uint32 curAudioChunk = _curAudioChunk - getNumQueuedStreams();
 
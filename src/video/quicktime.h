@@ -64,9 +64,9 @@ public:
 	QuickTimeDecoder(Common::SeekableReadStream *stream);
 	~QuickTimeDecoder();
 
-	uint32 getTimeToNextFrame() const;
-
 protected:
+	uint32 getNextFrameTime() const;
+
 	void startVideo();
 	void processData();
 
@@ -191,7 +191,6 @@ private:
 	std::vector<Track *> _tracks;
 
 	int32 _curFrame;
-	uint32 _startTime;
 
 	void initParseTable();
 
@@ -207,8 +206,6 @@ private:
 	Common::SeekableReadStream *getNextFramePacket(uint32 &descId);
 	uint32 getFrameDuration();
 
-	uint32 getElapsedTime() const;
-
 	int readDefault(Atom atom);
 	int readLeaf(Atom atom);
 	int readELST(Atom atom);
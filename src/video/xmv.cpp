@@ -37,8 +37,6 @@
 #include "sound/decoders/pcm.h"
 #include "sound/decoders/adpcm.h"
 
-#include "events/events.h"
-
 #include "video/xmv.h"
 
 #include "video/codecs/xmvwmv2.h"
@@ -67,7 +65,7 @@ XboxMediaVideo::ADPCM51Streams::~ADPCM51Streams() {
 
 
 XboxMediaVideo::XboxMediaVideo(Common::SeekableReadStream *xmv) :
-	_xmv(xmv), _startTime(0), _videoCodec(0) {
+	_xmv(xmv), _videoCodec(0) {
 
 	assert(_xmv);
 
@@ -81,22 +79,12 @@ XboxMediaVideo::~XboxMediaVideo() {
 	delete _xmv;
 }
 
-uint32 XboxMediaVideo::getTimeToNextFrame() const {
-	if (!_started)
-		return 0;
-
-	uint32 curTime = EventMan.getTimestamp() - _startTime;
-	if (curTime >= _curPacket.video.currentFrameTimestamp)
-		return 0;
-
-	return _curPacket.video.currentFrameTimestamp - curTime;
+uint32 XboxMediaVideo::getNextFrameTime() const {
+	return _curPacket.video.currentFrameTimestamp;
 }
 
 void XboxMediaVideo::startVideo() {
 	queueNewAudio(_curPacket);
-
-	_startTime = EventMan.getTimestamp();
-	_started   = true;
 }
 
 void XboxMediaVideo::queueNewAudio(PacketAudio &audioPacket) {
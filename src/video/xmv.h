@@ -50,9 +50,9 @@ public:
 	XboxMediaVideo(Common::SeekableReadStream *xmv);
 	~XboxMediaVideo();
 
-	uint32 getTimeToNextFrame() const;
-
 protected:
+	uint32 getNextFrameTime() const;
+
 	void startVideo();
 	void processData();
 
@@ -123,9 +123,6 @@ private:
 
 	Common::SeekableReadStream *_xmv;
 
-	/** The time the XMV was started. */
-	uint32 _startTime;
-
 	/** All audio tracks within the XMV. */
 	std::vector<AudioTrack> _audioTracks;
 
@@ -48,6 +48,7 @@
 
 #include "graphics/queueman.h"
 #include "graphics/graphics.h"
+#include "graphics/yuv_to_rgb.h"
 
 #include "sound/sound.h"
 
@@ -264,6 +265,8 @@ void deinit() {
 	Graphics::Aurora::CursorManager::destroy();
 	Graphics::Aurora::TextureManager::destroy();
 
+	Graphics::YUVToRGBManager::destroy();
+
 	Aurora::TalkManager::destroy();
 	Aurora::TwoDARegistry::destroy();
 	Aurora::ResourceManager::destroy();